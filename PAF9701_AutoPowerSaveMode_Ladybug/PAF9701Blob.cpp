@@ -0,0 +1,91 @@
+/* Copyright Tlera Corporation
+ *
+ *  Connected-component labeling of 8 x 8 pixel masks, see PAF9701Blob.h.
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include "PAF9701Blob.h"
+#include "PAF9701Mask.h"
+
+
+static void blobStats(PAF9701_Blob * blob, uint64_t mask, const int16_t * pixels)
+{
+  PAF9701_MaskMoments m;
+  maskMoments(mask, &m);
+  uint8_t rows = maskRows(mask), columns = maskColumns(mask);
+  blob->mask = mask;
+  blob->area = m.count;
+  blob->minX = __builtin_ctz(columns);
+  blob->maxX = 31 - __builtin_clz(columns);
+  blob->minY = __builtin_ctz(rows);
+  blob->maxY = 31 - __builtin_clz(rows);
+  if(pixels == NULL) {
+    blob->x = ((uint32_t) m.sumX << 8) / m.count;   // Q8, 1/256 pixel
+    blob->y = ((uint32_t) m.sumY << 8) / m.count;
+    blob->peak = blob->mean = 0;
+    blob->peakIndex = __builtin_ctzll(mask);
+    return;
+  }
+  int16_t lo = INT16_MAX, hi = INT16_MIN;
+  int32_t sum = 0;
+  uint64_t bits = mask;
+  while(bits) {
+    uint8_t ii = maskPop(&bits);
+    sum += pixels[ii];
+    if(pixels[ii] < lo) lo = pixels[ii];
+    if(pixels[ii] > hi) {
+      hi = pixels[ii];
+      blob->peakIndex = ii;
+    }
+  }
+  blob->peak = hi;
+  blob->mean = sum / m.count;
+  // weights are the temperature above the coolest blob pixel plus one LSB, so a flat blob
+  // gets its plain centroid; 64 weights of at most 2^16 times 7 fit the 32 bit sums
+  uint32_t total = sum - (int32_t) (lo - 1) * m.count, sumX = 0, sumY = 0;
+  bits = mask;
+  while(bits) {
+    uint8_t ii = maskPop(&bits);
+    uint32_t w = pixels[ii] - lo + 1;
+    sumX += w * (ii & 7);
+    sumY += w * (ii >> 3);
+  }
+  blob->x = ((uint64_t) sumX << 8) / total;
+  blob->y = ((uint64_t) sumY << 8) / total;
+}
+
+
+uint8_t blobLabel(uint64_t mask, const int16_t * pixels, uint8_t connectivity, PAF9701_Blob * blobs, uint8_t capacity)
+{
+  uint8_t count = 0;
+  while(mask) {
+    uint64_t blob = mask & (~mask + 1);  // lowest set pixel is the seed
+    uint64_t last;
+    do {                                 // grow inside the mask until nothing changes
+      last = blob;
+      blob = (connectivity == 8 ? maskDilate8(blob) : maskDilate4(blob)) & mask;
+    } while(blob != last);
+    mask &= ~blob;
+
+    uint8_t slot = count;
+    if(count == capacity) {              // full: replace the smallest if this one is larger
+      if(capacity == 0) return 0;
+      slot = 0;
+      for(uint8_t ii = 1; ii < count; ii++) if(blobs[ii].area < blobs[slot].area) slot = ii;
+      if(maskCount(blob) <= blobs[slot].area) continue;
+    }
+    else count++;
+    blobStats(&blobs[slot], blob, pixels);
+  }
+  return count;
+}
+
+
+uint8_t blobLargest(const PAF9701_Blob * blobs, uint8_t count)
+{
+  uint8_t largest = 0;
+  for(uint8_t ii = 1; ii < count; ii++) if(blobs[ii].area > blobs[largest].area) largest = ii;
+  return largest;
+}
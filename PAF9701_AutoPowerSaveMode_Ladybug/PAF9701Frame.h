@@ -0,0 +1,62 @@
+/* Copyright Tlera Corporation
+ *
+ *  Fixed-point processing of PAF9701 object temperature frames.
+ *
+ *  Pixels stay in the sensor's native 1/16 C units as returned by getToDataRaw(), so a frame is
+ *  64 int16_t (128 bytes) and the min/max, color scaling, threshold and centroid steps need no
+ *  float conversion. Pixel i is at column i % 8, row i / 8; masks are uint64_t with bit i for pixel i.
+ *
+ *  frameMoments() weights each pixel by its temperature above a base level (the background, or
+ *  a threshold), which puts the centroid between pixel centers and gives the spread of the heat
+ *  as a variance along its major and minor axis. Sums are integer, the centroid and moments
+ *  Q8, and the axis angle and length come from a CORDIC pass, so no float is needed here either.
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#ifndef PAF9701Frame_h
+#define PAF9701Frame_h
+
+#include <stdint.h>
+
+#define PAF9701_TO_LSB_PER_C   16                                         // 0.0625 C per object temperature LSB
+#define PAF9701_TO_RAW(c)      ((int16_t) ((c) * PAF9701_TO_LSB_PER_C))   // degrees C to raw LSB
+
+typedef struct {
+  uint32_t heat;        // sum of pixel - base over the pixels above base, 1/16 C pixels
+  uint8_t  count;       // pixels above base
+  uint16_t x, y;        // centroid, Q8 pixel coordinates
+  int32_t  xx, yy, xy;  // central second moments, Q8 pixel^2
+  uint32_t major;       // variance along the major axis, Q8 pixel^2
+  uint32_t minor;       // and across it
+  int16_t  angle;       // major axis from the x (column) axis toward y (row), Q8 degrees, -90 - 90
+  uint16_t elongation;  // (major - minor) / major, Q8, 0 round, 256 a line
+} PAF9701_Moments;
+
+typedef struct {
+  int16_t  offset;   // raw value that maps to 0
+  uint16_t span;     // raw values above offset + span map to range
+  uint32_t mult;     // Q16 output steps per LSB
+  uint8_t  range;    // largest output value
+} PAF9701_Scale;
+
+void frameMinMax(const int16_t * pixels, uint8_t count, int16_t * minT, int16_t * maxT);
+void frameMinMaxMasked(const int16_t * pixels, uint64_t mask, int16_t * minT, int16_t * maxT);  // pixels with their bit set, e.g. a frame's windowMask
+void frameScaleInit(PAF9701_Scale * scale, int16_t minT, int16_t maxT, uint8_t range);
+uint64_t frameThreshold(const int16_t * pixels, int16_t level);     // bit i set when pixel i >= level
+uint8_t frameCentroid(uint64_t mask, uint16_t * x, uint16_t * y);  // Q8 pixel coordinates, returns pixel count
+uint8_t frameMoments(const int16_t * pixels, uint64_t mask, int16_t base, PAF9701_Moments * moments);  // pixels in mask above base, returns their count
+float frameCelsius(int16_t raw);                                     // for printing only
+
+
+// map a pixel into 0..range, e.g. an index into the display color table
+static inline uint8_t frameScale(const PAF9701_Scale * scale, int16_t t)
+{
+  if(t <= scale->offset) return 0;
+  if((uint16_t) (t - scale->offset) >= scale->span) return scale->range;
+  uint32_t out = ((uint32_t) (t - scale->offset) * scale->mult) >> 16;
+  return out > scale->range ? scale->range : (uint8_t) out;
+}
+
+#endif
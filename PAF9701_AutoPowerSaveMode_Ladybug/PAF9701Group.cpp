@@ -0,0 +1,190 @@
+/* Copyright Tlera Corporation
+ *
+ *  Several PAF9701s on one or more I2C buses, see PAF9701Group.h.
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include "PAF9701Group.h"
+
+
+PAF9701Group::PAF9701Group()
+{
+  _sensorCount = 0;
+  _busCount = 0;
+  _callback = NULL;
+  resetStats();
+}
+
+
+int8_t PAF9701Group::addSensor(PAF9701 * sensor)
+{
+  if(_sensorCount == PAF9701_GROUP_SENSORS) return -1;
+  uint8_t bus = 0;
+  while(bus < _busCount && _buses[bus] != sensor->getBus()) bus++;
+  if(bus == _busCount) {                 // first sensor on this bus
+    if(_busCount == PAF9701_GROUP_BUSES) return -1;
+    _buses[bus] = sensor->getBus();
+    _current[bus] = PAF9701_GROUP_NONE;
+    _next[bus] = 0;
+    _busyTime[bus] = 0;
+    _busCount++;
+  }
+  uint8_t index = _sensorCount++;
+  _sensors[index] = sensor;
+  _busOf[index] = bus;
+  _pollInterval[index] = 0;
+  _frames[index] = 0;
+  return index;
+}
+
+
+int8_t PAF9701Group::add(PAF9701 * sensor, PAF9701_Frame * frame)
+{
+  int8_t index = addSensor(sensor);
+  if(index >= 0) sensor->beginAcquisition(frame, NULL);
+  return index;
+}
+
+
+int8_t PAF9701Group::add(PAF9701 * sensor, PAF9701FrameRing * ring)
+{
+  int8_t index = addSensor(sensor);
+  if(index >= 0) sensor->beginAcquisition(ring, NULL);
+  return index;
+}
+
+
+void PAF9701Group::setCallback(PAF9701_GroupCallback callback)
+{
+  _callback = callback;
+}
+
+
+void PAF9701Group::setPollInterval(uint8_t sensor, uint32_t interval)
+{
+  _pollInterval[sensor] = interval;
+  _lastPoll[sensor] = micros() - interval;   // first read on the next service()
+}
+
+
+void PAF9701Group::startAcquisition(uint8_t sensor)
+{
+  _sensors[sensor]->startAcquisition();
+}
+
+
+uint8_t PAF9701Group::pickNext(uint8_t bus)
+{
+  for(uint8_t ii = 0; ii < _sensorCount; ii++) {
+    uint8_t index = (_next[bus] + ii) % _sensorCount;
+    if(_busOf[index] == bus && _sensors[index]->acquisitionBusy()) {
+      _next[bus] = (index + 1) % _sensorCount;   // the others on this bus go first next time
+      return index;
+    }
+  }
+  return PAF9701_GROUP_NONE;
+}
+
+
+/* One step per bus
+ * The sensor being read on each bus gets one transaction; a bus with no frame in progress
+ * takes the next waiting sensor round-robin. A sensor stays on its bus until its frame is
+ * finished, so the two banks of a frame are never split by another sensor's reads.
+ */
+uint8_t PAF9701Group::service()
+{
+  uint8_t finished = 0;
+  uint32_t now = micros();
+  for(uint8_t ii = 0; ii < _sensorCount; ii++) {
+    if(_pollInterval[ii] && now - _lastPoll[ii] >= _pollInterval[ii]) {
+      _lastPoll[ii] = now;
+      _sensors[ii]->startAcquisition();
+    }
+  }
+  for(uint8_t bus = 0; bus < _busCount; bus++) {
+    if(_current[bus] == PAF9701_GROUP_NONE) _current[bus] = pickNext(bus);
+    uint8_t index = _current[bus];
+    if(index == PAF9701_GROUP_NONE) continue;
+    uint32_t start = micros();
+    bool done = _sensors[index]->serviceAcquisition();
+    _busyTime[bus] += micros() - start;
+    if(done) {
+      _current[bus] = PAF9701_GROUP_NONE;
+      _frames[index]++;
+      finished++;
+      if(_callback) _callback(index, _sensors[index]->lastFrame());
+    }
+  }
+  return finished;
+}
+
+
+bool PAF9701Group::busy()
+{
+  for(uint8_t ii = 0; ii < _sensorCount; ii++) {
+    if(_sensors[ii]->acquisitionBusy()) return true;
+  }
+  return false;
+}
+
+
+uint8_t PAF9701Group::sensorCount()
+{
+  return _sensorCount;
+}
+
+
+uint8_t PAF9701Group::busCount()
+{
+  return _busCount;
+}
+
+
+PAF9701 * PAF9701Group::sensor(uint8_t sensor)
+{
+  return _sensors[sensor];
+}
+
+
+uint8_t PAF9701Group::busOf(uint8_t sensor)
+{
+  return _busOf[sensor];
+}
+
+
+void PAF9701Group::getSensorStats(uint8_t sensor, PAF9701_SensorStats * stats)
+{
+  PAF9701_AcqStats acq;
+  _sensors[sensor]->getAcquisitionStats(&acq);
+  uint32_t elapsed = micros() - _statsStart;
+  stats->frames = _frames[sensor];
+  stats->frameRate = elapsed ? (uint32_t) ((uint64_t) _frames[sensor] * 1000000000ULL / elapsed) : 0;
+  stats->overruns = acq.overruns;
+  stats->maxLatency = acq.maxLatency;
+  stats->totalLatency = acq.totalLatency;
+}
+
+
+void PAF9701Group::getBusStats(uint8_t bus, PAF9701_GroupBusStats * stats)
+{
+  stats->busyTime = _busyTime[bus];
+  stats->elapsed = micros() - _statsStart;
+  stats->utilization = stats->elapsed ? (uint16_t) ((uint64_t) _busyTime[bus] * 1000 / stats->elapsed) : 0;
+  stats->sensors = 0;
+  for(uint8_t ii = 0; ii < _sensorCount; ii++) {
+    if(_busOf[ii] == bus) stats->sensors++;
+  }
+}
+
+
+void PAF9701Group::resetStats()
+{
+  for(uint8_t ii = 0; ii < _sensorCount; ii++) {
+    _frames[ii] = 0;
+    _sensors[ii]->resetAcquisitionStats();
+  }
+  for(uint8_t bus = 0; bus < _busCount; bus++) _busyTime[bus] = 0;
+  _statsStart = micros();
+}
@@ -0,0 +1,87 @@
+/* Copyright Tlera Corporation
+ *
+ *  Several PAF9701s on one or more I2C buses, read with the acquisition engine of each sensor.
+ *
+ *  Sensors on the same I2Cdev share that bus: service() moves the frame read of one sensor per
+ *  bus forward by one transaction, and when that frame is done the next sensor with a frame
+ *  waiting is taken round-robin, so a fast sensor cannot starve the others on its bus. A sensor
+ *  with its INT pin wired is started from that pin's interrupt handler (startAcquisition());
+ *  without one, setPollInterval() starts its reads from service() every interval.
+ *
+ *  Each frame keeps the micros() timestamp of its own INT edge or poll, so frames from
+ *  different sensors can be put on one time line. Per-sensor frame rate and per-bus utilization
+ *  (time spent in bus transactions over elapsed time) are counted from resetStats().
+ *
+ *    PAF9701 left(&i2c_0), right(&i2c_0, PAF9701_ADDRESS_ADO), far(&i2c_1);
+ *    group.add(&left, &leftRing);  group.add(&right, &rightRing);  group.add(&far, &farFrame);
+ *    group.setCallback(onFrame);    // onFrame(sensor index, frame)
+ *    loop(): group.service();
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#ifndef PAF9701Group_h
+#define PAF9701Group_h
+
+#include "PAF9701.h"
+#include "PAF9701FrameRing.h"
+
+#define PAF9701_GROUP_SENSORS  8   // sensors per group
+#define PAF9701_GROUP_BUSES    4   // distinct I2Cdev buses per group
+#define PAF9701_GROUP_NONE     0xFF
+
+typedef void (*PAF9701_GroupCallback)(uint8_t sensor, PAF9701_Frame * frame);
+
+typedef struct {
+  uint32_t frames;           // frames read since resetStats()
+  uint32_t frameRate;        // frames per 1000 s (mHz)
+  uint32_t overruns;         // INT edges or polls while the previous frame was still waiting or being read
+  uint32_t maxLatency;       // us from INT edge or poll to frame ready, includes waiting for the bus
+  uint32_t totalLatency;
+} PAF9701_SensorStats;
+
+typedef struct {
+  uint32_t busyTime;         // us in bus transactions since resetStats()
+  uint32_t elapsed;          // us since resetStats(), wraps after about 71 minutes
+  uint16_t utilization;      // busyTime / elapsed in 1/1000
+  uint8_t  sensors;          // sensors on this bus
+} PAF9701_GroupBusStats;
+
+class PAF9701Group
+{
+  public:
+  PAF9701Group();
+  int8_t add(PAF9701 * sensor, PAF9701_Frame * frame);      // returns the sensor index, -1 when the group is full
+  int8_t add(PAF9701 * sensor, PAF9701FrameRing * ring);    // publish each frame of this sensor into ring
+  void setCallback(PAF9701_GroupCallback callback);
+  void setPollInterval(uint8_t sensor, uint32_t interval);  // us, 0 = started by its INT pin (default)
+  void startAcquisition(uint8_t sensor);                    // call from the INT pin interrupt handler of sensor
+  uint8_t service();                                        // call from loop(), returns frames finished by this call
+  bool busy();                                              // a frame is waiting or being read on some bus
+  uint8_t sensorCount();
+  uint8_t busCount();
+  PAF9701 * sensor(uint8_t sensor);
+  uint8_t busOf(uint8_t sensor);
+  void getSensorStats(uint8_t sensor, PAF9701_SensorStats * stats);
+  void getBusStats(uint8_t bus, PAF9701_GroupBusStats * stats);
+  void resetStats();
+  private:
+  PAF9701 * _sensors[PAF9701_GROUP_SENSORS];
+  uint8_t _busOf[PAF9701_GROUP_SENSORS];
+  uint32_t _pollInterval[PAF9701_GROUP_SENSORS];
+  uint32_t _lastPoll[PAF9701_GROUP_SENSORS];
+  uint32_t _frames[PAF9701_GROUP_SENSORS];
+  uint8_t _sensorCount;
+  I2Cdev * _buses[PAF9701_GROUP_BUSES];
+  uint8_t _current[PAF9701_GROUP_BUSES];          // sensor being read on each bus, PAF9701_GROUP_NONE when idle
+  uint8_t _next[PAF9701_GROUP_BUSES];             // where the round-robin search starts
+  uint32_t _busyTime[PAF9701_GROUP_BUSES];
+  uint8_t _busCount;
+  uint32_t _statsStart;
+  PAF9701_GroupCallback _callback;
+  int8_t addSensor(PAF9701 * sensor);
+  uint8_t pickNext(uint8_t bus);                  // next sensor on bus with a frame waiting
+};
+
+#endif
@@ -0,0 +1,35 @@
+/* Copyright Tlera Corporation
+ *
+ *  Morphology of 8 x 8 pixel masks, see PAF9701Mask.h.
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include "PAF9701Mask.h"
+
+
+// grow the background from its edge pixels until it stops changing, at most one pass per pixel
+// of the longest background path; whatever background it did not reach is a hole
+uint64_t maskFillHoles(uint64_t mask)
+{
+  uint64_t background = ~mask;
+  uint64_t reached = background & PAF9701_MASK_BORDER;
+  uint64_t last;
+  do {
+    last = reached;
+    reached = maskDilate4(reached) & background;
+  } while(reached != last);
+  return ~reached;
+}
+
+
+uint64_t maskFilter(uint64_t mask, uint8_t steps)
+{
+  bool eight = steps & maskConnect8;
+  if(steps & maskDespeckleStep) mask = maskDespeckle(mask);
+  if(steps & maskOpenStep)  mask = eight ? maskOpen8(mask) : maskOpen4(mask);
+  if(steps & maskCloseStep) mask = eight ? maskClose8(mask) : maskClose4(mask);
+  if(steps & maskFillStep)  mask = maskFillHoles(mask);
+  return mask;
+}
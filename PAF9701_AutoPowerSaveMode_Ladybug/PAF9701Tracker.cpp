@@ -0,0 +1,310 @@
+/* Copyright Tlera Corporation
+ *
+ *  Multi-target tracker with a count line, see PAF9701Tracker.h.
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include "PAF9701Tracker.h"
+
+#define HISTORY_SLOT(index)  ((index) & (PAF9701_TRACK_HISTORY - 1))
+
+static_assert(PAF9701_MAX_TRACKS <= 8 && PAF9701_MAX_BLOBS <= 8, "update() keeps the tracks and blobs used in 8 bit sets");
+
+typedef struct {
+  float   d2;      // squared distance from the prediction
+  uint8_t track;
+  uint8_t blob;
+} TrackPair;
+
+static const PAF9701_TrackerConfig defaultConfig = {
+  2.0f,     // gate, pixels
+  3,        // confirmHits
+  8,        // deleteMisses, long enough to hold a person hidden by another walking past
+  2,        // minArea
+  0.01f,    // processNoise
+  0.1f,     // measurementNoise
+  0.5f      // velocityNoise, a walking person is under a pixel per frame
+};
+
+
+PAF9701Tracker::PAF9701Tracker()
+{
+  _config = defaultConfig;
+  _lineVertical = false;
+  _line = 3.5f;
+  _band = 0.5f;
+  reset();
+}
+
+
+void PAF9701Tracker::setConfig(const PAF9701_TrackerConfig * config)
+{
+  _config = *config;
+  if(_config.confirmHits == 0) _config.confirmHits = 1;
+  if(_config.deleteMisses == 0) _config.deleteMisses = 1;
+}
+
+
+void PAF9701Tracker::getConfig(PAF9701_TrackerConfig * config)
+{
+  *config = _config;
+}
+
+
+void PAF9701Tracker::setCountLine(bool vertical, float position, float band)
+{
+  _lineVertical = vertical;
+  _line = position;
+  _band = band;
+  for(uint8_t ii = 0; ii < PAF9701_MAX_TRACKS; ii++) {   // sides were measured against the old line
+    _tracks[ii].side = 0;
+    _tracks[ii].pending = 0;
+  }
+}
+
+
+void PAF9701Tracker::reset()
+{
+  for(uint8_t ii = 0; ii < PAF9701_MAX_TRACKS; ii++) {
+    _tracks[ii].id = 0;
+    _tracks[ii].state = trackFree;
+  }
+  _stats.frames = 0;
+  _stats.in = 0;
+  _stats.out = 0;
+  _stats.births = 0;
+  _stats.deaths = 0;
+  _stats.tentativeDrops = 0;
+  _nextId = 1;
+  _lastIn = 0;
+  _lastOut = 0;
+}
+
+
+uint8_t PAF9701Tracker::update(const PAF9701_Blob * blobs, uint8_t count)
+{
+  TrackPair pairs[PAF9701_MAX_TRACKS * PAF9701_MAX_BLOBS];
+  uint8_t trackUsed = 0, blobUsed = 0;   // one bit per track slot and per blob
+  if(count > PAF9701_MAX_BLOBS) count = PAF9701_MAX_BLOBS;
+  for(uint8_t bb = 0; bb < count; bb++) if(blobs[bb].area < _config.minArea) blobUsed |= 1 << bb;
+
+  _stats.frames++;
+  _lastIn = 0;
+  _lastOut = 0;
+  for(uint8_t ii = 0; ii < PAF9701_MAX_TRACKS; ii++) if(_tracks[ii].state != trackFree) predict(&_tracks[ii]);
+
+  // confirmed and coasting tracks pick first, then tentative ones from the blobs left over
+  for(uint8_t pass = 0; pass < 2; pass++) {
+    uint8_t n = 0;
+    for(uint8_t ii = 0; ii < PAF9701_MAX_TRACKS; ii++) {
+      PAF9701_Track * t = &_tracks[ii];
+      if(t->state == trackFree || (t->state == trackTentative) != (pass == 1)) continue;
+      float gate2 = _config.gate * _config.gate + t->pp;   // wider while the position is uncertain
+      for(uint8_t bb = 0; bb < count; bb++) {
+        if(blobUsed & (1 << bb)) continue;
+        float dx = blobs[bb].x / 256.0f - t->x, dy = blobs[bb].y / 256.0f - t->y;
+        float d2 = dx * dx + dy * dy;
+        if(d2 > gate2) continue;
+        uint8_t jj = n++;
+        while(jj > 0 && pairs[jj - 1].d2 > d2) { pairs[jj] = pairs[jj - 1]; jj--; }   // insertion sort, at most 64 pairs
+        pairs[jj].d2 = d2;
+        pairs[jj].track = ii;
+        pairs[jj].blob = bb;
+      }
+    }
+    for(uint8_t pp = 0; pp < n; pp++) {
+      if((trackUsed & (1 << pairs[pp].track)) || (blobUsed & (1 << pairs[pp].blob))) continue;
+      trackUsed |= 1 << pairs[pp].track;
+      blobUsed |= 1 << pairs[pp].blob;
+      correct(&_tracks[pairs[pp].track], &blobs[pairs[pp].blob]);
+    }
+  }
+
+  for(uint8_t ii = 0; ii < PAF9701_MAX_TRACKS; ii++) {
+    PAF9701_Track * t = &_tracks[ii];
+    if(t->state == trackFree || (trackUsed & (1 << ii))) continue;
+    t->hits = 0;
+    if(t->misses < 255) t->misses++;
+    if(t->state == trackTentative) {
+      t->state = trackFree;
+      t->id = 0;
+      _stats.tentativeDrops++;
+      continue;
+    }
+    t->state = trackCoasting;
+    if(t->misses >= _config.deleteMisses || t->x < -0.5f || t->x > 7.5f || t->y < -0.5f || t->y > 7.5f) {
+      t->state = trackFree;   // lost, or walked out of the frame
+      t->id = 0;
+      _stats.deaths++;
+    }
+  }
+
+  for(uint8_t ii = 0; ii < PAF9701_MAX_TRACKS; ii++) {
+    if(_tracks[ii].state == trackFree) continue;
+    checkLine(&_tracks[ii]);
+    record(&_tracks[ii]);
+  }
+
+  // blobs nobody claimed start tracks, while there are free slots
+  uint8_t slot = 0;
+  for(uint8_t bb = 0; bb < count; bb++) {
+    if(blobUsed & (1 << bb)) continue;
+    while(slot < PAF9701_MAX_TRACKS && _tracks[slot].state != trackFree) slot++;
+    if(slot == PAF9701_MAX_TRACKS) break;
+    start(&_tracks[slot], &blobs[bb]);
+  }
+
+  uint8_t live = 0;
+  for(uint8_t ii = 0; ii < PAF9701_MAX_TRACKS; ii++) if(_tracks[ii].state >= trackConfirmed) live++;
+  return live;
+}
+
+
+const PAF9701_Track * PAF9701Tracker::track(uint8_t slot)
+{
+  if(slot >= PAF9701_MAX_TRACKS || _tracks[slot].state == trackFree) return NULL;
+  return &_tracks[slot];
+}
+
+
+const PAF9701_Track * PAF9701Tracker::findTrack(uint16_t id)
+{
+  for(uint8_t ii = 0; ii < PAF9701_MAX_TRACKS; ii++) {
+    if(_tracks[ii].state != trackFree && _tracks[ii].id == id) return &_tracks[ii];
+  }
+  return NULL;
+}
+
+
+bool PAF9701Tracker::history(const PAF9701_Track * track, uint8_t ago, float * x, float * y)
+{
+  if(ago >= track->historyCount) return false;
+  uint8_t slot = HISTORY_SLOT(track->historyHead - ago);
+  *x = track->historyX[slot] / 256.0f;
+  *y = track->historyY[slot] / 256.0f;
+  return true;
+}
+
+
+int8_t PAF9701Tracker::lastCrossings(uint8_t * in, uint8_t * out)
+{
+  if(in != NULL) *in = _lastIn;
+  if(out != NULL) *out = _lastOut;
+  return (int8_t) (_lastIn - _lastOut);
+}
+
+
+int32_t PAF9701Tracker::occupancy()
+{
+  return (int32_t) (_stats.in - _stats.out);
+}
+
+
+void PAF9701Tracker::getStats(PAF9701_TrackerStats * stats)
+{
+  *stats = _stats;
+}
+
+
+// constant velocity, one frame: x += v, P = F P F' + q [1/4 1/2; 1/2 1]
+void PAF9701Tracker::predict(PAF9701_Track * t)
+{
+  float q = _config.processNoise;
+  t->x += t->vx;
+  t->y += t->vy;
+  t->pp += 2.0f * t->pv + t->vv + 0.25f * q;
+  t->pv += t->vv + 0.5f * q;
+  t->vv += q;
+  if(t->age < 65535) t->age++;
+}
+
+
+// measurement of position only, gain K = P H' / (pp + r)
+void PAF9701Tracker::correct(PAF9701_Track * t, const PAF9701_Blob * blob)
+{
+  float s = t->pp + _config.measurementNoise;
+  float kp = t->pp / s, kv = t->pv / s;
+  float dx = blob->x / 256.0f - t->x, dy = blob->y / 256.0f - t->y;
+  t->x += kp * dx;
+  t->y += kp * dy;
+  t->vx += kv * dx;
+  t->vy += kv * dy;
+  t->vv -= kv * t->pv;
+  t->pv -= kp * t->pv;
+  t->pp -= kp * t->pp;
+  t->area = blob->area;
+  t->peak = blob->peak;
+  t->misses = 0;
+  if(t->hits < 255) t->hits++;
+  if(t->state == trackCoasting) t->state = trackConfirmed;
+  if(t->state == trackTentative && t->hits >= _config.confirmHits) {
+    t->state = trackConfirmed;
+    _stats.births++;
+    count(t->pending);
+    t->pending = 0;
+  }
+}
+
+
+void PAF9701Tracker::start(PAF9701_Track * t, const PAF9701_Blob * blob)
+{
+  t->id = _nextId++;
+  if(_nextId == 0) _nextId = 1;
+  t->state = trackTentative;
+  t->hits = 1;
+  t->misses = 0;
+  t->age = 0;
+  t->x = blob->x / 256.0f;
+  t->y = blob->y / 256.0f;
+  t->vx = 0;
+  t->vy = 0;
+  t->pp = _config.measurementNoise;
+  t->pv = 0;
+  t->vv = _config.velocityNoise;
+  t->area = blob->area;
+  t->peak = blob->peak;
+  t->side = 0;
+  t->pending = 0;
+  t->historyCount = 0;
+  t->historyHead = PAF9701_TRACK_HISTORY - 1;
+  if(_config.confirmHits <= 1) {
+    t->state = trackConfirmed;
+    _stats.births++;
+  }
+  checkLine(t);
+  record(t);
+}
+
+
+void PAF9701Tracker::record(PAF9701_Track * t)
+{
+  t->historyHead = HISTORY_SLOT(t->historyHead + 1);
+  t->historyX[t->historyHead] = (int16_t) (t->x * 256.0f);
+  t->historyY[t->historyHead] = (int16_t) (t->y * 256.0f);
+  if(t->historyCount < PAF9701_TRACK_HISTORY) t->historyCount++;
+}
+
+
+// side changes only outside the band, so a track standing on the line does not count twice
+void PAF9701Tracker::checkLine(PAF9701_Track * t)
+{
+  float c = _lineVertical ? t->x : t->y;
+  int8_t side = 0;
+  if(c < _line - _band) side = -1;
+  if(c > _line + _band) side = 1;
+  if(side == 0 || side == t->side) return;
+  int8_t crossing = t->side != 0 ? side : 0;   // the first side seen is not a crossing
+  t->side = side;
+  if(crossing == 0) return;
+  if(t->state == trackTentative) t->pending += crossing;   // back again cancels it
+  else count(crossing);
+}
+
+
+void PAF9701Tracker::count(int8_t crossing)
+{
+  if(crossing > 0) { _stats.in++; _lastIn++; }
+  if(crossing < 0) { _stats.out++; _lastOut++; }
+}
@@ -23,6 +23,8 @@
 
 #include "RTC.h"
 #include "PAF9701.h"
+#include "PAF9701Frame.h"
+#include "PAF9701Mask.h"
 #include <Adafruit_GFX.h>    // Core graphics library, install from Arduino IDE board manager
 #include <Adafruit_ST7735.h> // Hardware-specific library, install from Arduino IDE board manager
 #include "SPI.h"
@@ -74,15 +76,23 @@ uint8_t frameAverage = fourFrames;           // choices are oneFrame, twoFrames,
 uint8_t IIRAverage = frames0_1;              // choices are frames 0_1, frames125_875, ..., frames825_175
 bool settle_en = true;                       // allow settling (~3 sec) before sensor data made available when sensor operation resumes from suspend
 bool detectMode3 = false;                    // select between detectMode1/2 (detectMode3 = false) and detectMode1/2/3 (detectMode3 = true)
+PAF9701_DetectConfig detectConfig = {       // detection tiers: longer periods save current, shorter ones wake up sooner
+  PAF9701_PERIOD_TICKS(1000),                // detect mode 1 frame every 1 s
+  PAF9701_PERIOD_TICKS(5000),                // detect mode 2 frame every 5 s
+  RdetectTime,                               // time without an alert before stepping down a mode
+  4, 4,                                      // with detectMode3, pixels in alert that wake detect mode 1 and 2
+  detectMode3
+};
 uint8_t normalModeAlert = absValueAlert, det123ModeAlert = absValueAlert; // choices are frameUpdateAlert, absValueAlert, or diffValueAlert
 int16_t TaLow = 30, TaHigh = 60, ToLow = 40, ToHigh = 60, TaHyst = 6, ToHyst = 6, pixels = 8; // set temperature thresholds (x 2 since 0.5 C/lsb) for alerts
 int16_t rawTaData = 0, calTaData = 0;
 uint8_t temp = 0;
-float temperatures[64];                      //Contains the calculated object temperature of each pixel in the array
-float minTemp, maxTemp, tmpTemp;
+int16_t temperatures[64];                    //Contains the object temperature of each pixel in the array, 1/16 C per LSB
+int16_t minTemp, maxTemp, tmpTemp;
+PAF9701_Scale colorScale;                    // maps temperatures onto the 200 entry color table
 int16_t output[7];
 uint8_t statusFlag;
-uint32_t alertPixels[2] = {0, 0};
+uint64_t alertPixels = 0;                    // bit i set when pixel i is in alert
 
 volatile bool PAF9701_intFlag = false;       // Logic flag for alert signal
 
@@ -159,6 +169,8 @@ void setup()
 //   PAF9701.initNormalMode(runMode, RframeTime, settle_en);  // select sensor run mode
 //   Serial.print("Sample rate = 0x"); Serial.println(RframeTime, HEX); Serial.println(" ");
    PAF9701.initAutoPowerSaveMode(detectMode3, RdetectTime, settle_en);  // select sensor run mode
+   PAF9701.setDetectConfig(&detectConfig);
+   if(!PAF9701.verifyDetectConfig(&detectConfig)) Serial.println("Detection tier configuration did not verify!");
    Serial.print("Sample rate = 0x"); Serial.println(RdetectTime, HEX); Serial.println(" ");
    temp = PAF9701.getPowerSaveMode();
    Serial.print("power save mode register = 0x"); Serial.println(temp, HEX); 
@@ -213,21 +225,11 @@ void loop()
   if(statusFlag & 0x02) Serial.println(" Ta high limit!");
   if(statusFlag & 0x01) Serial.println(" Alert flag!");
 
-  PAF9701.getAlertPixels(alertPixels);
-  uint8_t count = 0;
-  for(uint8_t i = 0; i < 32; i++)
-  {
-    if(alertPixels[0] & (1 << i) ) {
-      Serial.print(i); Serial.print(" ");
-      count++;
-    }
-  }
-  for(uint8_t i = 0; i < 32; i++)
-  {
-    if(alertPixels[1] & (1 << i) ) {
-      Serial.print(32 + i); Serial.print(" ");
-      count++;
-    }
+  alertPixels = PAF9701.getAlertPixels();
+  uint8_t count = maskCount(alertPixels);
+  uint64_t alerts = alertPixels;
+  while(alerts) {          // visit the alert pixels only
+    Serial.print(maskPop(&alerts)); Serial.print(" ");
   }
   Serial.println(" ");
   Serial.print("are the "); Serial.print(count); Serial.println(" alert pixels!");
@@ -237,27 +239,21 @@ void loop()
   // Get PAF9701 data
   rawTaData = PAF9701.getRawTaData(); // ambient temperature
   calTaData = PAF9701.getCalTaData();
-  PAF9701.getToData(temperatures);    // object temperature
+  PAF9701.getToDataRaw(temperatures); // object temperature
   }
 
   // Get min and max temperatures for display
-  minTemp = 1000.0f;
-  maxTemp =    0.0f;
-  for(int y=0; y<8; y++){ //go through all the rows
-  for(int x=0; x<8; x++){ //go through all the columns
-    if(temperatures[y+x*8] > maxTemp) maxTemp = temperatures[y+x*8];
-    if(temperatures[y+x*8] < minTemp) minTemp = temperatures[y+x*8];
-    }
-    }
+  frameMinMax(temperatures, 64, &minTemp, &maxTemp);
+  frameScaleInit(&colorScale, minTemp, maxTemp, 199);
 
   for(int y=0; y<8; y++){ //go through all the rows
   for(int x=0; x<8; x++){ //go through all the columns
     tmpTemp = temperatures[y+x*8];
-    Serial.print(tmpTemp, 1); Serial.print(","); // use the serial monitor to plot the data, TFT diplay would be better
+    Serial.print(frameCelsius(tmpTemp), 1); Serial.print(","); // use the serial monitor to plot the data, TFT diplay would be better
     if(x == 7) Serial.println(" "); 
     if(y+x*8 == 63) Serial.println(" "); 
 
-    rgb =(uint8_t) (((tmpTemp - minTemp)/(maxTemp - minTemp)) * 199); // 0 - 199 = 200 possible rgb color values
+    rgb = frameScale(&colorScale, tmpTemp);  // 0 - 199 = 200 possible rgb color values
 
     red   = rgb_colors[rgb*3] >> 3;          // keep 5 MS bits
     green = rgb_colors[rgb*3 + 1] >> 2;      // keep 6 MS bits
@@ -273,14 +269,14 @@ void loop()
     tft.setTextSize(0);
     tft.setTextColor(WHITE);
     tft.setCursor(32, 4 );                   // write min,max temperature on non-data patch
-    tft.print("min T = "); tft.print((uint8_t) minTemp); tft.print(" C");
+    tft.print("min T = "); tft.print((uint8_t) (minTemp / PAF9701_TO_LSB_PER_C)); tft.print(" C");
     tft.setCursor(32, 20 );
-    tft.print("max T = "); tft.print((uint8_t) maxTemp); tft.print(" C");
+    tft.print("max T = "); tft.print((uint8_t) (maxTemp / PAF9701_TO_LSB_PER_C)); tft.print(" C");
     tft.setRotation(3);                      // 0, 2 are portrait mode, 1,3 are landscape mode
 
     if(SerialDebug) {
-      Serial.print("min T = "); Serial.println((uint8_t) minTemp);
-      Serial.print("max T = "); Serial.println((uint8_t) maxTemp);
+      Serial.print("min T = "); Serial.println((uint8_t) (minTemp / PAF9701_TO_LSB_PER_C));
+      Serial.print("max T = "); Serial.println((uint8_t) (maxTemp / PAF9701_TO_LSB_PER_C));
     }  
   } /* end of PAF9701 interrupt handling
 
@@ -11,295 +11,1345 @@
  */
  
 #include "PAF9701.h"
-#include "I2CDev.h"
+#include "PAF9701FrameRing.h"
+#include "I2Cdev.h"
 
-PAF9701::PAF9701(I2Cdev* i2c_bus)
+/* Register shadow
+ * Write-through copy of the configuration registers so that redundant bank selects and the
+ * read-modify-write reads of registers like POWER_SAVING_MODE never go out on the bus.
+ * Status, data, alert flag, part id and reset registers are not shadowed. The getters the
+ * sketches print as a readback check (getPowerSaveMode(), getNormalAlertLimits(), ...) read
+ * the sensor, so a lost write or a sensor reset shows there.
+*/
+static const struct {
+  uint8_t bank, first, count, offset;
+} shadowWindows[] = {
+  {0x00, 0x00, 0x80,   0},  // Bank 0, all configuration registers
+  {0x01, 0x50, 0x20, 128},  // Bank 1, filter and alert limits
+  {0x03, 0x60, 0x10, 160},  // Bank 3, emissivity, decay time and orientation
+  {0x04, 0x48, 0x10, 176}   // Bank 4, WOI and skip mode registers
+};
+
+
+/* Acquisition profiles
+ * BURST_NUM_SEL sets how many samples the sensor averages per frame, 2^n for Ta in the high
+ * nibble and for To in the low nibble. More samples lower the noise (by the square root of the
+ * To samples) and lengthen the conversion, which caps the frame rate BURST_FRQ_SEL can ask for.
+ */
+static const uint8_t profileBurstNum[] = {
+  0x57,   // lowLatencyProfile
+  0x79,   // balancedProfile, per 7.1.2 of the data sheet
+  0x8A    // lowNoiseProfile
+};
+
+
+// pixel bytes as read from banks 4 and 5, LSB first, to int16_t in place
+static void unpackPixels(int16_t * pixels)
+{
+  uint8_t * rawData = (uint8_t *) pixels;
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    pixels[ii] = (int16_t) ( (uint16_t) rawData[2*ii + 1] << 8 | rawData[2*ii]);
+  }
+}
+
+
+PAF9701::PAF9701(I2Cdev* i2c_bus, uint8_t address)
  {
    _i2c_bus = i2c_bus;
+   _address = address;
+   _batchCount = 0;
+   _snapshotRetries = 0;
+   _firstRow = 0;
+   _lastRow = 7;
+   _emissivity = 0.98f;
+   _decayTime = 0.0f;
+   _windowMask = ~(uint64_t) 0;
+   _acqFrame = NULL;
+   _acqRing = NULL;
+   _acqCallback = NULL;
+   _acqPending = false;
+   _acqState = acqIdle;
+   _startState = startIdle;
+   memset(&_startStats, 0, sizeof(_startStats));
+   _staging = false;
+   memset(_expected, 0, sizeof(_expected));
+   _deferredCount = 0;
+   invalidateCache();
+   resetBusStats();
+   resetAcquisitionStats();
  }
 
 
+I2Cdev* PAF9701::getBus()
+{
+   return _i2c_bus;
+}
+
+
+uint8_t PAF9701::getAddress()
+{
+   return _address;
+}
+
+
 uint16_t PAF9701::getChipID()
  {
- _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x00);       // select Bank 0
- uint8_t temp1 = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_PARTID_L);
- uint8_t temp2 = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_PARTID_H); // read part id registers 
+ selectBank(0x00);       // select Bank 0
+ uint8_t temp1 = readReg(PAF9701_PARTID_L);
+ uint8_t temp2 = readReg(PAF9701_PARTID_H); // read part id registers 
  return ( ((uint16_t) temp2 << 8) | temp1);                             // report uint16_t result
  } 
 
 
 void PAF9701::coldReset()
  {
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x00);       // select Bank 0
+  selectBank(0x00);       // select Bank 0
   // software reset the PAF9701, reset all registers to default
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_HOST_RSTB, 0x5A); 
+  writeReg(PAF9701_HOST_RSTB, 0x5A); 
+  invalidateCache();                     // all registers back to default
  }
 
 
+/* Startup sequence
+ * The same steps as the sketches' setup() - cold reset, wait for the flash bootload, init,
+ * enable, settle - as a state machine that never blocks, so display init and other sensors can
+ * run in the meantime. Each serviceStartup() call does at most one status read, and polls no
+ * more often than every PAF9701_STARTUP_POLL_MS. When it returns startConfigure the init
+ * sequence has been written and the sensor is still suspended: filters, orientation, alert
+ * limits and so on go in before the next call enables it. Frames during the settle time are
+ * discarded; the sequence is ready at the first frame update flag after it, which is left set
+ * for the application to read.
+ */
+void PAF9701::beginStartup(const PAF9701_StartupConfig * config)
+{
+   _startConfig = *config;
+   memset(&_startStats, 0, sizeof(_startStats));
+   coldReset();
+   _startTime = _startStep = _startPoll = millis();
+   _startState = startReset;
+}
+
+
+uint8_t PAF9701::serviceStartup()
+{
+   uint32_t now = millis();
+   switch(_startState) {
+     case startReset:
+       if(now - _startStep < _startConfig.resetTime) break;
+       _startState = startBootload;
+       _startStep = _startPoll = now;
+       _startStats.statusReads++;
+       if(getStatus() & 0x20) startConfigured(now);
+       break;
+
+     case startBootload:
+       if(now - _startPoll < PAF9701_STARTUP_POLL_MS) break;
+       _startPoll = now;
+       _startStats.statusReads++;
+       if(getStatus() & 0x20) startConfigured(now);
+       else if(now - _startStep >= _startConfig.bootTimeout) {
+         _startStats.failedState = startBootload;
+         _startState = startFailed;
+       }
+       break;
+
+     case startConfigure:
+       clearInterrupt();
+       resumeOperation();
+       _startStep = _startPoll = now;
+       _startState = _startConfig.settle ? startSettle : startFirstFrame;
+       break;
+
+     case startSettle:
+       if(now - _startStep < _startConfig.settleTime) break;
+       clearInterrupt();       // frames so far are not settled
+       _startStep = _startPoll = now;
+       _startState = startFirstFrame;
+       break;
+
+     case startFirstFrame:
+       if(now - _startPoll < PAF9701_STARTUP_POLL_MS) break;
+       _startPoll = now;
+       _startStats.statusReads++;
+       if(getStatus() & 0x10) {
+         _startStats.firstFrame = now - _startTime;
+         _startState = startReady;
+       }
+       else if(now - _startStep >= _startConfig.frameTimeout) {
+         _startStats.failedState = startFirstFrame;
+         _startState = startFailed;
+       }
+       break;
+   }
+   return _startState;
+}
+
+
+// bootload done: write the init sequence, the sensor stays suspended until the next step
+void PAF9701::startConfigured(uint32_t now)
+{
+   _startStats.bootload = now - _startTime;
+   bool valid;
+   if(_startConfig.autoPowerSave) valid = initAutoPowerSaveMode(_startConfig.detect3, _startConfig.detectTime, _startConfig.settle, _startConfig.profile);
+   else valid = initNormalMode(_startConfig.runMode, _startConfig.sampleRate, _startConfig.settle, _startConfig.profile);
+   _startStats.rateRaised = !valid;
+   _startState = startConfigure;
+}
+
+
+void PAF9701::getStartupStats(PAF9701_StartupStats * stats)
+{
+   *stats = _startStats;
+}
+
+
  void PAF9701::warmReset()
  {
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x00);       // select Bank 0
+  selectBank(0x00);       // select Bank 0
   // software reset the PAF9701, preserve register settings
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_HOST_RSTB, 0x9A); 
+  writeReg(PAF9701_HOST_RSTB, 0x9A); 
+  _bank = PAF9701_BANK_UNKNOWN;          // registers preserved, re-select the bank on next access
  }
 
 
-  void PAF9701::initNormalMode(uint8_t runMode, uint32_t sampleRate, bool settle_en)
+  bool PAF9701::initNormalMode(uint8_t runMode, uint32_t sampleRate, bool settle_en, uint8_t profile)
  {
-  // initialize sensor to default values per 7.1.2 of the data sheet
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x7F, 0x00);  // select Bank 0
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x20, 0x79);  // Ta 2^7 samples, To 2^9 samples
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x21, 0x4E);  // 10 Hz, 97 ms conversion time
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x56, 0x33); 
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x1C, 0x03); 
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x79, 0x28); 
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x7A, 0x09); 
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x7F, 0x03);  // Bank 3
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x60, 0x48);  // 0.98 emmissivity
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x61, 0xE1); 
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x62, 0x7A); 
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x63, 0x3F); 
+  // defaults per 7.1.2 of the data sheet, then the user-specified configuration, see paf9701NormalModeWrites()
+  PAF9701_RegWrite writes[PAF9701_INIT_WRITES];
+  bool valid;
+  uint8_t count = paf9701NormalModeWrites(writes, runMode, sampleRate, settle_en, profile, _emissivity, _decayTime,
+                                          readFields(0x00, PAF9701_POWER_SAVING_MODE), &valid);
+  for(uint8_t ii = 0; ii < count; ii++) queueWrite(writes[ii].bank, writes[ii].reg, writes[ii].data);
 
-  // User-specified confguration
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x00);       // select Bank 0
-  
-  uint8_t temp = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_POWER_SAVING_MODE);
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_POWER_SAVING_MODE, temp & ~(0x10) ); // disable auto power save mode
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_OPERATION_MODE, runMode);  // select runMode
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_ONE_SHOT_MODE, 0x00);  // disable one-shot mode
-  
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BURST_FRQ_SEL_L,  sampleRate & 0xFF);  // select sample rate
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BURST_FRQ_SEL_M, (sampleRate >> 8) & 0xFF);  // select sample rate
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BURST_FRQ_SEL_H, (sampleRate >> 16) & 0x0F);  // select sample rate
-  
-  temp = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_POWER_SAVING_MODE);
-  if(settle_en){
-    _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_POWER_SAVING_MODE, temp & ~(0x02) ); // enable settle function after sensor enable
-  }
-  else  {
-    _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_POWER_SAVING_MODE, temp | 0x02 );    // disable settle function after sensor enable
-  }
-  
+  flushWrites();  // send the whole sequence as auto-increment bursts, one bank at a time
+  return valid;
  }
 
 
-   void PAF9701::initAutoPowerSaveMode(bool detect3, uint32_t detectTime, bool settle_en)
+   bool PAF9701::initAutoPowerSaveMode(bool detect3, uint32_t detectTime, bool settle_en, uint8_t profile)
  {
   // initialize sensor to default values per 7.1.2 of the data sheet
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x7F, 0x00);  // select Bank 0
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x20, 0x79);  // Ta 2^7 samples, To 2^9 samples
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x21, 0x4E);  // 10 Hz, 97 ms conversion time
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x56, 0x33); 
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x1C, 0x03); 
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x79, 0x28); 
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x7A, 0x09); 
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x7F, 0x03);  // Bank 3
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x60, 0x48);  // 0.98 emmissivity
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x61, 0xE1); 
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x62, 0x7A); 
-  _i2c_bus->writeByte(PAF9701_ADDRESS, 0x63, 0x3F); 
+  bool valid = queueProfile(profile, 0x4E);  // 10 Hz in normal mode, slower if the profile needs it
+  queueWrite(0x00, 0x56, 0x33); 
+  queueWrite(0x00, 0x1C, 0x03); 
+  queueWrite(0x00, 0x79, 0x28); 
+  queueWrite(0x00, 0x7A, 0x09); 
+  queueFloat(0x03, PAF9701_EMISSIVITY_L, _emissivity);  // 0.98 emmissivity unless setEmissivity()
+  if(_decayTime > 0.0f) queueFloat(0x03, PAF9701_DECAY_TIME_L, _decayTime);
 
   // User-specified confguration
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x00);       // select Bank 0
-  
-  uint8_t temp = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_POWER_SAVING_MODE);
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_POWER_SAVING_MODE, temp | 0x10 ); // enable auto power save mode (bit 4)
+  // enable auto power save mode, settle function after sensor enable per settle_en, one write
+  queueUpdate(fieldAutoPowerSave.value(1) | fieldSettleDisable.value(!settle_en));
+  queueUpdate(fieldSkipMode.value(detect3));  // skip mode selects detect mode 3
 
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x04);       // select Bank 4
+  queueWrite(0x00, PAF9701_DET_TIME_L,  detectTime & 0xFF);  // select sample rate
+  queueWrite(0x00, PAF9701_DET_TIME_M, (detectTime >> 8) & 0xFF);  // select sample rate
+  queueWrite(0x00, PAF9701_DET_TIME_H, (detectTime >> 16) & 0x0F);  // select sample rate
 
-  temp = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_SKIP_MODE);
-  if(detect3) {
-    _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_SKIP_MODE,  temp | 0x01);  // select skip mode, enable detect mode 3
-  }
-  else {
-    _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_SKIP_MODE,  temp & ~(0x01));  // de-select skip mode, disable detect mode 3
-  }
+  queueAssign(fieldOneShot.value(0));  // disable one-shot mode
 
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x00);       // select Bank 0
+  flushWrites();  // send the whole sequence as auto-increment bursts, one bank at a time
+  return valid;
+ }
 
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_DET_TIME_L,  detectTime & 0xFF);  // select sample rate
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_DET_TIME_M, (detectTime >> 8) & 0xFF);  // select sample rate
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_DET_TIME_H, (detectTime >> 16) & 0x0F);  // select sample rate
 
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_ONE_SHOT_MODE, 0x00);  // disable one-shot mode
-  
-  temp = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_POWER_SAVING_MODE);
-  if(settle_en){
-    _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_POWER_SAVING_MODE, temp & ~(0x02) ); // enable settle function after sensor enable
-  }
-  else  {
-    _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_POWER_SAVING_MODE, temp | 0x02 );    // disable settle function after sensor enable
-  }
-  
- }
+bool PAF9701::setProfile(uint8_t profile, uint32_t sampleRate)
+{
+   bool valid = queueProfile(profile, sampleRate);
+   flushWrites();
+   return valid;
+}
+
+
+uint8_t PAF9701::getProfile()
+{
+   selectBank(0x00);       // select Bank 0
+   uint8_t burstNum = readReg(PAF9701_BURST_NUM_SEL);
+   for(uint8_t ii = 0; ii < sizeof(profileBurstNum); ii++) {
+     if(profileBurstNum[ii] == burstNum) return ii;
+   }
+   return 0xFF;
+}
+
+
+uint32_t PAF9701::minFramePeriod(uint8_t profile)
+{
+   if(profile >= sizeof(profileBurstNum)) profile = balancedProfile;
+   return (PAF9701_CONVERSION_US(profileBurstNum[profile]) + 1279) / 1280;   // whole 1.28 ms steps
+}
+
+
+static uint8_t addWrite(PAF9701_RegWrite * writes, uint8_t count, uint8_t bank, uint8_t reg, uint8_t data)
+{
+   writes[count].bank = bank;
+   writes[count].reg  = reg;
+   writes[count].data = data;
+   return count + 1;
+}
+
+
+// four bytes LSB first, as the emissivity and decay time registers take a float
+static uint8_t addFloat(PAF9701_RegWrite * writes, uint8_t count, uint8_t bank, uint8_t reg, float value)
+{
+   uint32_t bits;
+   memcpy(&bits, &value, 4);
+   for(uint8_t ii = 0; ii < 4; ii++) count = addWrite(writes, count, bank, reg + ii, (bits >> (8 * ii)) & 0xFF);
+   return count;
+}
+
+
+// BURST_NUM_SEL for profile and BURST_FRQ_SEL no shorter than its conversion, 4 writes, false when raised
+static bool profileWrites(PAF9701_RegWrite * writes, uint8_t profile, uint32_t sampleRate)
+{
+   if(profile >= sizeof(profileBurstNum)) profile = balancedProfile;
+   uint32_t minimum = (PAF9701_CONVERSION_US(profileBurstNum[profile]) + 1279) / 1280;
+   bool valid = sampleRate >= minimum;
+   if(!valid) sampleRate = minimum;
+   uint8_t n = addWrite(writes, 0, 0x00, PAF9701_BURST_NUM_SEL, profileBurstNum[profile]);
+   n = addWrite(writes, n, 0x00, PAF9701_BURST_FRQ_SEL_L,  sampleRate & 0xFF);         // select sample rate
+   n = addWrite(writes, n, 0x00, PAF9701_BURST_FRQ_SEL_M, (sampleRate >> 8) & 0xFF);
+   addWrite(writes, n, 0x00, PAF9701_BURST_FRQ_SEL_H, (sampleRate >> 16) & 0x0F);
+   return valid;
+}
+
+
+bool PAF9701::queueProfile(uint8_t profile, uint32_t sampleRate)
+{
+   PAF9701_RegWrite writes[4];
+   bool valid = profileWrites(writes, profile, sampleRate);
+   for(uint8_t ii = 0; ii < 4; ii++) queueWrite(writes[ii].bank, writes[ii].reg, writes[ii].data);
+   return valid;
+}
+
+
+/* Normal mode start-up
+ * The register values of initNormalMode(), shared with PAF9701Driver so both start the sensor
+ * the same way: the defaults per 7.1.2 of the data sheet, the profile, one-shot off, run mode,
+ * auto power save off with the settle bit per settle_en over powerSaving (the register's
+ * current value), then emissivity and, when set, decay time. They come out in bank and address
+ * order, so runs of consecutive registers can go out as one burst.
+ */
+uint8_t paf9701NormalModeWrites(PAF9701_RegWrite * writes, uint8_t runMode, uint32_t sampleRate, bool settle_en, uint8_t profile,
+                                float emissivity, float decayTime, uint8_t powerSaving, bool * valid)
+{
+   PAF9701_RegUpdate<0x00, PAF9701_POWER_SAVING_MODE> powerSave = fieldAutoPowerSave.value(0) | fieldSettleDisable.value(!settle_en);
+   uint8_t n = addWrite(writes, 0, 0x00, 0x1C, 0x03);
+   *valid = profileWrites(&writes[n], profile, sampleRate);  // samples per frame and sample rate, 0x20 - 0x23
+   n += 4;
+   n = addWrite(writes, n, 0x00, PAF9701_ONE_SHOT_MODE, 0x00);  // disable one-shot mode
+   n = addWrite(writes, n, 0x00, 0x56, 0x33);
+   n = addWrite(writes, n, 0x00, 0x79, 0x28);
+   n = addWrite(writes, n, 0x00, 0x7A, 0x09);
+   n = addWrite(writes, n, 0x00, PAF9701_OPERATION_MODE, runMode);  // select runMode
+   n = addWrite(writes, n, 0x00, PAF9701_POWER_SAVING_MODE, (powerSaving & ~powerSave.mask) | powerSave.bits);
+   n = addFloat(writes, n, 0x03, PAF9701_EMISSIVITY_L, emissivity);
+   if(decayTime > 0.0f) n = addFloat(writes, n, 0x03, PAF9701_DECAY_TIME_L, decayTime);
+   return n;
+}
+
+
+/* Detection tiers
+ * In auto power save mode the sensor drops from normal mode to detect mode 1 and then 2 after
+ * detectTime without an alert, reporting a frame every det1Period and det2Period, and an alert
+ * wakes it back to normal mode. Longer periods lower the average current and raise the wake-up
+ * latency by up to one period. With skip mode on (detect mode 3), an alert in detect mode 1 or 2
+ * wakes the sensor only when at least skip1Pixels or skip2Pixels pixels are in alert, so a few
+ * noisy pixels do not cost a run of full rate frames.
+ */
+void PAF9701::setDetectConfig(const PAF9701_DetectConfig * config)
+{
+   queueWrite(0x00, PAF9701_DET1_RPT_RATE_L,  config->det1Period & 0xFF);
+   queueWrite(0x00, PAF9701_DET1_RPT_RATE_M, (config->det1Period >> 8) & 0xFF);
+   queueWrite(0x00, PAF9701_DET1_RPT_RATE_H, (config->det1Period >> 16) & 0x0F);
+   queueWrite(0x00, PAF9701_DET2_RPT_RATE_L,  config->det2Period & 0xFF);
+   queueWrite(0x00, PAF9701_DET2_RPT_RATE_M, (config->det2Period >> 8) & 0xFF);
+   queueWrite(0x00, PAF9701_DET2_RPT_RATE_H, (config->det2Period >> 16) & 0x0F);
+   queueWrite(0x00, PAF9701_DET_TIME_L,  config->detectTime & 0xFF);
+   queueWrite(0x00, PAF9701_DET_TIME_M, (config->detectTime >> 8) & 0xFF);
+   queueWrite(0x00, PAF9701_DET_TIME_H, (config->detectTime >> 16) & 0x0F);
+   queueWrite(0x01, PAF9701_TO_SKIP1_PIXEL_THRESHOLD, config->skip1Pixels);
+   queueWrite(0x01, PAF9701_TO_SKIP2_PIXEL_THRESHOLD, config->skip2Pixels);
+   queueUpdate(fieldSkipMode.value(config->skipMode));
+   flushWrites();  // DET1, DET2 and DET_TIME go out as one 9 byte burst
+}
+
+
+void PAF9701::getDetectConfig(PAF9701_DetectConfig * config)
+{
+   uint8_t rawData[9];
+   selectBank(0x00);       // select Bank 0
+   readRegs(PAF9701_DET1_RPT_RATE_L, 9, &rawData[0]);   // DET1_RPT_RATE, DET2_RPT_RATE, DET_TIME
+   config->det1Period = (uint32_t) (rawData[2] & 0x0F) << 16 | (uint32_t) rawData[1] << 8 | rawData[0];
+   config->det2Period = (uint32_t) (rawData[5] & 0x0F) << 16 | (uint32_t) rawData[4] << 8 | rawData[3];
+   config->detectTime = (uint32_t) (rawData[8] & 0x0F) << 16 | (uint32_t) rawData[7] << 8 | rawData[6];
+   selectBank(0x01);       // select Bank 1
+   readRegs(PAF9701_TO_SKIP1_PIXEL_THRESHOLD, 2, &rawData[0]);
+   config->skip1Pixels = rawData[0];
+   config->skip2Pixels = rawData[1];
+   selectBank(0x04);       // select Bank 4
+   readRegs(PAF9701_SKIP_MODE, 1, &rawData[0]);
+   config->skipMode = rawData[0] & 0x01;
+}
+
+
+bool PAF9701::verifyDetectConfig(const PAF9701_DetectConfig * config)
+{
+   PAF9701_DetectConfig actual;
+   getDetectConfig(&actual);
+   bool match = actual.det1Period == (config->det1Period & 0xFFFFF) && actual.det2Period == (config->det2Period & 0xFFFFF) &&
+                actual.detectTime == (config->detectTime & 0xFFFFF) && actual.skip1Pixels == config->skip1Pixels &&
+                actual.skip2Pixels == config->skip2Pixels && actual.skipMode == config->skipMode;
+   if(!match) invalidateCache();   // the shadow no longer matches the sensor
+   return match;
+}
 
 
   void PAF9701::suspendOperation()
  {
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x00);       // select Bank 0
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_OUTPUT_ENABLE, 0x00); 
+  selectBank(0x00);       // select Bank 0
+  writeReg(PAF9701_OUTPUT_ENABLE, 0x00); 
  }
 
 
   void PAF9701::resumeOperation()
  {
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x00);       // select Bank 0
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_OUTPUT_ENABLE, 0x01); 
+  selectBank(0x00);       // select Bank 0
+  writeReg(PAF9701_OUTPUT_ENABLE, 0x01); 
+ }
+
+
+/* One-shot capture
+ * With bit 0 of ONE_SHOT_MODE set, setting OUTPUT_ENABLE starts a single conversion; the sensor
+ * publishes one frame, sets Frame_Update_flag (and INT in frameUpdateAlert mode) and clears
+ * OUTPUT_ENABLE again, so between captures it draws suspend current and the bus stays quiet.
+ * triggerOneShot() sets OUTPUT_ENABLE and clears the last frame's flag in STATUS_FLAG, the next
+ * register, in one write. awaitFrame() waits for the flag either on intFlag, set by the caller's
+ * INT handler, napping a millisecond at a time, or by sleeping the conversion time of
+ * BURST_NUM_SEL (from the shadow; BURST_FRQ_SEL only spaces free running frames) and then
+ * polling the status every millisecond. It then reads the frame, reusing the status byte that
+ * ended the poll. No second frame can land during the read, so snapshot reads are skipped. On
+ * intFlag it releases INT right away; polling leaves the flag for the next trigger to clear, so
+ * a polled capture costs the bus one write less than a free running frame read. Loops that must
+ * not block use the acquisition engine (startAcquisition() / serviceAcquisition()) on the INT
+ * edge instead.
+ */
+  void PAF9701::beginOneShot()
+ {
+  selectBank(0x00);       // select Bank 0
+  writeReg(PAF9701_OUTPUT_ENABLE, 0x00);   // suspend
+  writeReg(PAF9701_ONE_SHOT_MODE, 0x01);   // enable one-shot mode
+  writeReg(PAF9701_STATUS_FLAG, 0x80);     // clear Frame_Update_flag
+ }
+
+
+  void PAF9701::triggerOneShot()
+ {
+  uint8_t data[2] = {0x01, 0x80};   // OUTPUT_ENABLE: one conversion, clears itself; STATUS_FLAG: clear Frame_Update_flag
+  selectBank(0x00);       // select Bank 0
+  writeRegs(PAF9701_OUTPUT_ENABLE, 2, data);
+ }
+
+
+ bool PAF9701::awaitFrame(PAF9701_Frame * frame, uint32_t timeout, volatile bool * intFlag)
+{
+   uint32_t start = millis();
+   uint8_t * rawData = (uint8_t *) frame->pixels;
+   bool statusRead = false;
+   if(intFlag) {
+     while(!*intFlag) {
+       if(millis() - start >= timeout) return false;
+       delay(1);               // sleeps until the next tick, the edge sets the flag meanwhile
+     }
+     *intFlag = false;
+   }
+   else {
+     selectBank(0x00);       // select Bank 0
+     uint32_t conversion = (PAF9701_CONVERSION_US(readReg(PAF9701_BURST_NUM_SEL)) + 999) / 1000;   // ms
+     delay(conversion < timeout ? conversion : timeout);
+     while(!((frame->status = getStatus()) & 0x10)) {
+       if(millis() - start >= timeout) return false;
+       delay(1);
+     }
+     statusRead = true;      // the status the poll just read, not read again
+   }
+   uint8_t retries = _snapshotRetries;
+   _snapshotRetries = 0;     // one conversion, the frame cannot change under the read
+   readPixelBanks(rawData, &frame->alertMask, &frame->status, statusRead);
+   _snapshotRetries = retries;
+   maskWindow(rawData);
+   unpackPixels(frame->pixels);
+   frame->windowMask = _windowMask;
+   if(intFlag) clearInterrupt();   // release INT, polling leaves it to triggerOneShot()
+   return true;
+}
+
+
+  void PAF9701::endOneShot()
+ {
+  selectBank(0x00);       // select Bank 0
+  writeReg(PAF9701_ONE_SHOT_MODE, 0x00);   // disable one-shot mode
  }
 
 
   void PAF9701::clearInterrupt()
  {
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x00);       // select Bank 0
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_STATUS_FLAG, 0x80);       // clear Frame_Update_flag
+  selectBank(0x00);       // select Bank 0
+  writeReg(PAF9701_STATUS_FLAG, 0x80);       // clear Frame_Update_flag
  }
 
 
   uint8_t PAF9701::getStatus()
  {
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x00);       // select Bank 0
-  uint8_t temp = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_STATUS_FLAG);  // read status register
+  selectBank(0x00);       // select Bank 0
+  uint8_t temp = readReg(PAF9701_STATUS_FLAG);  // read status register
   return temp;
  }
 
  
   void PAF9701::imageOrientation(uint8_t imageFlip, uint8_t imageRotate)
  {
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x03);       // select Bank 3
   // flip and rotate image
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_ORIENTATION, imageFlip << 2 | imageRotate);  // re-orient image frame
+  queueAssign(fieldImageFlip.value(imageFlip) | fieldImageRotate.value(imageRotate));  // re-orient image frame
+  flushWrites();
  }
 
 
   int16_t PAF9701::getRawTaData()
  {
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x00);       // select Bank 0
+  selectBank(0x00);       // select Bank 0
   // software reset the PAF9701, preserve register settings
-  uint8_t temp1 = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_DSP_TO_DATA_L);  // read LSB register
-  uint8_t temp2 = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_DSP_TO_DATA_H);  // read MSB register
+  uint8_t temp1 = readReg(PAF9701_DSP_TO_DATA_L);  // read LSB register
+  uint8_t temp2 = readReg(PAF9701_DSP_TO_DATA_H);  // read MSB register
   return ( ((int16_t) temp2 << 8) | temp1);
  }
 
 
   int16_t PAF9701::getCalTaData()
  {
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x00);       // select Bank 0
+  selectBank(0x00);       // select Bank 0
   // software reset the PAF9701, preserve register settings
-  uint8_t temp1 = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_CAL_TO_DATA_L);  // read LSB register
-  uint8_t temp2 = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_CAL_TO_DATA_H);  // read MSB register
+  uint8_t temp1 = readReg(PAF9701_CAL_TO_DATA_L);  // read LSB register
+  uint8_t temp2 = readReg(PAF9701_CAL_TO_DATA_H);  // read MSB register
   return ( ((int16_t) temp2 << 8) | temp1);
  }
 
  
+/* Emissivity and decay time
+ * Bank 3 holds both as IEEE-754 single precision floats, LSB first (0.98 is 0x3F7AE148). Each
+ * goes out as one four byte burst and applies from the next frame, so switching between skin
+ * (about 0.98) and bare metal (0.1 - 0.3) needs no re-init and no settle delay. warmReset()
+ * keeps the registers; the values are also kept here so the init functions after a coldReset()
+ * write them again instead of the data sheet defaults.
+ */
+bool PAF9701::setEmissivity(float emissivity)
+{
+   if(!(emissivity > 0.0f && emissivity <= 1.0f)) return false;
+   _emissivity = emissivity;
+   queueFloat(0x03, PAF9701_EMISSIVITY_L, emissivity);
+   flushWrites();
+   return true;
+}
+
+
+float PAF9701::getEmissivity()
+{
+   selectBank(0x03);       // select Bank 3
+   return readFloat(PAF9701_EMISSIVITY_L);
+}
+
+
+bool PAF9701::setDecayTime(float decayTime)
+{
+   if(!(decayTime > 0.0f)) return false;
+   _decayTime = decayTime;
+   queueFloat(0x03, PAF9701_DECAY_TIME_L, decayTime);
+   flushWrites();
+   return true;
+}
+
+
+float PAF9701::getDecayTime()
+{
+   selectBank(0x03);       // select Bank 3
+   return readFloat(PAF9701_DECAY_TIME_L);
+}
+
+
+void PAF9701::queueFloat(uint8_t bank, uint8_t reg, float value)
+{
+   uint32_t bits;
+   memcpy(&bits, &value, 4);
+   for(uint8_t ii = 0; ii < 4; ii++) queueWrite(bank, reg + ii, (bits >> (8 * ii)) & 0xFF);
+}
+
+
+// four bytes in one read from the sensor, not the shadow
+float PAF9701::readFloat(uint8_t reg)
+{
+   uint8_t rawData[4];
+   readRegs(reg, 4, &rawData[0]);
+   uint32_t bits = (uint32_t) rawData[3] << 24 | (uint32_t) rawData[2] << 16 | (uint32_t) rawData[1] << 8 | rawData[0];
+   float value;
+   memcpy(&value, &bits, 4);
+   return value;
+}
+
+
   uint8_t PAF9701::getPowerSaveMode()
  {
- _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x00);       // select Bank 0
- uint8_t temp = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_POWER_SAVING_MODE);
+ selectBank(0x00);       // select Bank 0
+ uint8_t temp;
+ readRegs(PAF9701_POWER_SAVING_MODE, 1, &temp);   // from the sensor, a readback check of the configuration
  return temp;
  }
 
 
- void PAF9701::getToData(float * temperatures)
+ bool PAF9701::getToData(float * temperatures)
  {
   uint8_t rawData[128];
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x04);       // select Bank 4
-  _i2c_bus->readBytes(PAF9701_ADDRESS, PAF9701_TO_PIXEL_0_DATA_L, 64, &rawData[0]);
-  for(uint16_t ii = 0; ii < 32; ii++) {
-    temperatures[ii] = (float) ((int16_t) ( (int16_t) rawData[2*ii + 1] << 8) | rawData[2*ii]);
-    temperatures[ii] *=0.0625f; // scale to get temperatures in degrees C
-  }
-  
-  _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x05);       // select Bank 5
-  _i2c_bus->readBytes(PAF9701_ADDRESS, PAF9701_TO_PIXEL_32_DATA_L, 64, &rawData[64]);
-  for(uint16_t ii = 32; ii < 64; ii++) {
+  bool whole = readPixelBanks(rawData, NULL, NULL);
+  maskWindow(rawData);
+  for(uint16_t ii = 0; ii < 64; ii++) {
     temperatures[ii] = (float) ((int16_t) ( (int16_t) rawData[2*ii + 1] << 8) | rawData[2*ii]);
     temperatures[ii] *=0.0625f; // scale to get temperatures in degrees C
   }
+  return whole;
+ }
+
+
+ bool PAF9701::getToDataRaw(int16_t * temperatures)
+ {
+  // object temperatures in 1/16 C, the pixel bytes are read straight into the output array
+  uint8_t * rawData = (uint8_t *) temperatures;
+  bool whole = readPixelBanks(rawData, NULL, NULL);
+  maskWindow(rawData);
+  unpackPixels(temperatures);
+  return whole;
  }
 
 
  void PAF9701::setFilter(uint8_t digitalFilter, uint8_t frameAverage, uint8_t IIRAverage)
  {
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x00);       // select Bank 0
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_FILTER_SEL, frameAverage << 5 | digitalFilter <<  3 | IIRAverage);        
+   queueAssign(fieldFrameAverage.value(frameAverage) | fieldDigitalFilter.value(digitalFilter) | fieldIIRAverage.value(IIRAverage));
+   flushWrites();
  }
 
 
   void PAF9701::setAlertMode(uint8_t normalModeAlert, uint8_t det123ModeAlert)
  {
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x00);       // select Bank 0
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_ALERT_MODE, normalModeAlert << 2 | det123ModeAlert);        
+   queueAssign(fieldNormalAlertMode.value(normalModeAlert) | fieldDet123AlertMode.value(det123ModeAlert));
+   flushWrites();
  }
  
 
+  void PAF9701::setInterruptOpenDrain(bool openDrain)
+ {
+   queueAssign(fieldOpenDrain.value(openDrain));  // INT push pull (default) or open drain
+   flushWrites();
+ }
+
+
  void PAF9701::setNormalAlertLimits(int16_t TaLow, int16_t TaHigh, uint8_t TaHyst, int16_t ToLow, int16_t ToHigh, int8_t ToHyst, uint8_t pixels)
 {
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x01);       // select Bank 1
-   
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_TA_LOW_LIMIT_L,  TaLow & 0x00FF);           // LSB only
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_TA_LOW_LIMIT_H, (TaLow & 0x0700) >> 8);     // upper first 3 bits only     
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_TA_HIGH_LIMIT_L,  TaHigh & 0x00FF);         // LSB only
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_TA_HIGH_LIMIT_H, (TaHigh & 0x0700) >> 8);   // upper first 3 bits only     
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_TO_LOW_LIMIT_L,  ToLow & 0x00FF);           // LSB only
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_TO_LOW_LIMIT_H, (ToLow & 0x0700) >> 8);     // upper first 3 bits only     
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_TO_HIGH_LIMIT_L,  ToHigh & 0x00FF);         // LSB only
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_TO_HIGH_LIMIT_H, (ToHigh & 0x0700) >> 8);   // upper first 3 bits only     
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_TA_HYSTERESIS, TaHyst);          
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_TO_HYSTERESIS, ToHyst);   
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_TO_PIXEL_THRESHOLD, pixels);   
+   queueWrite(0x01, PAF9701_TA_LOW_LIMIT_L,  TaLow & 0x00FF);           // LSB only
+   queueAssign(fieldTaLowLimitH.value(TaLow >> 8));     // upper first 3 bits only     
+   queueWrite(0x01, PAF9701_TA_HIGH_LIMIT_L,  TaHigh & 0x00FF);         // LSB only
+   queueAssign(fieldTaHighLimitH.value(TaHigh >> 8));   // upper first 3 bits only     
+   queueWrite(0x01, PAF9701_TO_LOW_LIMIT_L,  ToLow & 0x00FF);           // LSB only
+   queueAssign(fieldToLowLimitH.value(ToLow >> 8));     // upper first 3 bits only     
+   queueWrite(0x01, PAF9701_TO_HIGH_LIMIT_L,  ToHigh & 0x00FF);         // LSB only
+   queueAssign(fieldToHighLimitH.value(ToHigh >> 8));   // upper first 3 bits only     
+   queueWrite(0x01, PAF9701_TA_HYSTERESIS, TaHyst);          
+   queueWrite(0x01, PAF9701_TO_HYSTERESIS, ToHyst);   
+   queueWrite(0x01, PAF9701_TO_PIXEL_THRESHOLD, pixels);   
+   flushWrites();  // limits and hystereses go out as one burst, pixel threshold as a second
 }
 
 
  void PAF9701::setDet123AlertLimits(int16_t TaLow, int16_t TaHigh, uint8_t TaHyst, int16_t ToLow, int16_t ToHigh, int8_t ToHyst, uint8_t pixels)
 {
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x01);       // select Bank 1
-   
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_DET_TA_LOW_LIMIT_L,  TaLow & 0x00FF);           // LSB only
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_DET_TA_LOW_LIMIT_H, (TaLow & 0x0700) >> 8);     // upper first 3 bits only     
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_DET_TA_HIGH_LIMIT_L,  TaHigh & 0x00FF);         // LSB only
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_DET_TA_HIGH_LIMIT_H, (TaHigh & 0x0700) >> 8);   // upper first 3 bits only     
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_DET_TO_LOW_LIMIT_L,  ToLow & 0x00FF);           // LSB only
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_DET_TO_LOW_LIMIT_H, (ToLow & 0x0700) >> 8);     // upper first 3 bits only     
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_DET_TO_HIGH_LIMIT_L,  ToHigh & 0x00FF);         // LSB only
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_DET_TO_HIGH_LIMIT_H, (ToHigh & 0x0700) >> 8);   // upper first 3 bits only     
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_DET_TA_HYSTERESIS, TaHyst);          
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_DET_TO_HYSTERESIS, ToHyst);   
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_DET_TO_PIXEL_THRESHOLD, pixels);   
+   queueWrite(0x01, PAF9701_DET_TA_LOW_LIMIT_L,  TaLow & 0x00FF);           // LSB only
+   queueAssign(fieldDetTaLowLimitH.value(TaLow >> 8));     // upper first 3 bits only     
+   queueWrite(0x01, PAF9701_DET_TA_HIGH_LIMIT_L,  TaHigh & 0x00FF);         // LSB only
+   queueAssign(fieldDetTaHighLimitH.value(TaHigh >> 8));   // upper first 3 bits only     
+   queueWrite(0x01, PAF9701_DET_TO_LOW_LIMIT_L,  ToLow & 0x00FF);           // LSB only
+   queueAssign(fieldDetToLowLimitH.value(ToLow >> 8));     // upper first 3 bits only     
+   queueWrite(0x01, PAF9701_DET_TO_HIGH_LIMIT_L,  ToHigh & 0x00FF);         // LSB only
+   queueAssign(fieldDetToHighLimitH.value(ToHigh >> 8));   // upper first 3 bits only     
+   queueWrite(0x01, PAF9701_DET_TA_HYSTERESIS, TaHyst);          
+   queueWrite(0x01, PAF9701_DET_TO_HYSTERESIS, ToHyst);   
+   queueWrite(0x01, PAF9701_DET_TO_PIXEL_THRESHOLD, pixels);   
+   flushWrites();  // limits and hystereses go out as one burst, pixel threshold as a second
 }
 
 
  void PAF9701::getNormalAlertLimits(int16_t * output)
 {
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x01);       // select Bank 1
+   selectBank(0x01);       // select Bank 1
 
-   uint8_t rawData[2] = {0, 0};
-   rawData[0] = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_TA_LOW_LIMIT_L);      
-   rawData[1] = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_TA_LOW_LIMIT_H);  
-   output[0] = (int16_t) (rawData[1] << 8) | rawData[0]; 
-   rawData[0] = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_TA_HIGH_LIMIT_L);      
-   rawData[1] = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_TA_HIGH_LIMIT_H);  
-   output[1] = (int16_t) (rawData[1] << 8) | rawData[0]; 
-   rawData[0] = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_TO_LOW_LIMIT_L);      
-   rawData[1] = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_TO_LOW_LIMIT_H);  
-   output[2] = (int16_t) (rawData[1] << 8) | rawData[0]; 
-   rawData[0] = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_TO_HIGH_LIMIT_L);      
-   rawData[1] = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_TO_HIGH_LIMIT_H);  
-   output[3] = (int16_t) (rawData[1] << 8) | rawData[0]; 
-   output[4] = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_TA_HYSTERESIS); 
-   output[5] = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_TO_HYSTERESIS); 
-   output[6] = _i2c_bus->readByte(PAF9701_ADDRESS, PAF9701_TO_PIXEL_THRESHOLD); 
+   // from the sensor, not the shadow, so a lost write or a sensor reset shows
+   uint8_t rawData[10];
+   readRegs(PAF9701_TA_HIGH_LIMIT_L, 10, &rawData[0]);   // limits and hysteresis, 0x52 - 0x5B
+   output[0] = (int16_t) (rawData[3] << 8) | rawData[2];  // Ta low
+   output[1] = (int16_t) (rawData[1] << 8) | rawData[0];  // Ta high
+   output[2] = (int16_t) (rawData[7] << 8) | rawData[6];  // To low
+   output[3] = (int16_t) (rawData[5] << 8) | rawData[4];  // To high
+   output[4] = rawData[8];
+   output[5] = rawData[9];
+   uint8_t pixels;
+   readRegs(PAF9701_TO_PIXEL_THRESHOLD, 1, &pixels);
+   output[6] = pixels;
+}
+
+
+uint64_t PAF9701::getAlertPixels()
+{
+   selectBank(0x04);       // select Bank 4
+
+   uint8_t rawData[8];
+   readRegs(PAF9701_TO_ALERT_FLAG_0_7, 8, &rawData[0]);  // all eight flag bytes in one burst
+   uint64_t mask = 0;
+   for(uint8_t ii = 0; ii < 8; ii++) mask |= (uint64_t) rawData[ii] << (8 * ii);
+   return mask;
 }
 
 
 void PAF9701::getAlertPixels(uint32_t * alertPixels)
 {
-   _i2c_bus->writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x04);       // select Bank 4
+   uint64_t mask = getAlertPixels();
+   alertPixels[0] = (uint32_t) mask;
+   alertPixels[1] = (uint32_t) (mask >> 32);
+}
+
 
-   uint8_t rawData[4] = {0, 0, 0, 0};
-   _i2c_bus->readBytes(PAF9701_ADDRESS, PAF9701_TO_ALERT_FLAG_0_7, 4, &rawData[0]); 
-   alertPixels[0] = ((uint32_t) rawData[3] << 24) | ((uint32_t) rawData[2] << 16) | ((uint32_t) rawData[1] << 8) | rawData[0];
-   _i2c_bus->readBytes(PAF9701_ADDRESS, PAF9701_TO_ALERT_FLAG_32_39, 4, &rawData[0]); 
-   alertPixels[1] = ((uint32_t) rawData[3] << 24) | ((uint32_t) rawData[2] << 16) | ((uint32_t) rawData[1] << 8) | rawData[0];
+bool PAF9701::readFrame(PAF9701_Frame * frame)
+{
+   uint8_t * rawData = (uint8_t *) frame->pixels;
+   bool whole = readPixelBanks(rawData, &frame->alertMask, &frame->status);
+   maskWindow(rawData);
+   unpackPixels(frame->pixels);
+   frame->windowMask = _windowMask;
+   return whole;
 }
 
- 
+
+void PAF9701::setSnapshotRead(uint8_t retries)
+{
+   _snapshotRetries = retries;
+}
+
+
+/* Window of interest
+ * Programs the P0 window (P0_WOI_V rows, P0_WOI_H columns, first in the high nibble and last in
+ * the low nibble, enabled by bit 0 of P0_SELECT) and limits the frame reads to the window rows.
+ * Rows are read as whole 16 byte runs, one burst per bank, since a burst per row would cost more
+ * in START, address and register bytes than the columns it skips; the columns outside the window
+ * are zeroed in the frame instead. For a vertical band, rotate the image with imageOrientation()
+ * so the band runs along rows.
+ */
+void PAF9701::setWindow(uint8_t firstRow, uint8_t lastRow, uint8_t firstColumn, uint8_t lastColumn)
+{
+   if(lastRow > 7) lastRow = 7;
+   if(lastColumn > 7) lastColumn = 7;
+   if(firstRow > lastRow) firstRow = lastRow;
+   if(firstColumn > lastColumn) firstColumn = lastColumn;
+   queueAssign(fieldWindowEnable.value(1));
+   queueAssign(fieldWindowFirstRow.value(firstRow) | fieldWindowLastRow.value(lastRow));
+   queueAssign(fieldWindowFirstColumn.value(firstColumn) | fieldWindowLastColumn.value(lastColumn));
+   flushWrites();
+   _firstRow = firstRow;
+   _lastRow = lastRow;
+   uint8_t columns = (uint8_t) ((0xFF >> (7 - lastColumn)) & (0xFF << firstColumn));
+   _windowMask = 0;
+   for(uint8_t row = firstRow; row <= lastRow; row++) _windowMask |= (uint64_t) columns << (8 * row);
+}
+
+
+void PAF9701::clearWindow()
+{
+   queueAssign(fieldWindowEnable.value(0));
+   flushWrites();
+   _firstRow = 0;
+   _lastRow = 7;
+   _windowMask = ~(uint64_t) 0;
+}
+
+
+uint64_t PAF9701::getWindowMask()
+{
+   return _windowMask;
+}
+
+
+/* Pixel bank reads
+ * Pixels 0 - 31 are in bank 4 and pixels 32 - 63 in bank 5, so a frame takes two bursts and the
+ * sensor can publish a new frame in between. In snapshot mode the Frame_Update flag (status bit 4)
+ * is cleared before the bursts and read back after them; if it is set again the two halves may
+ * come from different frames and the read is repeated, up to _snapshotRetries times. Returns false
+ * when the last attempt was still torn. Clearing the flag also releases the interrupt, so callers
+ * in snapshot mode need not call clearInterrupt().
+ *
+ * Bank 4 holds pixels 0 - 31 at 0x00 - 0x3F directly followed by the alert flags at 0x40 - 0x47,
+ * so with alertMask one burst from the first window row up to 0x47 gets both. The flag bytes land
+ * in rawData[64..71] and are moved out before the bank 5 burst overwrites them. Only the window
+ * rows are read; bytes of the other rows are left as they were.
+ */
+bool PAF9701::readPixelBanks(uint8_t * rawData, uint64_t * alertMask, uint8_t * status, bool statusRead)
+{
+   uint8_t tries = 0;
+   if(!status) statusRead = false;
+   if(status && !statusRead) *status = 0;
+   while(true) {
+     if(status || _snapshotRetries) {
+       selectBank(0x00);       // select Bank 0
+       if(!statusRead) {
+         uint8_t temp = readReg(PAF9701_STATUS_FLAG);
+         if(status) *status |= temp;  // keep alert flags seen on earlier attempts
+       }
+       statusRead = false;     // a retry reads it again
+       if(_snapshotRetries) writeReg(PAF9701_STATUS_FLAG, 0x80);  // clear Frame_Update_flag
+     }
+     readBank4(rawData, alertMask);
+     readBank5(rawData);
+     if(!_snapshotRetries) return true;
+
+     selectBank(0x00);       // select Bank 0
+     if(!(readReg(PAF9701_STATUS_FLAG) & 0x10)) return true;  // no new frame during the read
+     if(tries++ == _snapshotRetries) {
+       _stats.tornFrames++;
+       return false;
+     }
+     _stats.snapshotRetries++;
+   }
+}
+
+
+void PAF9701::readBank4(uint8_t * rawData, uint64_t * alertMask)
+{
+   uint8_t first = _firstRow * 16;       // rows are 16 bytes
+   uint8_t end = alertMask ? 72 : (_lastRow < 3 ? _lastRow + 1 : 4) * 16;
+   if(_firstRow > 3) first = alertMask ? 64 : end;   // no window rows in this bank
+   if(first < end) {
+     selectBank(0x04);       // select Bank 4
+     readRegs(PAF9701_TO_PIXEL_0_DATA_L + first, end - first, &rawData[first]);
+   }
+   if(alertMask) {
+     *alertMask = 0;
+     for(uint8_t ii = 0; ii < 8; ii++) {
+       *alertMask |= (uint64_t) rawData[64 + ii] << (8 * ii);
+     }
+   }
+}
+
+
+void PAF9701::readBank5(uint8_t * rawData)
+{
+   if(_lastRow < 4) return;              // no window rows in this bank
+   uint8_t first = (_firstRow > 4 ? _firstRow - 4 : 0) * 16;
+   uint8_t end = (_lastRow - 3) * 16;
+   selectBank(0x05);       // select Bank 5
+   readRegs(PAF9701_TO_PIXEL_32_DATA_L + first, end - first, &rawData[64 + first]);
+}
+
+
+void PAF9701::maskWindow(uint8_t * rawData)
+{
+   if(_windowMask == ~(uint64_t) 0) return;
+   for(uint8_t ii = 0; ii < 64; ii++) {
+     if(!(_windowMask & ((uint64_t) 1 << ii))) {
+       rawData[2*ii] = 0;
+       rawData[2*ii + 1] = 0;
+     }
+   }
+}
+
+
+/* Frame acquisition
+ * startAcquisition() only notes the INT edge, so it is safe in an interrupt handler.
+ * serviceAcquisition() then walks the frame read one bus transaction per call (status, bank 4
+ * with the alert flags, bank 5, clear or torn check) so loop() can render between steps, and calls
+ * the callback with the finished frame. An INT edge during an acquisition counts as an overrun
+ * and starts the next one as soon as the current frame is delivered.
+ *
+ * With a PAF9701FrameRing each frame is read straight into the ring's next free slot and
+ * published there, so the frame being rendered is never overwritten.
+ */
+void PAF9701::beginAcquisition(PAF9701_Frame * frame, PAF9701_FrameCallback callback)
+{
+   _acqFrame = frame;
+   _acqRing = NULL;
+   _acqCallback = callback;
+   _acqPending = false;
+   _acqState = acqIdle;
+}
+
+
+void PAF9701::beginAcquisition(PAF9701FrameRing * ring, PAF9701_FrameCallback callback)
+{
+   beginAcquisition(ring->producerSlot(), callback);
+   _acqRing = ring;
+}
+
+
+void PAF9701::startAcquisition()
+{
+   startAcquisition(micros());
+}
+
+
+void PAF9701::startAcquisition(uint32_t edge)
+{
+   if(_acqPending || _acqState != acqIdle) _acqOverruns++;
+   _acqEdge = edge;
+   _acqPending = true;
+}
+
+
+bool PAF9701::acquisitionBusy()
+{
+   return _acqPending || _acqState != acqIdle;
+}
+
+
+PAF9701_Frame * PAF9701::lastFrame()
+{
+   return _acqFrame;
+}
+
+
+bool PAF9701::serviceAcquisition()
+{
+   switch(_acqState) {
+     case acqIdle:
+       if(!_acqPending) return false;
+       if(_acqRing) _acqFrame = _acqRing->producerSlot();
+       if(_acqFrame == NULL) return false;   // nothing to read into, see beginAcquisition()
+       _acqPending = false;    // before taking the edge time so a new edge is never lost
+       _acqStart = _acqEdge;
+       _acqTries = 0;
+       _acqFrame->status = 0;
+       _acqState = acqStatus;
+       // fall through - the status read is the first step
+
+     case acqStatus:
+       selectBank(0x00);       // select Bank 0
+       _acqFrame->status |= readReg(PAF9701_STATUS_FLAG);
+       if(_snapshotRetries) writeReg(PAF9701_STATUS_FLAG, 0x80);  // clear Frame_Update_flag
+       _acqState = acqBank4;
+       return false;
+
+     case acqBank4:
+       readBank4((uint8_t *) _acqFrame->pixels, &_acqFrame->alertMask);
+       _acqState = _lastRow > 3 ? acqBank5 : acqFinish;   // skip bank 5 when the window ends above it
+       return false;
+
+     case acqBank5:
+       readBank5((uint8_t *) _acqFrame->pixels);
+       _acqState = acqFinish;
+       return false;
+
+     case acqFinish:
+       selectBank(0x00);       // select Bank 0
+       if(!_snapshotRetries) {
+         writeReg(PAF9701_STATUS_FLAG, 0x80);  // clear Frame_Update_flag
+       }
+       else if(readReg(PAF9701_STATUS_FLAG) & 0x10) {  // new frame during the read
+         if(_acqTries++ < _snapshotRetries) {
+           _stats.snapshotRetries++;
+           _acqState = acqStatus;
+           return false;
+         }
+         _stats.tornFrames++;
+       }
+       break;
+   }
+
+   maskWindow((uint8_t *) _acqFrame->pixels);
+   unpackPixels(_acqFrame->pixels);
+   _acqFrame->windowMask = _windowMask;
+   _acqFrame->timestamp = _acqStart;
+   if(_acqRing) _acqRing->publish();
+   _acqState = acqIdle;
+   uint32_t latency = micros() - _acqStart;
+   _acqStats.frames++;
+   _acqStats.lastLatency = latency;
+   if(latency > _acqStats.maxLatency) _acqStats.maxLatency = latency;
+   _acqStats.totalLatency += latency;
+   if(_acqCallback) _acqCallback(_acqFrame);
+   return true;
+}
+
+
+void PAF9701::getAcquisitionStats(PAF9701_AcqStats * stats)
+{
+   *stats = _acqStats;
+   stats->overruns = _acqOverruns;
+}
+
+
+void PAF9701::resetAcquisitionStats()
+{
+   memset(&_acqStats, 0, sizeof(_acqStats));
+   _acqOverruns = 0;
+}
+
+
+void PAF9701::invalidateCache()
+{
+   _bank = PAF9701_BANK_UNKNOWN;
+   memset(_shadowValid, 0, sizeof(_shadowValid));
+}
+
+
+void PAF9701::getBusStats(PAF9701_BusStats * stats)
+{
+   *stats = _stats;
+}
+
+
+void PAF9701::resetBusStats()
+{
+   memset(&_stats, 0, sizeof(_stats));
+}
+
+
+/* Write batching
+ * Queued writes are sorted by bank (the currently selected bank first) and by address, repeated
+ * writes to a register keep the last value, and runs of consecutive addresses go out as single
+ * auto-increment writeBytes() bursts. Only meant for configuration registers: do not queue
+ * STATUS_FLAG, HOST_RSTB or OUTPUT_ENABLE, whose write order matters.
+*/
+void PAF9701::queueWrite(uint8_t bank, uint8_t reg, uint8_t data)
+{
+   if(_batchCount == PAF9701_BATCH_SIZE) flushWrites();
+   _batch[_batchCount].bank = bank;
+   _batch[_batchCount].reg  = reg;
+   _batch[_batchCount].data = data;
+   _batchCount++;
+   int16_t index = shadowIndex(bank, reg);  // later read-modify-writes see the queued value
+   if(index >= 0) {
+     _shadow[index] = data;
+     _shadowValid[index >> 3] |= (1 << (index & 7));
+   }
+}
+
+
+
+/* Field updates, see PAF9701Fields.h
+ * Queue one write of reg with the bits in mask replaced; the rest of the register comes from
+ * the shadow, so it is read from the sensor at most once and not at all when mask covers it.
+*/
+void PAF9701::queueFields(uint8_t bank, uint8_t reg, uint8_t mask, uint8_t bits)
+{
+   if(mask != 0xFF) bits = (readFields(bank, reg) & ~mask) | (bits & mask);
+   queueWrite(bank, reg, bits);
+}
+
+
+uint8_t PAF9701::readFields(uint8_t bank, uint8_t reg)
+{
+   int16_t index = shadowIndex(bank, reg);
+   if(index >= 0 && (_shadowValid[index >> 3] & (1 << (index & 7)))) {
+     _stats.readsSaved++;    // no bank select either
+     return _shadow[index];
+   }
+   selectBank(bank);
+   return readReg(reg);
+}
+uint8_t PAF9701::flushWrites()
+{
+   if(_batchCount == 0) return 0;
+
+   // cost of sending the queue one register at a time, in order
+   uint16_t naive = 0;
+   uint8_t bank = _bank;
+   for(uint8_t ii = 0; ii < _batchCount; ii++) {
+     if(_batch[ii].bank != bank) naive++;
+     bank = _batch[ii].bank;
+     naive++;
+   }
+
+   // stable insertion sort by (bank, address), current bank first
+   for(uint8_t ii = 1; ii < _batchCount; ii++) {
+     PAF9701_RegWrite entry = _batch[ii];
+     uint16_t key = (uint16_t) (entry.bank == _bank ? 0 : entry.bank + 1) << 8 | entry.reg;
+     int8_t jj = ii - 1;
+     while(jj >= 0 && ((uint16_t) (_batch[jj].bank == _bank ? 0 : _batch[jj].bank + 1) << 8 | _batch[jj].reg) > key) {
+       _batch[jj + 1] = _batch[jj];
+       jj--;
+     }
+     _batch[jj + 1] = entry;
+   }
+
+   uint32_t before = _stats.transactions;
+   uint8_t burst[PAF9701_MAX_BURST];
+   uint8_t ii = 0;
+   while(ii < _batchCount) {
+     if(_batch[ii].bank != _bank) selectBank(_batch[ii].bank);
+     uint8_t start = _batch[ii].reg, count = 0;
+     while(ii < _batchCount && _batch[ii].bank == _bank) {
+       if(count > 0 && _batch[ii].reg == start + count - 1) {  // repeated write, last value wins
+         burst[count - 1] = _batch[ii++].data;
+         continue;
+       }
+       if(count == 0 || _batch[ii].reg != start + count || count == PAF9701_MAX_BURST) {
+         if(count > 0) writeRegs(start, count, burst);
+         start = _batch[ii].reg;
+         count = 0;
+       }
+       burst[count++] = _batch[ii++].data;
+     }
+     writeRegs(start, count, burst);
+   }
+   _batchCount = 0;
+
+   uint16_t issued = _stats.transactions - before;
+   uint8_t saved = naive > issued && !_staging ? naive - issued : 0;
+   _stats.burstWritesSaved += saved;
+   return saved;
+}
+
+
+/* Fast resume
+ * After wake from STOP or a watchdog reset of the MCU the sensor normally still holds its whole
+ * configuration, so re-running the init sequence is wasted bus traffic. Between beginConfig()
+ * and fastResume() the usual configuration calls only record the expected register values in
+ * the shadow: reads they need still go to the sensor, writes to shadowed registers do not, and
+ * bank selects wait for the next real access. fastResume() then reads the recorded registers
+ * back in bursts (runs merged across gaps of up to PAF9701_RESUME_GAP registers, which is
+ * cheaper than a new read), compares each value with the expected one and rewrites only the
+ * registers that differ, grouped into bursts as usual. The CRC-16 of the read back values and
+ * that of the expected ones are reported in the stats but decide nothing, since a collision
+ * would leave a differing register unwritten.
+ * Writes to live registers made while staging (OUTPUT_ENABLE from suspendOperation() or
+ * resumeOperation(), the STATUS_FLAG clear) depend on the configuration, so they are held too,
+ * up to PAF9701_DEFERRED_SIZE of them, and sent in their original order after the rewrites.
+ * Beyond that they go out at once. A reset does not belong between the two calls.
+ */
+void PAF9701::beginConfig()
+{
+   flushWrites();
+   memset(_expected, 0, sizeof(_expected));
+   _deferredCount = 0;
+   _busBank = _bank;
+   _staging = true;
+}
+
+
+// CRC-16/CCITT over bank, register and value
+static uint16_t digestRegister(uint16_t crc, uint8_t bank, uint8_t reg, uint8_t data)
+{
+   uint8_t bytes[3] = {bank, reg, data};
+   for(uint8_t ii = 0; ii < 3; ii++) {
+     crc ^= (uint16_t) bytes[ii] << 8;
+     for(uint8_t bit = 0; bit < 8; bit++) crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+   }
+   return crc;
+}
+
+
+uint16_t PAF9701::getConfigDigest()
+{
+   uint16_t crc = 0xFFFF;
+   for(uint8_t ww = 0; ww < sizeof(shadowWindows) / sizeof(shadowWindows[0]); ww++) {
+     for(uint8_t ii = 0; ii < shadowWindows[ww].count; ii++) {
+       uint8_t index = shadowWindows[ww].offset + ii;
+       if(_expected[index >> 3] & (1 << (index & 7))) crc = digestRegister(crc, shadowWindows[ww].bank, shadowWindows[ww].first + ii, _shadow[index]);
+     }
+   }
+   return crc;
+}
+
+
+uint8_t PAF9701::fastResume(PAF9701_ResumeStats * stats)
+{
+   flushWrites();          // recorded only, still staging
+   _staging = false;
+   _bank = _busBank;       // the bank the sensor is really in
+
+   PAF9701_ResumeStats resume;
+   memset(&resume, 0, sizeof(resume));
+   resume.expectedDigest = getConfigDigest();
+   resume.sensorDigest = 0xFFFF;
+   uint32_t before = _stats.transactions;
+   uint8_t readback[PAF9701_MAX_BURST];
+   uint8_t differ[PAF9701_SHADOW_SIZE / 8];
+   uint8_t anyDiffer = 0;
+   memset(differ, 0, sizeof(differ));
+
+   for(uint8_t ww = 0; ww < sizeof(shadowWindows) / sizeof(shadowWindows[0]); ww++) {
+     uint8_t bank = shadowWindows[ww].bank, first = shadowWindows[ww].first, offset = shadowWindows[ww].offset;
+     uint8_t ii = 0;
+     while(ii < shadowWindows[ww].count) {
+       if(!(_expected[(offset + ii) >> 3] & (1 << ((offset + ii) & 7)))) {
+         ii++;
+         continue;
+       }
+       uint8_t start = ii, end = ii;   // one read from start to end, inclusive
+       for(uint8_t jj = ii + 1; jj < shadowWindows[ww].count && jj - start < PAF9701_MAX_BURST && jj - end <= PAF9701_RESUME_GAP + 1; jj++) {
+         if(_expected[(offset + jj) >> 3] & (1 << ((offset + jj) & 7))) end = jj;
+       }
+       selectBank(bank);
+       readRegs(first + start, end - start + 1, readback);
+       resume.reads++;
+       for(uint8_t jj = start; jj <= end; jj++) {
+         uint8_t index = offset + jj, bit = 1 << (index & 7);
+         if(shadowIndex(bank, first + jj) < 0) continue;                  // live register inside the run
+         if(!(_expected[index >> 3] & bit)) {
+           _shadow[index] = readback[jj - start];                           // not configured, keep what the sensor has
+           _shadowValid[index >> 3] |= bit;
+           continue;
+         }
+         resume.checked++;
+         resume.sensorDigest = digestRegister(resume.sensorDigest, bank, first + jj, readback[jj - start]);
+         if(readback[jj - start] != _shadow[index]) {
+           differ[index >> 3] |= bit;
+           anyDiffer = 1;
+         }
+       }
+       ii = end + 1;
+     }
+   }
+
+   if(anyDiffer) {          // the exact comparison, the digests are stats only
+     for(uint8_t ww = 0; ww < sizeof(shadowWindows) / sizeof(shadowWindows[0]); ww++) {
+       for(uint8_t ii = 0; ii < shadowWindows[ww].count; ii++) {
+         uint8_t index = shadowWindows[ww].offset + ii;
+         if(!(differ[index >> 3] & (1 << (index & 7)))) continue;
+         queueWrite(shadowWindows[ww].bank, shadowWindows[ww].first + ii, _shadow[index]);
+         resume.rewritten++;
+       }
+     }
+     flushWrites();
+   }
+   for(uint8_t ii = 0; ii < _deferredCount; ii++) {   // after the configuration they depend on
+     selectBank(_deferred[ii].bank);
+     writeReg(_deferred[ii].reg, _deferred[ii].data);
+   }
+   resume.deferred = _deferredCount;
+   _deferredCount = 0;
+   resume.transactions = _stats.transactions - before;
+   if(stats) *stats = resume;
+   return resume.rewritten;
+}
+
+
+/* Register access helpers
+ * All bus traffic goes through these so the bank select state and the shadow stay coherent;
+ * callers select the bank first.
+*/
+void PAF9701::selectBank(uint8_t bank)
+{
+   if(_staging) {
+     _bank = bank;           // selected on the next real access, see syncBank()
+     return;
+   }
+   if(_bank == bank) {
+     _stats.bankSelectsSaved++;  // already there, skip the write
+     return;
+   }
+   _i2c_bus->writeByte(_address, PAF9701_BANK_SELECT, bank);
+   _stats.transactions++;
+   _bank = bank;
+}
+
+
+int16_t PAF9701::shadowIndex(uint8_t bank, uint8_t reg)
+{
+   if(bank == 0x00) {  // part id, status, Ta data, reset and bank select are live registers
+     if(reg <= PAF9701_CAL_TO_DATA_H || reg == PAF9701_HOST_RSTB || reg == PAF9701_BANK_SELECT) return -1;
+   }
+   for(uint8_t ii = 0; ii < sizeof(shadowWindows) / sizeof(shadowWindows[0]); ii++) {
+     if(shadowWindows[ii].bank == bank && reg >= shadowWindows[ii].first && reg - shadowWindows[ii].first < shadowWindows[ii].count) {
+       return shadowWindows[ii].offset + reg - shadowWindows[ii].first;
+     }
+   }
+   return -1;
+}
+
+
+// while staging, the bank the caller selected last, before any real access
+void PAF9701::syncBank()
+{
+   if(!_staging || _busBank == _bank) return;
+   _i2c_bus->writeByte(_address, PAF9701_BANK_SELECT, _bank);
+   _stats.transactions++;
+   _busBank = _bank;
+}
+
+
+uint8_t PAF9701::readReg(uint8_t reg)
+{
+   int16_t index = shadowIndex(_bank, reg);
+   if(index >= 0 && (_shadowValid[index >> 3] & (1 << (index & 7)))) {
+     _stats.readsSaved++;
+     return _shadow[index];
+   }
+   syncBank();
+   uint8_t data = _i2c_bus->readByte(_address, reg);
+   _stats.transactions++;
+   if(index >= 0) {
+     _shadow[index] = data;
+     _shadowValid[index >> 3] |= (1 << (index & 7));
+   }
+   return data;
+}
+
+
+void PAF9701::writeReg(uint8_t reg, uint8_t data)
+{
+   if(_staging) {
+     int16_t index = shadowIndex(_bank, reg);
+     if(index >= 0) {        // recorded for fastResume()
+       _shadow[index] = data;
+       _shadowValid[index >> 3] |= (1 << (index & 7));
+       _expected[index >> 3] |= (1 << (index & 7));
+       return;
+     }
+     if(_deferredCount < PAF9701_DEFERRED_SIZE) {   // sent by fastResume() after the configuration
+       _deferred[_deferredCount].bank = _bank;
+       _deferred[_deferredCount].reg  = reg;
+       _deferred[_deferredCount].data = data;
+       _deferredCount++;
+       return;
+     }
+     syncBank();
+   }
+   _i2c_bus->writeByte(_address, reg, data);  // write-through, the sensor is always updated
+   _stats.transactions++;
+   int16_t index = shadowIndex(_bank, reg);
+   if(index >= 0) {
+     _shadow[index] = data;
+     _shadowValid[index >> 3] |= (1 << (index & 7));
+   }
+}
+
+
+void PAF9701::writeRegs(uint8_t reg, uint8_t count, uint8_t * data)
+{
+   if(count == 1) {
+     writeReg(reg, data[0]);
+     return;
+   }
+   if(_staging) {            // recorded one register at a time
+     for(uint8_t ii = 0; ii < count; ii++) writeReg(reg + ii, data[ii]);
+     return;
+   }
+   _i2c_bus->writeBytes(_address, reg, count, data);  // register address auto-increments
+   _stats.transactions++;
+   for(uint8_t ii = 0; ii < count; ii++) {
+     int16_t index = shadowIndex(_bank, reg + ii);
+     if(index >= 0) {
+       _shadow[index] = data[ii];
+       _shadowValid[index >> 3] |= (1 << (index & 7));
+     }
+   }
+}
+
+
+void PAF9701::readRegs(uint8_t reg, uint8_t count, uint8_t * dest)
+{
+   syncBank();
+   _i2c_bus->readBytes(_address, reg, count, dest);  // pixel and flag data, never shadowed
+   _stats.transactions++;
+}
@@ -17,7 +17,7 @@
 #define PAF9701_h
 
 #include "Arduino.h"
-#include "I2CDev.h"
+#include "I2Cdev.h"
 #include <Wire.h>
 
 /* Register Map PAF9701
@@ -256,8 +256,19 @@
 
 #define PAF9701_BANK_SELECT                0x7F
 
+#include "PAF9701Fields.h"     // bit fields of the configuration registers
 
-#define PAF9701_ADDRESS  0x34  // if ADO is 0 (default), 0x57 if ADO == 1
+
+#define PAF9701_ADDRESS       0x34  // if ADO is 0 (default)
+#define PAF9701_ADDRESS_ADO   0x57  // if ADO == 1
+
+#define PAF9701_BANK_UNKNOWN  0xFF  // bank select state after power up or reset
+#define PAF9701_SHADOW_SIZE   192   // bytes of register shadow, see shadow windows in PAF9701.cpp
+#define PAF9701_BATCH_SIZE     32   // queued register writes before an automatic flush
+#define PAF9701_MAX_BURST      30   // data bytes per auto-increment write, fits a 32 byte Wire buffer
+#define PAF9701_STARTUP_POLL_MS 1   // ms between status polls in serviceStartup()
+#define PAF9701_RESUME_GAP      4   // unconfigured registers fastResume() reads through rather than start a new read
+#define PAF9701_DEFERRED_SIZE   8   // live register writes held between beginConfig() and fastResume()
 
 enum runMode { // define run modes
  normal_mode     = 0x00,
@@ -311,32 +322,247 @@ enum alertMode {
 };
 
 
+enum acquisitionProfile { // BURST_NUM_SEL sample counts, see setProfile()
+ lowLatencyProfile  = 0x00,   // Ta 2^5, To 2^7 samples, 24 ms conversion, up to 41 Hz
+ balancedProfile    = 0x01,   // Ta 2^7, To 2^9 samples, 97 ms conversion, up to 10 Hz (default)
+ lowNoiseProfile    = 0x02    // Ta 2^8, To 2^10 samples, 194 ms conversion, up to 5 Hz
+};
+
+// conversion time in us for a BURST_NUM_SEL value (Ta exponent high nibble, To low nibble), scaled per sample from 97 ms at 0x79
+#define PAF9701_CONVERSION_US(burstNum)  ((uint32_t) (97000ULL * ((1UL << ((burstNum) >> 4)) + (1UL << ((burstNum) & 0x0F))) / 640))
+
+#define PAF9701_PERIOD_TICKS(ms)  ((uint32_t) (((uint64_t) (ms) * 25) / 32))   // ms to 1.28 ms register steps
+
+typedef struct {
+  uint32_t det1Period;       // detect mode 1 frame period, DET1_RPT_RATE, 1.28 ms per LSB, 20 bits
+  uint32_t det2Period;       // detect mode 2 frame period, DET2_RPT_RATE
+  uint32_t detectTime;       // time without an alert before the next stage down, DET_TIME
+  uint8_t  skip1Pixels;      // skip mode: pixels in alert that wake detect mode 1, TO_SKIP1_PIXEL_THRESHOLD
+  uint8_t  skip2Pixels;      // skip mode: pixels in alert that wake detect mode 2, TO_SKIP2_PIXEL_THRESHOLD
+  bool     skipMode;         // SKIP_MODE bit 0, detect mode 3
+} PAF9701_DetectConfig;
+
+typedef struct {
+  uint32_t transactions;      // I2C transactions actually issued to the sensor
+  uint32_t bankSelectsSaved;  // redundant bank select writes skipped
+  uint32_t readsSaved;        // configuration register reads answered from the shadow
+  uint32_t burstWritesSaved;  // START/STOP cycles saved by grouping queued writes into bursts
+  uint32_t snapshotRetries;   // pixel reads repeated because a new frame was published during the read
+  uint32_t tornFrames;        // pixel reads still torn after all retries
+} PAF9701_BusStats;
+
+typedef struct {
+  int16_t  pixels[64];   // object temperatures, 1/16 C per LSB
+  uint64_t alertMask;    // bit i set when pixel i is in alert, TO_ALERT_FLAG_0_7 in the low byte
+  uint64_t windowMask;   // bit i set when pixel i was read, see setWindow(); pixels outside are 0
+  uint32_t sequence;     // set by PAF9701FrameRing::publish(), gaps are dropped frames
+  uint32_t timestamp;    // micros() at the INT edge, set by the acquisition engine
+  uint8_t  status;       // STATUS_FLAG when the frame was read
+} PAF9701_Frame;
+
+typedef struct {
+  uint32_t frames;           // frames delivered by serviceAcquisition()
+  uint32_t lastLatency;      // us from INT edge to frame ready
+  uint32_t maxLatency;
+  uint32_t totalLatency;     // sum over all frames, for the average
+  uint32_t overruns;         // INT edges while a frame was still being read
+} PAF9701_AcqStats;
+
+typedef void (*PAF9701_FrameCallback)(PAF9701_Frame * frame);
+
+class PAF9701FrameRing;
+
+enum acquisitionState {
+ acqIdle     = 0x00,
+ acqStatus   = 0x01,   // read status, clear Frame_Update_flag in snapshot mode
+ acqBank4    = 0x02,   // pixels 0 - 31 and alert flags
+ acqBank5    = 0x03,   // pixels 32 - 63
+ acqFinish   = 0x04    // torn frame check or clear interrupt, then callback
+};
+
+typedef struct {
+  uint8_t bank;
+  uint8_t reg;
+  uint8_t data;
+} PAF9701_RegWrite;
+
+#define PAF9701_INIT_WRITES    18   // most writes paf9701NormalModeWrites() returns
+
+uint8_t paf9701NormalModeWrites(PAF9701_RegWrite * writes, uint8_t runMode, uint32_t sampleRate, bool settle_en, uint8_t profile,
+                                float emissivity, float decayTime, uint8_t powerSaving, bool * valid);  // initNormalMode() registers, see PAF9701.cpp
+
+enum startupState {
+ startIdle       = 0x00,
+ startReset      = 0x01,   // cold reset sent, waiting resetTime
+ startBootload   = 0x02,   // polling for the bootload done flag
+ startConfigure  = 0x03,   // init written, more settings may go in now, enabled on the next call
+ startSettle     = 0x04,   // enabled, waiting out settleTime
+ startFirstFrame = 0x05,   // polling for the first frame update flag
+ startReady      = 0x06,
+ startFailed     = 0x07    // timed out, see PAF9701_StartupStats
+};
+
+typedef struct {
+  bool     autoPowerSave;    // initAutoPowerSaveMode() instead of initNormalMode()
+  uint8_t  runMode;          // initNormalMode()
+  uint32_t sampleRate;       // initNormalMode(), 1.28 ms per LSB
+  bool     detect3;          // initAutoPowerSaveMode()
+  uint32_t detectTime;       // initAutoPowerSaveMode()
+  uint8_t  profile;          // acquisitionProfile
+  bool     settle;           // settle function after sensor enable
+  uint32_t resetTime;        // ms after the cold reset before the first status poll
+  uint32_t bootTimeout;      // ms after resetTime for the flash bootload
+  uint32_t settleTime;       // ms the settle function takes, about 3000
+  uint32_t frameTimeout;     // ms for the first frame, longer than one frame period
+} PAF9701_StartupConfig;
+
+typedef struct {
+  uint16_t expectedDigest;   // CRC-16 of the registers recorded since beginConfig()
+  uint16_t sensorDigest;     // the same over the values read back from the sensor
+  uint8_t  checked;          // recorded registers read back
+  uint8_t  rewritten;        // registers that differed and were written
+  uint8_t  deferred;         // live register writes made while staging, sent after the rewrites
+  uint8_t  reads;            // burst reads
+  uint8_t  transactions;     // all bus transactions of fastResume()
+} PAF9701_ResumeStats;
+
+typedef struct {
+  uint32_t bootload;         // ms from beginStartup() to bootload done
+  uint32_t firstFrame;       // ms from beginStartup() to the first valid frame
+  uint32_t statusReads;      // bus reads spent polling
+  uint8_t  failedState;      // state that timed out, startIdle when none
+  bool     rateRaised;       // sampleRate was too fast for the profile
+} PAF9701_StartupStats;
+
+
 class PAF9701
 {
   public: 
-  PAF9701(I2Cdev* i2c_bus);
+  PAF9701(I2Cdev* i2c_bus, uint8_t address = PAF9701_ADDRESS);
+  I2Cdev* getBus();
+  uint8_t getAddress();
   uint16_t getChipID();
   void coldReset(); // reset all registers to default
+  void beginStartup(const PAF9701_StartupConfig * config);  // cold reset, then serviceStartup() from loop() or setup()
+  uint8_t serviceStartup();                    // one step per call, never blocks, returns startupState
+  void getStartupStats(PAF9701_StartupStats * stats);
+  void beginConfig();                          // configuration calls from here on only record, see fastResume()
+  uint8_t fastResume(PAF9701_ResumeStats * stats = NULL);  // verify the recorded registers, rewrite those that differ
+  uint16_t getConfigDigest();                  // CRC-16 of the recorded configuration
   void warmReset(); // preserve register settings
-  void initNormalMode(uint8_t runMode, uint32_t sampleRate, bool settle_en);
-  void initAutoPowerSaveMode(bool detect3, uint32_t detectTime, bool settle_en);
+  bool initNormalMode(uint8_t runMode, uint32_t sampleRate, bool settle_en, uint8_t profile = balancedProfile);  // false when sampleRate was too fast for profile
+  bool initAutoPowerSaveMode(bool detect3, uint32_t detectTime, bool settle_en, uint8_t profile = balancedProfile);
+  bool setProfile(uint8_t profile, uint32_t sampleRate);     // false when sampleRate was raised to minFramePeriod(profile)
+  uint8_t getProfile();                                      // 0xFF when BURST_NUM_SEL matches no profile
+  uint32_t minFramePeriod(uint8_t profile);                  // shortest BURST_FRQ_SEL, 1.28 ms per LSB
+  void setDetectConfig(const PAF9701_DetectConfig * config);    // auto power save ladder, see setDetectConfig()
+  void getDetectConfig(PAF9701_DetectConfig * config);          // read back from the sensor, not the shadow
+  bool verifyDetectConfig(const PAF9701_DetectConfig * config); // true when the sensor holds config
   void suspendOperation();
   void resumeOperation();
+  void beginOneShot();                         // suspend and switch to one conversion per triggerOneShot()
+  void triggerOneShot();                       // start one conversion and clear the last frame's flag
+  bool awaitFrame(PAF9701_Frame * frame, uint32_t timeout, volatile bool * intFlag = NULL);  // ms, false on timeout
+  void endOneShot();                           // back to continuous conversions, still suspended
   void clearInterrupt();
   uint8_t getStatus();
   void imageOrientation(uint8_t imageFlip, uint8_t imageRotate);
+  bool setEmissivity(float emissivity);        // 0 - 1, from the next frame, kept by warmReset() and re-init
+  float getEmissivity();                       // read back from the sensor
+  bool setDecayTime(float decayTime);          // DECAY_TIME, kept by warmReset() and re-init
+  float getDecayTime();
   int16_t getRawTaData();
   int16_t getCalTaData();
-  uint8_t getPowerSaveMode();
-  void getToData(float * temperatures);
+  uint8_t getPowerSaveMode();                  // read back from the sensor
+  bool getToData(float * temperatures);
+  bool getToDataRaw(int16_t * temperatures);  // 1/16 C per LSB, see PAF9701Frame.h for fixed-point processing
+  bool readFrame(PAF9701_Frame * frame);       // status, pixels and alert flags in three reads
+  void setSnapshotRead(uint8_t retries);       // 0 = off (default), else retries for torn frames, see readPixelBanks()
+  void setWindow(uint8_t firstRow, uint8_t lastRow, uint8_t firstColumn, uint8_t lastColumn);  // 0 - 7, inclusive
+  void clearWindow();                          // back to the whole 8 x 8 frame
+  uint64_t getWindowMask();
+  void beginAcquisition(PAF9701_Frame * frame, PAF9701_FrameCallback callback);
+  void beginAcquisition(PAF9701FrameRing * ring, PAF9701_FrameCallback callback);  // publish each frame into ring
+  void startAcquisition();                     // call from the INT pin interrupt handler
+  void startAcquisition(uint32_t edge);        // as above with the micros() of the INT edge taken earlier
+  bool serviceAcquisition();                   // call from loop(), one bus transaction per call, true when a frame is ready
+  bool acquisitionBusy();                      // do not sleep while true, no interrupt will wake the MCU
+  PAF9701_Frame * lastFrame();                 // the frame serviceAcquisition() last finished
+  void getAcquisitionStats(PAF9701_AcqStats * stats);
+  void resetAcquisitionStats();
   void setFilter(uint8_t digitalFilter, uint8_t frameAverage, uint8_t IIRAverage);
   void setAlertMode(uint8_t normalModeAlert, uint8_t det123ModeAlert);
+  void setInterruptOpenDrain(bool openDrain);  // open drain INT for a shared wired-OR line, see PAF9701IntDemux.h
   void setNormalAlertLimits(int16_t TaLow, int16_t TaHigh, uint8_t TaHyst, int16_t ToLow, int16_t ToHigh, int8_t ToHyst, uint8_t pixels);
   void setDet123AlertLimits(int16_t TaLow, int16_t TaHigh, uint8_t TaHyst, int16_t ToLow, int16_t ToHigh, int8_t ToHyst, uint8_t pixels);
-  void getNormalAlertLimits(int16_t * output);
-  void getAlertPixels(uint32_t * alertPixels);
+  void getNormalAlertLimits(int16_t * output); // read back from the sensor
+  uint64_t getAlertPixels();                   // bit i for pixel i, see PAF9701Mask.h
+  void getAlertPixels(uint32_t * alertPixels); // pixels 0 - 31, 32 - 63
+  void invalidateCache();     // call if the sensor was reset behind the driver's back (reset pin, power cycle)
+  void getBusStats(PAF9701_BusStats * stats);
+  void resetBusStats();
+  void queueWrite(uint8_t bank, uint8_t reg, uint8_t data); // configuration registers only, order within a bank is not kept
+  uint8_t flushWrites();                                    // returns START/STOP cycles saved
+  template<uint8_t Bank, uint8_t Reg> void setFields(PAF9701_RegUpdate<Bank, Reg> update)  // read-modify-write of one register, see PAF9701Fields.h
+    { queueFields(Bank, Reg, update.mask, update.bits); flushWrites(); }
+  template<uint8_t Bank, uint8_t Reg, uint8_t Shift, uint8_t Width> uint8_t getField(PAF9701_RegField<Bank, Reg, Shift, Width> field)
+    { return field.get(readFields(Bank, Reg)); }
   private:
   I2Cdev* _i2c_bus;
+  uint8_t _address;
+  uint8_t _bank;                                  // currently selected register bank
+  uint8_t _shadow[PAF9701_SHADOW_SIZE];           // write-through copy of the configuration registers
+  uint8_t _shadowValid[PAF9701_SHADOW_SIZE / 8];  // one bit per shadow byte
+  PAF9701_BusStats _stats;
+  PAF9701_RegWrite _batch[PAF9701_BATCH_SIZE];   // queued writes, see flushWrites()
+  uint8_t _batchCount;
+  uint8_t _snapshotRetries;
+  uint8_t _firstRow, _lastRow;                    // rows read by readPixelBanks() and the acquisition engine
+  float _emissivity;                              // written by the init functions
+  float _decayTime;                               // 0 until setDecayTime(), chip default
+  uint64_t _windowMask;
+  PAF9701_Frame * _acqFrame;
+  PAF9701FrameRing * _acqRing;
+  PAF9701_FrameCallback _acqCallback;
+  volatile bool _acqPending;                      // set by startAcquisition() in interrupt context
+  volatile uint32_t _acqEdge;                     // micros() at the INT edge
+  volatile uint32_t _acqOverruns;
+  uint32_t _acqStart;                             // edge of the frame being read
+  uint8_t _acqState;
+  uint8_t _acqTries;
+  PAF9701_AcqStats _acqStats;
+  PAF9701_StartupConfig _startConfig;
+  PAF9701_StartupStats _startStats;
+  uint8_t _startState;
+  uint32_t _startTime;                            // millis() at beginStartup()
+  uint32_t _startStep;                            // millis() at the start of the current state
+  uint32_t _startPoll;                            // millis() at the last status poll
+  bool _staging;                                  // between beginConfig() and fastResume()
+  uint8_t _busBank;                               // bank the sensor is in while staging
+  uint8_t _expected[PAF9701_SHADOW_SIZE / 8];     // shadow bytes recorded since beginConfig()
+  PAF9701_RegWrite _deferred[PAF9701_DEFERRED_SIZE];  // live register writes made while staging, in order
+  uint8_t _deferredCount;
+  void selectBank(uint8_t bank);
+  void syncBank();
+  int16_t shadowIndex(uint8_t bank, uint8_t reg);
+  uint8_t readReg(uint8_t reg);                    // register accesses in the currently selected bank
+  void writeReg(uint8_t reg, uint8_t data);
+  void writeRegs(uint8_t reg, uint8_t count, uint8_t * data);
+  void readRegs(uint8_t reg, uint8_t count, uint8_t * dest);
+  bool readPixelBanks(uint8_t * rawData, uint64_t * alertMask, uint8_t * status, bool statusRead = false);  // false when torn, statusRead: *status already holds it
+  void readBank4(uint8_t * rawData, uint64_t * alertMask);   // window rows 0 - 3 and the alert flags
+  void readBank5(uint8_t * rawData);                         // window rows 4 - 7
+  void maskWindow(uint8_t * rawData);                        // zero the pixels outside the window
+  bool queueProfile(uint8_t profile, uint32_t sampleRate);
+  void startConfigured(uint32_t now);
+  void queueFloat(uint8_t bank, uint8_t reg, float value);   // IEEE-754 single, LSB first
+  float readFloat(uint8_t reg);
+  void queueFields(uint8_t bank, uint8_t reg, uint8_t mask, uint8_t bits);  // bits outside mask kept
+  uint8_t readFields(uint8_t bank, uint8_t reg);             // from the shadow when it holds reg
+  template<uint8_t Bank, uint8_t Reg> void queueUpdate(PAF9701_RegUpdate<Bank, Reg> update)   // bits outside the update kept
+    { queueFields(Bank, Reg, update.mask, update.bits); }
+  template<uint8_t Bank, uint8_t Reg> void queueAssign(PAF9701_RegUpdate<Bank, Reg> update)   // bits outside the update cleared
+    { queueWrite(Bank, Reg, update.bits); }
 };
 
 #endif
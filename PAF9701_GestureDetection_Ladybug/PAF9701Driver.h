@@ -0,0 +1,233 @@
+/* Copyright Tlera Corporation
+ *
+ *  Header-only PAF9701 driver with the bus and the device address as template parameters,
+ *  for the frame read path where the PAF9701 class's I2Cdev and TwoWire pointers and
+ *  out-of-line calls cost time.
+ *
+ *  A bus policy is any class with
+ *
+ *    bool write(uint8_t address, uint8_t reg, const uint8_t * data, uint8_t count);  // auto-increment write
+ *    bool read(uint8_t address, uint8_t reg, uint8_t * dest, uint8_t count);          // pointer write, repeated START, read
+ *
+ *  returning false when the sensor did not acknowledge. Failed transfers are counted in
+ *  busErrors() and make initNormalMode() return false, so a lost start-up write is not silent.
+ *
+ *  PAF9701WireBus<Wire> below talks to an Arduino TwoWire; host/PAF9701HostBus.h has Linux
+ *  i2c-dev and simulator policies. The policy is held by value, so a stateless one costs
+ *  nothing and every register sequence inlines into the caller.
+ *
+ *  This covers reset, normal mode start-up, emissivity, decay time, status and frame reads with
+ *  the bank select tracking of the PAF9701 class; use the class for the register shadow, write
+ *  batching, alert configuration and the acquisition engine. The start-up register values come
+ *  from paf9701NormalModeWrites() in PAF9701.cpp, the same table PAF9701::initNormalMode() uses,
+ *  so PAF9701.cpp must be built along with this header (the sketch folders always do).
+ *
+ *    PAF9701Driver< PAF9701WireBus<Wire> > sensor;          // PAF9701_ADDRESS
+ *    PAF9701Driver< PAF9701WireBus<Wire>, PAF9701_ADDRESS_ADO > second;
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#ifndef PAF9701Driver_h
+#define PAF9701Driver_h
+
+#include "PAF9701.h"
+
+template<TwoWire & wire>
+class PAF9701WireBus
+{
+  public:
+  inline bool write(uint8_t address, uint8_t reg, const uint8_t * data, uint8_t count)
+  {
+    wire.beginTransmission(address);
+    wire.write(reg);
+    wire.write(data, count);
+    return wire.endTransmission() == 0;
+  }
+
+  inline bool read(uint8_t address, uint8_t reg, uint8_t * dest, uint8_t count)
+  {
+    wire.beginTransmission(address);
+    wire.write(reg);
+    if(wire.endTransmission(false) != 0) return false;   // repeated START
+    if(wire.requestFrom(address, count) != count) return false;
+    for(uint8_t ii = 0; ii < count && wire.available(); ii++) dest[ii] = wire.read();
+    return true;
+  }
+};
+
+
+template<class Bus, uint8_t Address = PAF9701_ADDRESS>
+class PAF9701Driver
+{
+  public:
+  PAF9701Driver(const Bus & bus = Bus()) : _bus(bus), _bank(PAF9701_BANK_UNKNOWN), _errors(0), _emissivity(0.98f), _decayTime(0.0f) {}
+
+  Bus & bus() { return _bus; }
+  uint32_t busErrors() const { return _errors; }   // transfers the bus policy reported as failed
+
+  uint16_t getChipID()
+  {
+    uint8_t rawData[2];
+    selectBank(0x00);
+    busRead(PAF9701_PARTID_L, rawData, 2);
+    return ((uint16_t) rawData[1] << 8) | rawData[0];
+  }
+
+  void coldReset()
+  {
+    selectBank(0x00);
+    writeReg(PAF9701_HOST_RSTB, 0x5A);   // reset all registers to default
+    _bank = PAF9701_BANK_UNKNOWN;
+  }
+
+  void warmReset()
+  {
+    selectBank(0x00);
+    writeReg(PAF9701_HOST_RSTB, 0x9A);   // preserve register settings
+    _bank = PAF9701_BANK_UNKNOWN;
+  }
+
+  // the register values of PAF9701::initNormalMode(), consecutive registers in one burst;
+  // false for invalid arguments or when any transfer failed
+  bool initNormalMode(uint8_t runMode, uint32_t sampleRate, bool settle_en, uint8_t profile = balancedProfile)
+  {
+    PAF9701_RegWrite writes[PAF9701_INIT_WRITES];
+    bool valid;
+    uint32_t errors = _errors;
+    selectBank(0x00);
+    uint8_t count = paf9701NormalModeWrites(writes, runMode, sampleRate, settle_en, profile, _emissivity, _decayTime,
+                                            readReg(PAF9701_POWER_SAVING_MODE), &valid);
+    uint8_t burst[PAF9701_MAX_BURST];
+    uint8_t ii = 0;
+    while(ii < count) {
+      uint8_t first = ii, n = 0;
+      while(ii < count && n < PAF9701_MAX_BURST && writes[ii].bank == writes[first].bank && writes[ii].reg == writes[first].reg + n) burst[n++] = writes[ii++].data;
+      selectBank(writes[first].bank);
+      busWrite(writes[first].reg, burst, n);
+    }
+    return valid && _errors == errors;
+  }
+
+  bool setEmissivity(float emissivity)   // 0 - 1, as PAF9701::setEmissivity(), kept for initNormalMode()
+  {
+    if(!(emissivity > 0.0f && emissivity <= 1.0f)) return false;
+    _emissivity = emissivity;
+    writeFloat(PAF9701_EMISSIVITY_L, emissivity);
+    return true;
+  }
+
+  bool setDecayTime(float decayTime)     // as PAF9701::setDecayTime(), kept for initNormalMode()
+  {
+    if(!(decayTime > 0.0f)) return false;
+    _decayTime = decayTime;
+    writeFloat(PAF9701_DECAY_TIME_L, decayTime);
+    return true;
+  }
+
+  void suspendOperation()
+  {
+    selectBank(0x00);
+    writeReg(PAF9701_OUTPUT_ENABLE, 0x00);
+  }
+
+  void resumeOperation()
+  {
+    selectBank(0x00);
+    writeReg(PAF9701_OUTPUT_ENABLE, 0x01);
+  }
+
+  void clearInterrupt()
+  {
+    selectBank(0x00);
+    writeReg(PAF9701_STATUS_FLAG, 0x80);   // clear Frame_Update_flag
+  }
+
+  uint8_t getStatus()
+  {
+    selectBank(0x00);
+    return readReg(PAF9701_STATUS_FLAG);
+  }
+
+  void getToDataRaw(int16_t * temperatures)   // 1/16 C per LSB
+  {
+    uint8_t * rawData = (uint8_t *) temperatures;
+    selectBank(0x04);
+    busRead(PAF9701_TO_PIXEL_0_DATA_L, &rawData[0], 64);
+    selectBank(0x05);
+    busRead(PAF9701_TO_PIXEL_32_DATA_L, &rawData[64], 64);
+    unpack(temperatures);
+  }
+
+  void readFrame(PAF9701_Frame * frame)   // as PAF9701::readFrame() without snapshot mode
+  {
+    uint8_t * rawData = (uint8_t *) frame->pixels;
+    frame->status = getStatus();
+    selectBank(0x04);
+    busRead(PAF9701_TO_PIXEL_0_DATA_L, &rawData[0], 72);   // pixels 0 - 31 and alert flags
+    uint64_t mask = 0;
+    for(uint8_t ii = 0; ii < 8; ii++) mask |= (uint64_t) rawData[64 + ii] << (8 * ii);
+    frame->alertMask = mask;
+    frame->windowMask = ~(uint64_t) 0;   // whole frame, no window support here
+    selectBank(0x05);
+    busRead(PAF9701_TO_PIXEL_32_DATA_L, &rawData[64], 64);
+    unpack(frame->pixels);
+  }
+
+  private:
+  Bus _bus;
+  uint8_t _bank;
+  uint32_t _errors;
+  float _emissivity;     // written by initNormalMode()
+  float _decayTime;      // 0 until setDecayTime(), chip default
+
+  inline void selectBank(uint8_t bank)
+  {
+    if(_bank == bank) return;
+    _bank = busWrite(PAF9701_BANK_SELECT, &bank, 1) ? bank : PAF9701_BANK_UNKNOWN;   // select again next time
+  }
+
+  inline uint8_t readReg(uint8_t reg)
+  {
+    uint8_t data = 0;
+    busRead(reg, &data, 1);
+    return data;
+  }
+
+  inline void writeReg(uint8_t reg, uint8_t data)
+  {
+    busWrite(reg, &data, 1);
+  }
+
+  inline bool busRead(uint8_t reg, uint8_t * dest, uint8_t count)
+  {
+    if(_bus.read(Address, reg, dest, count)) return true;
+    _errors++;
+    return false;
+  }
+
+  inline bool busWrite(uint8_t reg, const uint8_t * data, uint8_t count)
+  {
+    if(_bus.write(Address, reg, data, count)) return true;
+    _errors++;
+    return false;
+  }
+
+  void writeFloat(uint8_t reg, float value)   // bank 3, four bytes LSB first
+  {
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+    uint8_t data[4] = {(uint8_t) bits, (uint8_t) (bits >> 8), (uint8_t) (bits >> 16), (uint8_t) (bits >> 24)};
+    selectBank(0x03);
+    busWrite(reg, data, 4);
+  }
+
+  static inline void unpack(int16_t * pixels)   // LSB first bytes to int16_t in place
+  {
+    uint8_t * rawData = (uint8_t *) pixels;
+    for(uint8_t ii = 0; ii < 64; ii++) pixels[ii] = (int16_t) ((uint16_t) rawData[2*ii + 1] << 8 | rawData[2*ii]);
+  }
+};
+
+#endif
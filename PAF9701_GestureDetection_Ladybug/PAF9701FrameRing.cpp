@@ -0,0 +1,71 @@
+/* Copyright Tlera Corporation
+ *
+ *  Single-producer/single-consumer ring of PAF9701 frames, see PAF9701FrameRing.h.
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include "PAF9701FrameRing.h"
+
+// free running 8 bit indices, head - tail is the fill level
+#define RING_SLOT(index)  ((index) & (PAF9701_RING_SIZE - 1))
+
+
+PAF9701FrameRing::PAF9701FrameRing()
+{
+  _head = 0;
+  _tail = 0;
+  _sequence = 0;
+  _drops = 0;
+  _filling = &_slots[0];
+}
+
+
+PAF9701_Frame * PAF9701FrameRing::producerSlot()
+{
+  if((uint8_t) (_head - _tail) == PAF9701_RING_SIZE) _filling = &_slots[PAF9701_RING_SIZE];
+  else _filling = &_slots[RING_SLOT(_head)];
+  return _filling;
+}
+
+
+void PAF9701FrameRing::publish()
+{
+  if(_filling == &_slots[PAF9701_RING_SIZE]) {   // filled the spare slot, the ring was full when it was claimed
+    _sequence++;                                         // leaves a gap the consumer can see
+    _drops++;
+    return;
+  }
+  _filling->sequence = _sequence++;
+  __sync_synchronize();   // frame contents before the index that publishes them
+  _head = _head + 1;
+}
+
+
+PAF9701_Frame * PAF9701FrameRing::consumerSlot()
+{
+  if(_head == _tail) return NULL;
+  __sync_synchronize();   // index before the frame contents it guards
+  return &_slots[RING_SLOT(_tail)];
+}
+
+
+void PAF9701FrameRing::release()
+{
+  if(_head == _tail) return;
+  __sync_synchronize();   // finish reading the slot before handing it back
+  _tail = _tail + 1;
+}
+
+
+uint8_t PAF9701FrameRing::available()
+{
+  return _head - _tail;
+}
+
+
+uint32_t PAF9701FrameRing::getDrops()
+{
+  return _drops;
+}
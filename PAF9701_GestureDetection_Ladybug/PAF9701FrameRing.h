@@ -0,0 +1,41 @@
+/* Copyright Tlera Corporation
+ *
+ *  Single-producer/single-consumer ring of PAF9701 frames.
+ *
+ *  The acquisition engine (or any other single producer) fills producerSlot() in place and calls
+ *  publish(); loop() reads consumerSlot() in place and calls release(). No locks and no copies:
+ *  each index is written by one side only. When the ring is full the producer gets a spare slot
+ *  that is never published, so the frame is read and dropped instead of overwriting the frame
+ *  being rendered.
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#ifndef PAF9701FrameRing_h
+#define PAF9701FrameRing_h
+
+#include "PAF9701.h"
+
+#define PAF9701_RING_SIZE  4   // frame slots, power of two
+
+class PAF9701FrameRing
+{
+  public:
+  PAF9701FrameRing();
+  PAF9701_Frame * producerSlot();   // slot to fill next, the spare slot when the ring is full
+  void publish();                   // hand the last producerSlot() to the consumer, or count a drop
+  PAF9701_Frame * consumerSlot();   // oldest unread frame, NULL when empty
+  void release();                   // done with consumerSlot()
+  uint8_t available();              // published frames not yet released
+  uint32_t getDrops();              // frames read while the ring was full
+  private:
+  PAF9701_Frame _slots[PAF9701_RING_SIZE + 1];   // last one is the spare
+  volatile uint8_t _head;                        // written by the producer only
+  volatile uint8_t _tail;                        // written by the consumer only
+  PAF9701_Frame * _filling;                      // last producerSlot(), producer only
+  uint32_t _sequence;
+  volatile uint32_t _drops;
+};
+
+#endif
@@ -0,0 +1,112 @@
+/* Copyright Tlera Corporation
+ *
+ *  Multi-target tracker for the blobs of PAF9701Blob.h, with a count line for people entering
+ *  and leaving a room under an overhead sensor.
+ *
+ *  Each track runs a constant velocity Kalman filter per axis, in pixels and frames; both axes
+ *  share one covariance since they have the same model and noise. Every update() predicts all
+ *  tracks one frame ahead and matches blobs to them greedily, nearest pair first, within the
+ *  gate, confirmed tracks before tentative ones; with at most PAF9701_MAX_TRACKS targets on an
+ *  8 x 8 frame this gives the same pairs as an optimal assignment in all but contrived cases.
+ *  Unmatched blobs start tentative tracks, which are confirmed after confirmHits frames in a row
+ *  and dropped at the first miss; a confirmed track missed for deleteMisses frames, or predicted
+ *  out of the frame, is deleted. IDs count up from 1 and are not reused.
+ *
+ *  A track crossing the count line from the low side (row or column below the line) to the
+ *  high side counts in, the other way out; it must clear the hysteresis band on each side, and
+ *  a crossing made while the track was still tentative counts when it is confirmed.
+ *
+ *    tracker.setCountLine(false, 3.5f, 0.5f);               // across the middle, in below row 3, out above row 4
+ *    found = blobLabel(mask, frame->pixels, 8, blobs, PAF9701_MAX_BLOBS);
+ *    tracker.update(blobs, found);                           // every frame, also with no blobs
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#ifndef PAF9701Tracker_h
+#define PAF9701Tracker_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include "PAF9701Blob.h"
+
+#define PAF9701_MAX_TRACKS     8   // tracks kept at once
+#define PAF9701_TRACK_HISTORY  8   // positions kept per track, power of two
+
+enum trackState {
+ trackFree          = 0x00,
+ trackTentative     = 0x01,   // seen in fewer than confirmHits frames in a row
+ trackConfirmed     = 0x02,
+ trackCoasting      = 0x03    // confirmed, missed in the last frame, predicted only
+};
+
+typedef struct {
+  float    gate;              // pixels, largest distance from a prediction to a blob for a match
+  uint8_t  confirmHits;       // frames in a row with a blob before a track is confirmed
+  uint8_t  deleteMisses;      // frames in a row without one before a confirmed track is deleted
+  uint8_t  minArea;           // smaller blobs are ignored
+  float    processNoise;      // acceleration variance, pixel^2 per frame^4
+  float    measurementNoise;  // blob centroid variance, pixel^2
+  float    velocityNoise;     // velocity variance of a new track, pixel^2 per frame^2
+} PAF9701_TrackerConfig;
+
+typedef struct {
+  uint16_t id;                // 0 for a free slot
+  uint8_t  state;             // trackState
+  uint8_t  hits;              // matched frames in a row
+  uint8_t  misses;            // unmatched frames in a row
+  uint16_t age;               // frames since the track started
+  float    x, y;              // filtered position, pixels
+  float    vx, vy;            // velocity, pixels per frame
+  float    pp, pv, vv;        // covariance of position and velocity, the same for both axes
+  uint8_t  area;              // of the last matched blob
+  int16_t  peak;              // 1/16 C
+  int8_t   side;              // of the count line, -1 low, 1 high, 0 not yet known
+  int8_t   pending;           // crossing made while tentative, counted on confirmation
+  uint8_t  historyCount;      // positions in history, up to PAF9701_TRACK_HISTORY
+  uint8_t  historyHead;       // slot of the newest position
+  int16_t  historyX[PAF9701_TRACK_HISTORY];   // Q8 pixel coordinates, one per frame
+  int16_t  historyY[PAF9701_TRACK_HISTORY];
+} PAF9701_Track;
+
+typedef struct {
+  uint32_t frames;            // update() calls
+  uint32_t in, out;           // count line crossings
+  uint32_t births;            // tracks confirmed
+  uint32_t deaths;            // confirmed tracks deleted
+  uint32_t tentativeDrops;    // tentative tracks dropped, noise or a target lost at once
+} PAF9701_TrackerStats;
+
+class PAF9701Tracker
+{
+  public:
+  PAF9701Tracker();
+  void setConfig(const PAF9701_TrackerConfig * config);
+  void getConfig(PAF9701_TrackerConfig * config);
+  void setCountLine(bool vertical, float position, float band);  // row (or column) position in pixels, band on each side
+  uint8_t update(const PAF9701_Blob * blobs, uint8_t count);    // once per frame, returns confirmed and coasting tracks
+  const PAF9701_Track * track(uint8_t slot);                     // 0 - PAF9701_MAX_TRACKS - 1, NULL when free
+  const PAF9701_Track * findTrack(uint16_t id);
+  bool history(const PAF9701_Track * track, uint8_t ago, float * x, float * y);  // 0 = this frame, false when older than kept
+  int8_t lastCrossings(uint8_t * in, uint8_t * out);             // crossings in the last update(), returns in - out
+  int32_t occupancy();                                           // in - out since reset()
+  void getStats(PAF9701_TrackerStats * stats);
+  void reset();                                                  // drop all tracks and counts, keep the configuration
+  private:
+  PAF9701_Track _tracks[PAF9701_MAX_TRACKS];
+  PAF9701_TrackerConfig _config;
+  PAF9701_TrackerStats _stats;
+  uint16_t _nextId;
+  bool _lineVertical;
+  float _line, _band;
+  uint8_t _lastIn, _lastOut;
+  void predict(PAF9701_Track * track);
+  void correct(PAF9701_Track * track, const PAF9701_Blob * blob);
+  void start(PAF9701_Track * track, const PAF9701_Blob * blob);
+  void record(PAF9701_Track * track);
+  void checkLine(PAF9701_Track * track);
+  void count(int8_t crossing);
+};
+
+#endif
@@ -10,12 +10,12 @@
    temperature limit thresholds and hystereses, configure and report the alert flags, read the data and plot 
    the properly scaled data on the serial monitor and on a 160 x 128 pixel Adafruit TFT color display.  The sketch
    keeps track of the pixels that exceed the temperature threshold conditions specified by the user, calculates the
-   centroid of the pixels with 1 pixel resolution, and then compares successive centroids to recognize hand gestures
+   temperature-weighted centroid of the largest object to 1/256 pixel, and then compares successive centroids to recognize hand gestures
    swipe left, swipe up, etc. This could be useful, for example, for touchless control applications.
    
-   This fairly primitive capability could also be used to track an object in the field of view. It can be
-   easily extended to detect people and/or animal transits across the field of view, keeping track of movements 
-   into or out of a space, etc. It could also be used to classify and track more sophisticated individual limb and 
+   Every object is also followed from frame to frame with its own track ID, position and velocity, and objects
+   crossing the middle row are counted in and out, as a sensor over a doorway would count people entering and
+   leaving a room. It could also be used to classify and track more sophisticated individual limb and 
    hand motions.
 
    The sketch is intended to run using a Tlera Corporation STM32L432 Ladybug development board but just about
@@ -28,6 +28,11 @@
 
 #include "RTC.h"
 #include "PAF9701.h"
+#include "PAF9701Frame.h"
+#include "PAF9701Mask.h"
+#include "PAF9701Blob.h"
+#include "PAF9701Tracker.h"
+#include "PAF9701FrameRing.h"
 #include <Adafruit_GFX.h>    // Core graphics library, install from Arduino IDE board manager
 #include <Adafruit_ST7735.h> // Hardware-specific library, install from Arduino IDE board manager
 #include "SPI.h"
@@ -68,7 +73,8 @@ float VDDA, VBUS, STM32_Temperature;
 
 // Configure the PAF9701
 uint8_t runMode = normal_mode;               // choices are normal_mode, detection_mode1, detection_mode2, detection_mode3
-uint8_t freq = 4;                            // data rate in Hz, default is 4 Hz, should not be faster than 10 Hz
+uint8_t freq = 4;                            // data rate in Hz, default is 4 Hz, should not be faster than the profile allows
+uint8_t profile = balancedProfile;           // choices are lowLatencyProfile (up to 41 Hz), balancedProfile (up to 10 Hz), lowNoiseProfile (up to 5 Hz)
 uint32_t RframeTime = 200000 / (256 * freq); // register value to match frequency, maximum frame time is 1342 seconds, minimum ~100 ms
 uint32_t detectTime = 60;                    // time between auto modes in seconds, maximum is 1342 seconds, minimum is 1 seconds
 uint32_t RdetectTime = detectTime * 200000 / 256; // register input for detect time
@@ -76,6 +82,7 @@ uint8_t imageFlip =  flipandmirror;          // choices are noflipormirror, flip
 uint8_t imageRotate = orient0;               // choices are orient0, orient90, orient180, or orient270
 uint8_t digitalFilter = movingAverage;       // choices are normalAverage, movingAverage, IIR
 uint8_t frameAverage = fourFrames;           // choices are oneFrame, twoFrames, fourFrames, and eightFrames
+float emissivity = 0.98f;                    // 0.98 for skin, 0.1 - 0.3 for bare metal, setEmissivity() changes it at any time
 uint8_t IIRAverage = frames0_1;              // choices are frames 0_1, frames125_875, ..., frames825_175
 bool settle_en = true;                       // allow settling (~3 sec) before sensor data made available when sensor operation resumes from suspend
 bool detectMode3 = false;                    // select between detectMode1/2 (detectMode3 = false) and detectMode1/2/3 (detectMode3 = true)
@@ -83,14 +90,24 @@ uint8_t normalModeAlert = absValueAlert, det123ModeAlert = absValueAlert; // cho
 int16_t TaLow = 30, TaHigh = 60, ToLow = 40, ToHigh = 64, TaHyst = 6, ToHyst = 6, pixels = 8; // set temperature thresholds (x 2 since 0.5 C/lsb) for alerts
 int16_t rawTaData = 0, calTaData = 0;
 uint8_t temp = 0, count = 0;
-float temperatures[64];                      //Contains the calculated object temperature of each pixel in the array
-float minTemp, maxTemp, tmpTemp;
+PAF9701FrameRing frameRing;                  // frames read by the acquisition engine, rendered in place by loop()
+PAF9701_Frame * frame;                       // object temperature of each pixel (1/16 C per LSB), alert pixels and status
+int16_t minTemp, maxTemp, tmpTemp;
+PAF9701_Scale colorScale;                    // maps temperatures onto the 200 entry color table
 int16_t output[7];
 uint8_t statusFlag;
-uint32_t alertPixels[2] = {0, 0};
-uint16_t centroidX = 0, centroidY = 0, centroidXold = 0, centroidYold = 0;
-
-volatile bool PAF9701_intFlag = false;       // Logic flag for alert signal
+uint16_t centroidX = 0, centroidY = 0, centroidXold = 0, centroidYold = 0; // Q8 pixel coordinates, 256 per pixel
+int16_t swipeThreshold = 128;                // centroid motion between frames for a swipe, Q8, half a pixel
+PAF9701_Moments moments;                     // weighted centroid, axis angle and elongation of the largest object
+PAF9701_Blob blobs[PAF9701_MAX_BLOBS];       // separate objects in the alert mask, largest kept
+uint8_t blobCount = 0;
+PAF9701Tracker tracker;                      // track IDs across frames and the in/out counter
+float countLine = 3.5f, countBand = 0.5f;    // count line across the middle row, hysteresis in pixels either side
+uint8_t crossedIn, crossedOut;
+uint8_t alertFilter = maskDespeckleStep | maskFillStep; // clean up the alert mask before the centroid, 0 = raw mask, see PAF9701Mask.h
+uint64_t alertMask;
+PAF9701_BusStats busStats;                   // I2C transactions issued and saved by the register shadow
+PAF9701_AcqStats acqStats;                   // INT edge to frame ready latency
 
 PAF9701 PAF9701(&i2c_0);                     // instantiate PAF9701 class
 
@@ -162,13 +179,16 @@ void setup()
       
    while( !(PAF9701.getStatus() & 0x20) ) {}       // wait for flash bootload to complete
    Serial.println("Flash Bootload done!"); Serial.println(" ");
-   PAF9701.initNormalMode(runMode, RframeTime, settle_en);  // select sensor run mode
+   if(!PAF9701.initNormalMode(runMode, RframeTime, settle_en, profile)) {  // select sensor run mode
+     Serial.println("Sample rate too fast for the profile, slowed to its maximum");
+   }
    Serial.print("Sample rate = 0x"); Serial.println(RframeTime, HEX); Serial.println(" ");
 //   PAF9701.initAutoPowerSaveMode(detectMode3, RdetectTime, settle_en);  // select sensor run mode
 //   Serial.print("Sample rate = 0x"); Serial.println(RdetectTime, HEX); Serial.println(" ");
    temp = PAF9701.getPowerSaveMode();
    Serial.print("power save mode register = 0x"); Serial.println(temp, HEX); 
    PAF9701.setFilter(digitalFilter, frameAverage, IIRAverage);
+   PAF9701.setEmissivity(emissivity);
    PAF9701.imageOrientation(imageFlip, imageRotate);
    PAF9701.setAlertMode(normalModeAlert, det123ModeAlert);
    PAF9701.setNormalAlertLimits(TaLow, TaHigh, TaHyst, ToLow, ToHigh, ToHyst, pixels);
@@ -183,6 +203,7 @@ void setup()
    Serial.print("Pixels = "); Serial.print(output[6]); Serial.println(" "); 
    
    PAF9701.setDet123AlertLimits(TaLow, TaHigh, TaHyst, ToLow, ToHigh, ToHyst, pixels);
+   PAF9701.setSnapshotRead(2);                     // re-read frames stitched from two sensor frames
    PAF9701.clearInterrupt();
    PAF9701.resumeOperation();
    if(settle_en) delay(3000); // takes about 3 seconds to settle when settle function enabled
@@ -200,6 +221,9 @@ void setup()
   RTC.enableAlarm(RTC.MATCH_ANY); // alarm once a second
   RTC.attachInterrupt(alarmMatch);
 
+  tracker.setCountLine(false, countLine, countBand);             // true for a line down the middle column
+
+  PAF9701.beginAcquisition(&frameRing, NULL);                     // frames are read in the background of loop()
   attachInterrupt(PAF9701_intPin, PAF9701_inthandler, FALLING);  // attach  interrupt for INT pin output of PAF9701
   PAF9701.clearInterrupt();
 } /* end of setup */
@@ -207,79 +231,80 @@ void setup()
 
 void loop()
 {
-  // PAF9701 interrupt handling
-  if(PAF9701_intFlag) { // data ready or threshold alert
-     PAF9701_intFlag = false;
+  PAF9701.serviceAcquisition();            // next step of a frame read started by the INT pin, if any
 
-  statusFlag = PAF9701.getStatus();
+  // PAF9701 interrupt handling
+  frame = frameRing.consumerSlot();
+  if(frame != NULL) { // data ready or threshold alert
 
-  PAF9701.clearInterrupt();
+  statusFlag = frame->status;              // status, pixels and alert flags from the acquisition
   
   if(statusFlag & 0x08) Serial.println(" To over limit!");
   if(statusFlag & 0x04) Serial.println(" Ta low limit!");
   if(statusFlag & 0x02) Serial.println(" Ta high limit!");
   if(statusFlag & 0x01) Serial.println(" Alert flag!");
 
-  PAF9701.getAlertPixels(alertPixels);
+  // Get min and max temperatures for display, minTemp is also the background for the centroid weights
+  frameMinMax(frame->pixels, 64, &minTemp, &maxTemp);
+  frameScaleInit(&colorScale, minTemp, maxTemp, 199);
+
   count = 0;
   centroidXold = centroidX; // store old centroid values for gesture detection
   centroidYold = centroidY;
-  centroidX = 0;           // get ready for the next centroid calculation
+  alertMask = maskFilter(frame->alertMask, alertFilter); // drop speckles at the pixel threshold
+  count = maskCount(alertMask);
+  blobCount = blobLabel(alertMask, frame->pixels, 8, blobs, PAF9701_MAX_BLOBS); // one blob per hand or person
+  tracker.update(blobs, blobCount);        // every frame, with or without objects
+  centroidX = 0;
   centroidY = 0;
-  for(uint8_t i = 0; i < 32; i++)
-  {
-    if(alertPixels[0] & (1 << i) ) {
-      Serial.print(i); Serial.print(" ");
-      centroidX += i % 8; // pixel index mod 8, x is either of 0, 1, 2, 3, 4, 5, 6 ,7
-      centroidY += i / 8; // centroid with pixel resolution, y is either of 0, 1, 2, 3, 4, 5 ,6, 7
-     count++;
-    }
+  if(blobCount != 0) { // follow the largest object, not the midpoint of all of them
+    PAF9701_Blob * blob = &blobs[blobLargest(blobs, blobCount)];
+    frameMoments(frame->pixels, blob->mask, minTemp, &moments); // heat above the background sets the weights
+    centroidX = moments.x; // sub-pixel, x and y are 0 - 7 times 256
+    centroidY = moments.y;
   }
-  for(uint8_t i = 0; i < 32; i++)
-  {
-    if(alertPixels[1] & (1 << i) ) {
-      centroidX += i % 8;
-      centroidY += 4 + (i / 8);
-      Serial.print(32 + i); Serial.print(" ");
-      count++;
-    }
+  uint64_t alerts = alertMask;
+  while(alerts) {          // visit the alert pixels only
+    Serial.print(maskPop(&alerts)); Serial.print(" ");
   }
-  centroidX = centroidX/count;
-  centroidY = centroidY/count; // calculate the centroid of the pixels
   
   Serial.println(" ");
   if(count != 0) {
-    Serial.print("are the "); Serial.print(count); Serial.println(" alert pixels!");
-    // Output the active pixel centroid
-    Serial.print("Centroid at X = "); Serial.print(centroidX); Serial.print(", Y = "); Serial.println(centroidY); Serial.println(" ");
+    Serial.print("are the "); Serial.print(count); Serial.print(" alert pixels in "); Serial.print(blobCount); Serial.println(" objects!");
+    // Output the centroid of the largest object
+    Serial.print("Centroid at X = "); Serial.print(centroidX / 256.0f, 2); Serial.print(", Y = "); Serial.println(centroidY / 256.0f, 2);
+    Serial.print("Axis at "); Serial.print(moments.angle / 256.0f, 1); Serial.print(" deg, elongation = "); Serial.println(moments.elongation / 256.0f, 2); Serial.println(" ");
    }
+  for(uint8_t ii = 0; ii < PAF9701_MAX_TRACKS; ii++) { // confirmed tracks, tentative ones may still be noise
+    const PAF9701_Track * track = tracker.track(ii);
+    if(track == NULL || track->state == trackTentative) continue;
+    Serial.print("Track "); Serial.print(track->id); Serial.print(" at X = "); Serial.print(track->x, 2); Serial.print(", Y = "); Serial.print(track->y, 2);
+    Serial.print(", moving "); Serial.print(track->vx, 2); Serial.print(", "); Serial.print(track->vy, 2); Serial.println(" pixels/frame");
+  }
+  tracker.lastCrossings(&crossedIn, &crossedOut);
+  if(crossedIn || crossedOut) {             // someone crossed the count line this frame
+    PAF9701_TrackerStats trackerStats;
+    tracker.getStats(&trackerStats);
+    Serial.print("In = "); Serial.print(trackerStats.in); Serial.print(", out = "); Serial.print(trackerStats.out);
+    Serial.print(", occupancy = "); Serial.println(tracker.occupancy());
+  }
   
   if(statusFlag & 0x10) { // check for new data ready
 
   // Get PAF9701 data
   rawTaData = PAF9701.getRawTaData(); // ambient temperature
   calTaData = PAF9701.getCalTaData();
-  PAF9701.getToData(temperatures);    // object temperature
   }
 
-  // Get min and max temperatures for display
-  minTemp = 1000.0f;
-  maxTemp =    0.0f;
-  for(int y=0; y<8; y++){ //go through all the rows
-  for(int x=0; x<8; x++){ //go through all the columns
-    if(temperatures[y+x*8] > maxTemp) maxTemp = temperatures[y+x*8];
-    if(temperatures[y+x*8] < minTemp) minTemp = temperatures[y+x*8];
-    }
-    }
-
   for(int y=0; y<8; y++){ //go through all the rows
+  PAF9701.serviceAcquisition();            // keep reading the next frame while this one is drawn
   for(int x=0; x<8; x++){ //go through all the columns
-    tmpTemp = temperatures[y+x*8];
-    Serial.print(tmpTemp, 1); Serial.print(","); // use the serial monitor to plot the data, TFT diplay would be better
+    tmpTemp = frame->pixels[y+x*8];
+    Serial.print(frameCelsius(tmpTemp), 1); Serial.print(","); // use the serial monitor to plot the data, TFT diplay would be better
     if(x == 7) Serial.println(" "); 
     if(y+x*8 == 63) Serial.println(" "); 
 
-    rgb =(uint8_t) (((tmpTemp - minTemp)/(maxTemp - minTemp)) * 199); // 0 - 199 = 200 possible rgb color values
+    rgb = frameScale(&colorScale, tmpTemp);  // 0 - 199 = 200 possible rgb color values
 
     red   = rgb_colors[rgb*3] >> 3;          // keep 5 MS bits
     green = rgb_colors[rgb*3 + 1] >> 2;      // keep 6 MS bits
@@ -297,30 +322,44 @@ void loop()
     tft.setTextColor(WHITE);
     
     if((centroidX != 0)  &&  (centroidY != 0) ) { // show centroid of alert pixels on the display as white X
-    tft.setCursor((centroidX + 0.5)*16, (160 - (centroidY + 0.5)*16)); tft.print("X"); // write symbol on centroid location, reverse Y screen direction
+    tft.setCursor((centroidX + 128) >> 4, 160 - ((centroidY + 128) >> 4)); tft.print("X"); // write symbol on centroid location, reverse Y screen direction
     }
     
     tft.setCursor(32, 4 );                   // write min,max temperature on non-data patch
-    tft.print("min T = "); tft.print((uint8_t) minTemp); tft.print(" C");
+    tft.print("min T = "); tft.print((uint8_t) (minTemp / PAF9701_TO_LSB_PER_C)); tft.print(" C");
     tft.setCursor(32, 20 );
-    tft.print("max T = "); tft.print((uint8_t) maxTemp); tft.print(" C");
+    tft.print("max T = "); tft.print((uint8_t) (maxTemp / PAF9701_TO_LSB_PER_C)); tft.print(" C");
     tft.setRotation(3);                      // 0, 2 are portrait mode, 1,3 are landscape mode
 
     // use change in centroid to detect hand gestures
     if((centroidX != 0)  &&  (centroidY != 0) && (centroidXold != 0)  &&  (centroidYold != 0) ) { // check if there is a history of centroids
 
-       if((centroidX - centroidXold) > 1) Serial.println("Swipe right!"); // look for > than one pixel change in centroid
-       if((centroidXold - centroidX) > 1) Serial.println("Swipe left!");
-       if((centroidY - centroidYold) > 1) Serial.println("Swipe down!");
-       if((centroidYold - centroidY) > 1) Serial.println("Swipe up!");
+       if((centroidX - centroidXold) > swipeThreshold) Serial.println("Swipe right!"); // look for > than swipeThreshold change in centroid
+       if((centroidXold - centroidX) > swipeThreshold) Serial.println("Swipe left!");
+       if((centroidY - centroidYold) > swipeThreshold) Serial.println("Swipe down!");
+       if((centroidYold - centroidY) > swipeThreshold) Serial.println("Swipe up!");
      centroidXold = 0;
      centroidYold = 0;
     }
     
     if(SerialDebug) {
-      Serial.print("min T = "); Serial.println((uint8_t) minTemp);
-      Serial.print("max T = "); Serial.println((uint8_t) maxTemp);
+      Serial.print("min T = "); Serial.println((uint8_t) (minTemp / PAF9701_TO_LSB_PER_C));
+      Serial.print("max T = "); Serial.println((uint8_t) (maxTemp / PAF9701_TO_LSB_PER_C));
+      PAF9701.getBusStats(&busStats);
+      Serial.print("I2C transactions this frame = "); Serial.print(busStats.transactions);
+      Serial.print(", saved = "); Serial.println(busStats.bankSelectsSaved + busStats.readsSaved);
+      if(busStats.snapshotRetries || busStats.tornFrames) {
+        Serial.print("frame re-reads = "); Serial.print(busStats.snapshotRetries); Serial.print(", torn = "); Serial.println(busStats.tornFrames);
+      }
+      PAF9701.getAcquisitionStats(&acqStats);
+      Serial.print("INT to frame ready = "); Serial.print(acqStats.lastLatency); Serial.print(" us, max = "); Serial.print(acqStats.maxLatency);
+      Serial.print(" us, average = "); Serial.print(acqStats.totalLatency / acqStats.frames); Serial.println(" us");
+      if(acqStats.overruns || frameRing.getDrops()) {
+        Serial.print("frame overruns = "); Serial.print(acqStats.overruns); Serial.print(", dropped = "); Serial.println(frameRing.getDrops());
+      }
     }  
+    PAF9701.resetBusStats();                 // count transactions per frame
+    frameRing.release();                     // slot goes back to the acquisition engine
   } /* end of PAF9701 interrupt handling
 
  
@@ -365,7 +404,7 @@ void loop()
 //  PAF9701.suspendOperation(); // PAF9701 uses about 750 uA in suspend mode
     
 //    STM32.stop();        // Enter STOP mode and wait for an interrupt
-    STM32.sleep();        // Enter SLEEP mode and wait for an interrupt
+    if(!PAF9701.acquisitionBusy() && !frameRing.available()) STM32.sleep();  // Enter SLEEP mode and wait for an interrupt, unless there is frame work left
    
 }  /* end of loop*/
 
@@ -373,7 +412,7 @@ void loop()
 /* Useful functions */
 void PAF9701_inthandler()
 {
-  PAF9701_intFlag = true; 
+  PAF9701.startAcquisition(); 
 }
 
 
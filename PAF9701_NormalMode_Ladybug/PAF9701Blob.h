@@ -0,0 +1,44 @@
+/* Copyright Tlera Corporation
+ *
+ *  Connected-component labeling of 8 x 8 pixel masks: the alert mask of a frame or a mask from
+ *  frameThreshold(), one entry per separate object so that two hands or two people are two
+ *  blobs rather than one centroid halfway between them.
+ *
+ *  Components are grown on the bitboard (see PAF9701Mask.h): the lowest set pixel left is the
+ *  seed and the blob is dilated inside the mask until it stops growing, a few shifts per pass
+ *  and at most one pass per pixel of its longest path. Statistics come from the blob mask and
+ *  the pixels, 1/16 C as returned by getToDataRaw(). Blobs go into a caller supplied array,
+ *  nothing is allocated.
+ *
+ *    PAF9701_Blob blobs[PAF9701_MAX_BLOBS];
+ *    uint8_t found = blobLabel(frame->alertMask, frame->pixels, 8, blobs, PAF9701_MAX_BLOBS);
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#ifndef PAF9701Blob_h
+#define PAF9701Blob_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PAF9701_MAX_BLOBS   8   // typical blob array size, an 8 x 8 frame rarely holds more separate objects
+
+typedef struct {
+  uint64_t mask;       // pixels of the blob
+  uint8_t  area;       // pixels
+  uint8_t  minX, maxX; // bounding box, columns and rows inclusive
+  uint8_t  minY, maxY;
+  uint16_t x, y;       // centroid weighted by temperature above the blob's coolest pixel, Q8 pixel coordinates
+  int16_t  peak;       // hottest pixel, 1/16 C
+  uint8_t  peakIndex;
+  int16_t  mean;       // 1/16 C
+} PAF9701_Blob;
+
+// pixels may be NULL for an unweighted centroid, peak and mean are 0 then; connectivity is 4
+// or 8. When there are more blobs than capacity the largest are kept. Returns the blobs stored.
+uint8_t blobLabel(uint64_t mask, const int16_t * pixels, uint8_t connectivity, PAF9701_Blob * blobs, uint8_t capacity);
+uint8_t blobLargest(const PAF9701_Blob * blobs, uint8_t count);   // index of the largest blob, 0 if count is 0
+
+#endif
@@ -0,0 +1,73 @@
+/* Copyright Tlera Corporation
+ *
+ *  Register fields of the PAF9701 as compile-time constants, included by PAF9701.h.
+ *
+ *  Each field knows its bank, register, shift and width. field.value(v) is an update of that
+ *  one field; updates of the same register combine with | into one mask and one set of bits,
+ *  folded by the compiler when the values are constant, and updates of different registers
+ *  do not compile together. PAF9701::setFields() and the driver's init functions turn an
+ *  update into one queued write, and flushWrites() sends the queue in bank order.
+ *
+ *    PAF9701.setFields(fieldFrameAverage.value(fourFrames) | fieldDigitalFilter.value(movingAverage));
+ *    uint8_t average = PAF9701.getField(fieldFrameAverage);
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#ifndef PAF9701Fields_h
+#define PAF9701Fields_h
+
+template<uint8_t Bank, uint8_t Reg>
+struct PAF9701_RegUpdate {
+  uint8_t mask;      // bits the update sets, the rest keep their value
+  uint8_t bits;
+};
+
+template<uint8_t Bank, uint8_t Reg>
+constexpr PAF9701_RegUpdate<Bank, Reg> operator|(PAF9701_RegUpdate<Bank, Reg> a, PAF9701_RegUpdate<Bank, Reg> b)
+{
+  return {(uint8_t) (a.mask | b.mask), (uint8_t) ((a.bits & ~b.mask) | b.bits)};
+}
+
+template<uint8_t Bank, uint8_t Reg, uint8_t Shift, uint8_t Width>
+struct PAF9701_RegField {
+  constexpr uint8_t mask() const { return (uint8_t) (((1u << Width) - 1) << Shift); }
+  constexpr PAF9701_RegUpdate<Bank, Reg> value(uint8_t v) const { return {mask(), (uint8_t) ((v << Shift) & mask())}; }
+  constexpr uint8_t get(uint8_t reg) const { return (reg & mask()) >> Shift; }
+};
+
+// Bank 0
+constexpr PAF9701_RegField<0x00, PAF9701_POWER_SAVING_MODE, 4, 1> fieldAutoPowerSave = {};
+constexpr PAF9701_RegField<0x00, PAF9701_POWER_SAVING_MODE, 1, 1> fieldSettleDisable = {};   // 1 = no settle after sensor enable
+constexpr PAF9701_RegField<0x00, PAF9701_ONE_SHOT_MODE,     0, 1> fieldOneShot = {};
+constexpr PAF9701_RegField<0x00, PAF9701_GPIO0_OPEN_DRAIN,  0, 1> fieldOpenDrain = {};
+constexpr PAF9701_RegField<0x00, PAF9701_ALERT_MODE,        2, 2> fieldNormalAlertMode = {};  // alertMode
+constexpr PAF9701_RegField<0x00, PAF9701_ALERT_MODE,        0, 2> fieldDet123AlertMode = {};
+
+// Bank 1, filters and the upper 3 bits of the 11 bit limits
+constexpr PAF9701_RegField<0x01, PAF9701_FILTER_SEL,          5, 2> fieldFrameAverage = {};    // frameAverage
+constexpr PAF9701_RegField<0x01, PAF9701_FILTER_SEL,          3, 2> fieldDigitalFilter = {};   // digitalFilter
+constexpr PAF9701_RegField<0x01, PAF9701_FILTER_SEL,          0, 3> fieldIIRAverage = {};      // IIRAverage
+constexpr PAF9701_RegField<0x01, PAF9701_TA_LOW_LIMIT_H,      0, 3> fieldTaLowLimitH = {};
+constexpr PAF9701_RegField<0x01, PAF9701_TA_HIGH_LIMIT_H,     0, 3> fieldTaHighLimitH = {};
+constexpr PAF9701_RegField<0x01, PAF9701_TO_LOW_LIMIT_H,      0, 3> fieldToLowLimitH = {};
+constexpr PAF9701_RegField<0x01, PAF9701_TO_HIGH_LIMIT_H,     0, 3> fieldToHighLimitH = {};
+constexpr PAF9701_RegField<0x01, PAF9701_DET_TA_LOW_LIMIT_H,  0, 3> fieldDetTaLowLimitH = {};
+constexpr PAF9701_RegField<0x01, PAF9701_DET_TA_HIGH_LIMIT_H, 0, 3> fieldDetTaHighLimitH = {};
+constexpr PAF9701_RegField<0x01, PAF9701_DET_TO_LOW_LIMIT_H,  0, 3> fieldDetToLowLimitH = {};
+constexpr PAF9701_RegField<0x01, PAF9701_DET_TO_HIGH_LIMIT_H, 0, 3> fieldDetToHighLimitH = {};
+
+// Bank 3
+constexpr PAF9701_RegField<0x03, PAF9701_ORIENTATION, 2, 2> fieldImageFlip = {};     // imageFlip
+constexpr PAF9701_RegField<0x03, PAF9701_ORIENTATION, 0, 2> fieldImageRotate = {};   // imageRotate
+
+// Bank 4
+constexpr PAF9701_RegField<0x04, PAF9701_P0_SELECT, 0, 1> fieldWindowEnable = {};
+constexpr PAF9701_RegField<0x04, PAF9701_P0_WOI_V,  4, 4> fieldWindowFirstRow = {};
+constexpr PAF9701_RegField<0x04, PAF9701_P0_WOI_V,  0, 4> fieldWindowLastRow = {};
+constexpr PAF9701_RegField<0x04, PAF9701_P0_WOI_H,  4, 4> fieldWindowFirstColumn = {};
+constexpr PAF9701_RegField<0x04, PAF9701_P0_WOI_H,  0, 4> fieldWindowLastColumn = {};
+constexpr PAF9701_RegField<0x04, PAF9701_SKIP_MODE, 0, 1> fieldSkipMode = {};        // detect mode 3
+
+#endif
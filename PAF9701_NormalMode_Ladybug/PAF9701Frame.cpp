@@ -0,0 +1,151 @@
+/* Copyright Tlera Corporation
+ *
+ *  Fixed-point processing of PAF9701 object temperature frames, see PAF9701Frame.h.
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include "PAF9701Frame.h"
+#include "PAF9701Mask.h"
+#include <string.h>
+
+
+void frameMinMax(const int16_t * pixels, uint8_t count, int16_t * minT, int16_t * maxT)
+{
+  int16_t lo = pixels[0], hi = pixels[0];
+  for(uint8_t ii = 1; ii < count; ii++) {
+    if(pixels[ii] < lo) lo = pixels[ii];
+    if(pixels[ii] > hi) hi = pixels[ii];
+  }
+  *minT = lo;
+  *maxT = hi;
+}
+
+
+void frameMinMaxMasked(const int16_t * pixels, uint64_t mask, int16_t * minT, int16_t * maxT)
+{
+  int16_t lo = INT16_MAX, hi = INT16_MIN;
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    if(!(mask & ((uint64_t) 1 << ii))) continue;
+    if(pixels[ii] < lo) lo = pixels[ii];
+    if(pixels[ii] > hi) hi = pixels[ii];
+  }
+  if(lo > hi) lo = hi = 0;       // empty mask
+  *minT = lo;
+  *maxT = hi;
+}
+
+
+void frameScaleInit(PAF9701_Scale * scale, int16_t minT, int16_t maxT, uint8_t range)
+{
+  uint16_t span = maxT > minT ? (uint16_t) (maxT - minT) : 1;  // flat frame maps to 0
+  scale->offset = minT;
+  scale->span   = span;
+  scale->mult   = (((uint32_t) range << 16) + span - 1) / span;  // round up so maxT reaches range
+  scale->range  = range;
+}
+
+
+uint64_t frameThreshold(const int16_t * pixels, int16_t level)
+{
+  uint64_t mask = 0;
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    if(pixels[ii] >= level) mask |= (uint64_t) 1 << ii;
+  }
+  return mask;
+}
+
+
+uint8_t frameCentroid(uint64_t mask, uint16_t * x, uint16_t * y)
+{
+  PAF9701_MaskMoments m;
+  maskMoments(mask, &m);               // popcounts, no per pixel loop
+  if(m.count == 0) {
+    *x = 0;
+    *y = 0;
+    return 0;
+  }
+  *x = ((uint32_t) m.sumX << 8) / m.count;  // Q8, 1/256 pixel
+  *y = ((uint32_t) m.sumY << 8) / m.count;
+  return m.count;
+}
+
+
+// CORDIC vectoring: rotates (x, y) onto the x axis, returns its angle in Q8 degrees and the
+// length in *length, for x, y below 2^21
+static int32_t frameAtan2(int32_t y, int32_t x, uint32_t * length)
+{
+  static const int16_t atanTable[14] = {11520, 6801, 3593, 1824, 916, 458, 229, 115, 57, 29, 14, 7, 4, 2};  // atan(2^-i), Q8 degrees
+  int32_t angle = 0;
+  if(x < 0) {                          // start in the right half plane
+    angle = y >= 0 ? 180 * 256 : -180 * 256;
+    x = -x;
+    y = -y;
+  }
+  x <<= 8;                             // room for the fraction bits of the shifts
+  y <<= 8;
+  for(uint8_t ii = 0; ii < 14; ii++) {
+    int32_t dx = x >> ii, dy = y >> ii;
+    if(y > 0) { x += dy; y -= dx; angle += atanTable[ii]; }
+    else      { x -= dy; y += dx; angle -= atanTable[ii]; }
+  }
+  *length = ((uint64_t) x * 39797) >> 24;  // times 1 / 1.64676 (Q16), undo the << 8
+  return angle;
+}
+
+
+uint8_t frameMoments(const int16_t * pixels, uint64_t mask, int16_t base, PAF9701_Moments * moments)
+{
+  uint32_t sumW = 0, sumX = 0, sumY = 0, sumXX = 0, sumYY = 0, sumXY = 0;
+  uint8_t count = 0;
+  while(mask) {                        // 64 weights of at most 2^16 times 49 fit 32 bits
+    uint8_t ii = __builtin_ctzll(mask);
+    mask &= mask - 1;
+    if(pixels[ii] <= base) continue;
+    uint32_t w = pixels[ii] - base;
+    uint8_t x = ii & 7, y = ii >> 3;
+    sumW  += w;
+    sumX  += w * x;
+    sumY  += w * y;
+    sumXX += w * x * x;
+    sumYY += w * y * y;
+    sumXY += w * x * y;
+    count++;
+  }
+  memset(moments, 0, sizeof(*moments));
+  moments->count = count;
+  if(count == 0) return 0;
+  moments->heat = sumW;
+  moments->x = ((uint64_t) sumX << 8) / sumW;
+  moments->y = ((uint64_t) sumY << 8) / sumW;
+  // central moments times W^2, W sum(w x^2) - sum(w x)^2, exact in 64 bits
+  int64_t w2 = (int64_t) sumW * sumW;
+  int64_t cxx = (int64_t) sumW * sumXX - (int64_t) sumX * sumX;
+  int64_t cyy = (int64_t) sumW * sumYY - (int64_t) sumY * sumY;
+  int64_t cxy = (int64_t) sumW * sumXY - (int64_t) sumX * sumY;
+  moments->xx = (int32_t) ((cxx << 8) / w2);
+  moments->yy = (int32_t) ((cyy << 8) / w2);
+  moments->xy = (int32_t) ((cxy << 8) / w2);
+  // axes of the covariance: major, minor = (xx + yy +- r) / 2 with r = |(xx - yy, 2 xy)|, the
+  // major axis at half the angle of that vector; taken before the division by W^2, scaled so
+  // the trace, which bounds both components, fits the CORDIC, so small blobs keep their precision
+  int64_t trace = cxx + cyy;
+  uint8_t shift = 0;
+  while((trace >> shift) >= ((int64_t) 1 << 20)) shift++;
+  uint32_t r;
+  int32_t angle = frameAtan2((int32_t) ((2 * cxy) >> shift), (int32_t) ((cxx - cyy) >> shift), &r);
+  int64_t t = trace >> shift;
+  if((int64_t) r > t) r = (uint32_t) t;  // rounding, a real covariance has r <= trace
+  moments->angle = (int16_t) (angle / 2);
+  moments->major = (uint32_t) ((((t + r) << shift) << 7) / w2);  // / 2, Q8
+  moments->minor = (uint32_t) ((((t - r) << shift) << 7) / w2);
+  moments->elongation = t + r > 0 ? (uint16_t) (((uint64_t) r << 9) / (t + r)) : 0;
+  return count;
+}
+
+
+float frameCelsius(int16_t raw)
+{
+  return (float) raw * 0.0625f;
+}
@@ -0,0 +1,121 @@
+/* Copyright Tlera Corporation
+ *
+ *  Several PAF9701s on one wired-OR INT line, see PAF9701IntDemux.h.
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include "PAF9701IntDemux.h"
+
+static_assert(PAF9701_DEMUX_SENSORS <= 8, "service() keeps the sensors with stray flags in an 8 bit set");
+
+
+PAF9701IntDemux::PAF9701IntDemux(uint8_t intPin)
+{
+  _intPin = intPin;
+  _sensorCount = 0;
+  _callback = NULL;
+  _edgePending = false;
+  _recheck = false;
+  resetStats();
+}
+
+
+int8_t PAF9701IntDemux::add(PAF9701 * sensor, uint8_t intFlags, bool acquire)
+{
+  if(_sensorCount == PAF9701_DEMUX_SENSORS) return -1;
+  _sensors[_sensorCount] = sensor;
+  _intFlags[_sensorCount] = intFlags;
+  _acquire[_sensorCount] = acquire;
+  return _sensorCount++;
+}
+
+
+void PAF9701IntDemux::setCallback(PAF9701_IntCallback callback)
+{
+  _callback = callback;
+}
+
+
+void PAF9701IntDemux::handleInterrupt()
+{
+  _edge = micros();
+  _edges++;
+  _edgePending = true;
+}
+
+
+/* Finding the sources
+ * A pass runs on a new edge, or when the line is still low after the frames dispatched by the
+ * last pass have been read, which is the only sign of a sensor that asserted while the line was
+ * held. Sensors with a frame read in progress still hold their flag and are skipped.
+ * A pass that finds nothing while the line is low means a sensor is asserting INT for a flag
+ * it was not added for (an alert on a sensor added for frame updates), which would hold the
+ * line for good; those sensors have their interrupt cleared. A frame flag raised between their
+ * status read and the clear is lost with it.
+ */
+uint8_t PAF9701IntDemux::service()
+{
+  uint32_t edge;
+  if(_edgePending) {
+    _edgePending = false;    // before taking the edge time so a new edge is never lost
+    edge = _edge;
+  }
+  else {
+    if(!_recheck) return 0;
+    for(uint8_t ii = 0; ii < _sensorCount; ii++) {
+      if(_sensors[ii]->acquisitionBusy()) return 0;   // its frame read will release the line
+    }
+    _recheck = false;
+    if(digitalRead(_intPin) == HIGH) return 0;
+    edge = micros();
+  }
+
+  uint8_t dispatched = 0, strays = 0;
+  _stats.scans++;
+  for(uint8_t ii = 0; ii < _sensorCount; ii++) {
+    if(_sensors[ii]->acquisitionBusy()) continue;
+    uint8_t status = _sensors[ii]->getStatus();
+    _stats.statusReads++;
+    if(!(status & _intFlags[ii])) {
+      if(status & 0x1F) strays |= 1 << ii;   // a frame update or alert flag it was not added for
+      continue;
+    }
+    uint32_t wait = micros() - edge;
+    _stats.dispatches++;
+    _stats.totalDelay += wait;
+    if(wait > _stats.maxDelay) _stats.maxDelay = wait;
+    if(_callback) _callback(ii, status, edge);
+    if(_acquire[ii]) _sensors[ii]->startAcquisition(edge);
+    else _sensors[ii]->clearInterrupt();
+    dispatched++;
+  }
+  if(dispatched) _recheck = true;
+  else {
+    _stats.emptyScans++;
+    if(strays && digitalRead(_intPin) == LOW) {   // one of them holds the line, no other sensor can make an edge
+      for(uint8_t ii = 0; ii < _sensorCount; ii++) {
+        if(!(strays & (1 << ii))) continue;
+        _sensors[ii]->clearInterrupt();
+        _stats.strayClears++;
+      }
+      _recheck = true;       // a sensor that asserted meanwhile made no edge either
+    }
+  }
+  return dispatched;
+}
+
+
+void PAF9701IntDemux::getStats(PAF9701_DemuxStats * stats)
+{
+  *stats = _stats;
+  stats->edges = _edges;
+}
+
+
+void PAF9701IntDemux::resetStats()
+{
+  memset(&_stats, 0, sizeof(_stats));
+  _edges = 0;
+}
@@ -0,0 +1,71 @@
+/* Copyright Tlera Corporation
+ *
+ *  Several PAF9701s with open drain INT outputs on one wired-OR MCU pin (with a pull-up).
+ *
+ *  The pin interrupt only notes the falling edge. service() then reads the status of each
+ *  sensor in priority order (the order of add()) and dispatches every sensor whose INT flags
+ *  are set: the callback gets the sensor index, its status and the edge time, and the sensor's
+ *  acquisition engine is started, which clears the flag and releases the line when the frame
+ *  has been read. Sensors added without acquisition have their interrupt cleared right after
+ *  the callback instead.
+ *
+ *  On a wired-OR line a second sensor asserting while the line is already low makes no edge.
+ *  So after a pass that dispatched something, service() looks at the pin level again once the
+ *  dispatched frames are read, and scans again if the line is still low. Added latency is one
+ *  status read per sensor ahead in priority order, or at most one frame read when the line
+ *  was already held.
+ *
+ *    sensor.setInterruptOpenDrain(true);    // for every sensor on the line
+ *    demux.add(&sensor);                    // highest priority first
+ *    attachInterrupt(intPin, intHandler, FALLING);   // intHandler() calls demux.handleInterrupt()
+ *    loop(): demux.service(); then serviceAcquisition() or PAF9701Group::service()
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#ifndef PAF9701IntDemux_h
+#define PAF9701IntDemux_h
+
+#include "PAF9701.h"
+
+#define PAF9701_DEMUX_SENSORS  8   // sensors per line
+
+typedef void (*PAF9701_IntCallback)(uint8_t sensor, uint8_t status, uint32_t edge);
+
+typedef struct {
+  uint32_t edges;            // falling edges on the line
+  uint32_t scans;            // passes over the sensors
+  uint32_t statusReads;      // bus reads spent finding the sources
+  uint32_t dispatches;       // sensor events dispatched
+  uint32_t emptyScans;       // passes that found no sensor asserting
+  uint32_t strayClears;      // interrupts cleared for a flag outside the sensor's intFlags
+  uint32_t maxDelay;         // us from the edge to a dispatch
+  uint32_t totalDelay;       // sum over all dispatches, for the average
+} PAF9701_DemuxStats;
+
+class PAF9701IntDemux
+{
+  public:
+  PAF9701IntDemux(uint8_t intPin);
+  int8_t add(PAF9701 * sensor, uint8_t intFlags = 0x10, bool acquire = true);  // flags that assert INT: 0x10 frame update, 0x01 alert
+  void setCallback(PAF9701_IntCallback callback);
+  void handleInterrupt();     // call from the pin interrupt handler
+  uint8_t service();          // call from loop(), returns sensors dispatched
+  void getStats(PAF9701_DemuxStats * stats);
+  void resetStats();
+  private:
+  uint8_t _intPin;
+  PAF9701 * _sensors[PAF9701_DEMUX_SENSORS];
+  uint8_t _intFlags[PAF9701_DEMUX_SENSORS];
+  bool _acquire[PAF9701_DEMUX_SENSORS];
+  uint8_t _sensorCount;
+  PAF9701_IntCallback _callback;
+  volatile bool _edgePending;                     // set by handleInterrupt() in interrupt context
+  volatile uint32_t _edge;                        // micros() at the falling edge
+  volatile uint32_t _edges;
+  bool _recheck;                                  // last pass dispatched, look at the line level again
+  PAF9701_DemuxStats _stats;
+};
+
+#endif
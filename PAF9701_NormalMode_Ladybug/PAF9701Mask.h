@@ -0,0 +1,176 @@
+/* Copyright Tlera Corporation
+ *
+ *  8 x 8 pixel masks (bitboards) as used by PAF9701_Frame::alertMask, getAlertPixels() and
+ *  frameThreshold(): bit i is pixel i, column i % 8, row i / 8, so row r is byte r of the mask.
+ *
+ *  Everything here works on the whole mask at once. Set pixels are visited with count trailing
+ *  zeros instead of testing all 64 bits, projections are per byte (rows) or per bit plane
+ *  (columns), shifts mask off the pixels that would wrap into the next row, and the moment sums
+ *  are popcounts of the mask against the bit planes of the column and row numbers: column x is
+ *  x0 + 2 x1 + 4 x2, so the sum of x over the mask is pop(m & X0) + 2 pop(m & X1) + 4 pop(m & X2).
+ *
+ *    uint64_t alerts = PAF9701.getAlertPixels();
+ *    while(alerts) { uint8_t i = maskPop(&alerts); ... }
+ *
+ *  Morphology is bit-parallel too: a dilation ORs the mask with its shifts by one pixel, four
+ *  neighbours (4-connectivity) or eight (8-connectivity), and an erosion is the dilation of the
+ *  background, so pixels beyond the edge count as set and an object at the edge of the frame is
+ *  not eaten away. Open removes speckles smaller than the structuring element, close bridges
+ *  one pixel gaps and maskFillHoles() sets background not connected to the frame edge. On an
+ *  8 x 8 frame opening also removes a 2 pixel wide object; maskDespeckle() only drops pixels
+ *  without a set neighbour.
+ *  maskFilter() chains them as a pre-stage before centroid and gesture steps:
+ *
+ *    uint64_t alerts = maskFilter(frame->alertMask, maskOpenStep | maskFillStep);
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#ifndef PAF9701Mask_h
+#define PAF9701Mask_h
+
+#include <stdint.h>
+
+#define PAF9701_MASK_ALL        0xFFFFFFFFFFFFFFFFULL
+#define PAF9701_MASK_COLUMN0    0x0101010101010101ULL   // column 0, shift left by x for column x
+#define PAF9701_MASK_ROW0       0x00000000000000FFULL   // row 0, shift left by 8 y for row y
+
+// pixels whose column (X) or row (Y) number has bit 0, 1 or 2 set
+#define PAF9701_MASK_X0         0xAAAAAAAAAAAAAAAAULL
+#define PAF9701_MASK_X1         0xCCCCCCCCCCCCCCCCULL
+#define PAF9701_MASK_X2         0xF0F0F0F0F0F0F0F0ULL
+#define PAF9701_MASK_Y0         0xFF00FF00FF00FF00ULL
+#define PAF9701_MASK_Y1         0xFFFF0000FFFF0000ULL
+#define PAF9701_MASK_Y2         0xFFFFFFFF00000000ULL
+
+#define PAF9701_MASK_BORDER     0xFF818181818181FFULL   // first and last row and column
+
+enum maskFilterStep { // maskFilter() steps, applied in this order
+ maskDespeckleStep  = 0x01,   // drop pixels with no set neighbour
+ maskOpenStep       = 0x02,   // erode then dilate, drops speckles and anything thinner than 3 pixels
+ maskCloseStep      = 0x04,   // dilate then erode, bridges gaps
+ maskFillStep       = 0x08,   // fill enclosed holes
+ maskConnect8       = 0x10    // 8 neighbours for open and close, 4 (default) otherwise
+};
+
+typedef struct {
+  uint8_t  count;    // pixels
+  uint16_t sumX;     // sum of column numbers
+  uint16_t sumY;     // sum of row numbers
+  uint16_t sumXX;    // sum of column squared
+  uint16_t sumYY;
+  uint16_t sumXY;
+} PAF9701_MaskMoments;
+
+
+static inline uint64_t maskPixel(uint8_t x, uint8_t y) { return (uint64_t) 1 << (y * 8 + x); }
+static inline bool maskTest(uint64_t mask, uint8_t x, uint8_t y) { return (mask >> (y * 8 + x)) & 1; }
+static inline uint8_t maskCount(uint64_t mask) { return (uint8_t) __builtin_popcountll(mask); }
+
+// index of the lowest set pixel, which is cleared; mask must not be 0
+static inline uint8_t maskPop(uint64_t * mask)
+{
+  uint8_t ii = (uint8_t) __builtin_ctzll(*mask);
+  *mask &= *mask - 1;
+  return ii;
+}
+
+// bit r set when row r has a pixel set
+static inline uint8_t maskRows(uint64_t mask)
+{
+  uint8_t rows = 0;
+  for(uint8_t r = 0; r < 8; r++) if((uint8_t) (mask >> (8 * r))) rows |= 1 << r;
+  return rows;
+}
+
+// bit x set when column x has a pixel set: OR the rows together
+static inline uint8_t maskColumns(uint64_t mask)
+{
+  mask |= mask >> 32;
+  mask |= mask >> 16;
+  mask |= mask >> 8;
+  return (uint8_t) mask;
+}
+
+// pixels set per row and per column
+static inline void maskRowCounts(uint64_t mask, uint8_t * counts)
+{
+  for(uint8_t r = 0; r < 8; r++) counts[r] = (uint8_t) __builtin_popcount((uint8_t) (mask >> (8 * r)));
+}
+
+static inline void maskColumnCounts(uint64_t mask, uint8_t * counts)
+{
+  for(uint8_t x = 0; x < 8; x++) counts[x] = (uint8_t) __builtin_popcountll(mask & (PAF9701_MASK_COLUMN0 << x));
+}
+
+// move every pixel dx columns right (negative left) and dy rows down (negative up), pixels
+// shifted off the frame are lost and none wrap into the next or previous row
+static inline uint64_t maskShiftX(uint64_t mask, int8_t dx)
+{
+  if(dx >= 8 || dx <= -8) return 0;
+  if(dx > 0) return (mask << dx) & (PAF9701_MASK_COLUMN0 * (uint8_t) (0xFF << dx));  // columns dx - 7
+  if(dx < 0) return (mask >> -dx) & (PAF9701_MASK_COLUMN0 * (uint8_t) (0xFF >> -dx)); // columns 0 - 7 + dx
+  return mask;
+}
+
+static inline uint64_t maskShiftY(uint64_t mask, int8_t dy)
+{
+  if(dy >= 8 || dy <= -8) return 0;
+  return dy >= 0 ? mask << (8 * dy) : mask >> (-8 * dy);
+}
+
+static inline uint64_t maskShift(uint64_t mask, int8_t dx, int8_t dy) { return maskShiftY(maskShiftX(mask, dx), dy); }
+
+// count, first and second moment sums from popcounts of the mask and the bit planes, no per pixel work
+static inline void maskMoments(uint64_t mask, PAF9701_MaskMoments * m)
+{
+  uint64_t x0 = mask & PAF9701_MASK_X0, x1 = mask & PAF9701_MASK_X1, x2 = mask & PAF9701_MASK_X2;
+  uint64_t y0 = mask & PAF9701_MASK_Y0, y1 = mask & PAF9701_MASK_Y1, y2 = mask & PAF9701_MASK_Y2;
+  uint8_t px0 = maskCount(x0), px1 = maskCount(x1), px2 = maskCount(x2);
+  uint8_t py0 = maskCount(y0), py1 = maskCount(y1), py2 = maskCount(y2);
+  m->count = maskCount(mask);
+  m->sumX  = px0 + 2 * px1 + 4 * px2;
+  m->sumY  = py0 + 2 * py1 + 4 * py2;
+  // x^2 = x0 + 4 x1 + 16 x2 + 4 x0 x1 + 8 x0 x2 + 16 x1 x2 for the bits xi of x, y^2 the same way
+  m->sumXX = px0 + 4 * px1 + 16 * px2 + 4 * maskCount(x0 & x1) + 8 * maskCount(x0 & x2) + 16 * maskCount(x1 & x2);
+  m->sumYY = py0 + 4 * py1 + 16 * py2 + 4 * maskCount(y0 & y1) + 8 * maskCount(y0 & y2) + 16 * maskCount(y1 & y2);
+  // x y = sum of 2^(i + j) xi yj
+  m->sumXY = 0;
+  const uint64_t planes[3] = {x0, x1, x2};
+  for(uint8_t ii = 0; ii < 3; ii++) {
+    m->sumXY += (maskCount(planes[ii] & PAF9701_MASK_Y0) + 2 * maskCount(planes[ii] & PAF9701_MASK_Y1) + 4 * maskCount(planes[ii] & PAF9701_MASK_Y2)) << ii;
+  }
+}
+
+// one pixel dilation and erosion
+static inline uint64_t maskDilate4(uint64_t mask)
+{
+  return mask | maskShiftX(mask, 1) | maskShiftX(mask, -1) | (mask << 8) | (mask >> 8);
+}
+
+static inline uint64_t maskDilate8(uint64_t mask)
+{
+  uint64_t row = mask | maskShiftX(mask, 1) | maskShiftX(mask, -1);  // 3 wide, then 3 high
+  return row | (row << 8) | (row >> 8);
+}
+
+// pixels with at least one of their 8 neighbours set, an isolated pixel is the commonest speckle
+static inline uint64_t maskDespeckle(uint64_t mask)
+{
+  uint64_t sides = maskShiftX(mask, 1) | maskShiftX(mask, -1);
+  uint64_t row = mask | sides;
+  return mask & (sides | (row << 8) | (row >> 8));
+}
+
+static inline uint64_t maskErode4(uint64_t mask) { return ~maskDilate4(~mask); }
+static inline uint64_t maskErode8(uint64_t mask) { return ~maskDilate8(~mask); }
+static inline uint64_t maskOpen4(uint64_t mask)  { return maskDilate4(maskErode4(mask)); }
+static inline uint64_t maskOpen8(uint64_t mask)  { return maskDilate8(maskErode8(mask)); }
+static inline uint64_t maskClose4(uint64_t mask) { return maskErode4(maskDilate4(mask)); }
+static inline uint64_t maskClose8(uint64_t mask) { return maskErode8(maskDilate8(mask)); }
+
+uint64_t maskFillHoles(uint64_t mask);              // background 4-connected to the edge stays, the rest is set
+uint64_t maskFilter(uint64_t mask, uint8_t steps);  // maskFilterStep flags, 0 returns mask
+
+#endif
@@ -20,6 +20,7 @@
 
 #include "RTC.h"
 #include "PAF9701.h"
+#include "PAF9701Frame.h"
 #include <Adafruit_GFX.h>    // Core graphics library, install from Arduino IDE board manager
 #include <Adafruit_ST7735.h> // Hardware-specific library, install from Arduino IDE board manager
 #include "SPI.h"
@@ -60,19 +61,25 @@ float VDDA, VBUS, STM32_Temperature;
 
 // Configure the PAF9701
 uint8_t runMode = normal_mode;               // choices are normal_mode, detection_mode1, detection_mode2, detection_mode3
-uint8_t freq = 4;                            // data rate in Hz, default is 4 Hz, should not be faster than 10 Hz
+uint8_t freq = 4;                            // data rate in Hz, default is 4 Hz, should not be faster than the profile allows
+uint8_t profile = balancedProfile;           // choices are lowLatencyProfile (up to 41 Hz), balancedProfile (up to 10 Hz), lowNoiseProfile (up to 5 Hz)
 uint32_t sampleRate = 200000 / (256 * freq); // maximum frame time is 1342 seconds, minimum ~100 ms
 uint8_t imageFlip = noflipormirror;          // choices are noflipormirror, flip, mirror, flip and mirror
 uint8_t imageRotate = orient0;               // choices are orient0, orient90, orient180, or orient270
 uint8_t digitalFilter = movingAverage;       // choices are normalAverage, movingAverage, IIR
 uint8_t frameAverage = fourFrames;           // choices are oneFrame, twoFrames, fourFrames, and eightFrames
+float emissivity = 0.98f;                    // 0.98 for skin, 0.1 - 0.3 for bare metal, setEmissivity() changes it at any time
 uint8_t IIRAverage = frames0_1;              // choices are frames 0_1, frames125_875, ..., frames825_175
 bool settle_en = false;                      // allow settling (~3 sec) before sensor data made available when sensor operation resumes from suspend
+PAF9701_StartupConfig startupConfig = {      // normal mode, 200 ms reset, 1 s for the bootload, 3 s settle, 2 s for the first frame
+  false, runMode, sampleRate, false, 0, profile, settle_en, 200, 1000, 3000, 2000};
+PAF9701_StartupStats startupStats;
 
 int16_t rawTaData = 0, calTaData = 0;
 uint8_t temp = 0;
-float temperatures[64];                      //Contains the calculated object temperature of each pixel in the array
-float minTemp, maxTemp, tmpTemp;
+int16_t temperatures[64];                    //Contains the object temperature of each pixel in the array, 1/16 C per LSB
+int16_t minTemp, maxTemp, tmpTemp;
+PAF9701_Scale colorScale;                    // maps temperatures onto the 200 entry color table
 
 volatile bool PAF9701_intFlag = false;       // Logic flag for alert signal
 
@@ -143,20 +150,7 @@ void setup()
   {
    Serial.println("PAF9701 is online..."); Serial.println(" ");
 
-   PAF9701.coldReset();                            // software reset before initialization
-   delay(200);                                     // wait 200 ms for reset 
-      
-   while( !(PAF9701.getStatus() & 0x20) ) {}       // wait for flash bootload to complete
-   Serial.println("Flash Bootload done!"); Serial.println(" ");
-   PAF9701.initNormalMode(runMode, sampleRate, settle_en);  // select sensor run mode
-   Serial.print("Sample rate = 0x"); Serial.println(sampleRate, HEX); Serial.println(" ");
-   temp = PAF9701.getPowerSaveMode();
-   Serial.print("power save mode register = 0x"); Serial.println(temp, HEX); 
-   PAF9701.setFilter(digitalFilter, frameAverage, IIRAverage);
-   PAF9701.imageOrientation(imageFlip, imageRotate);
-   PAF9701.clearInterrupt();
-   PAF9701.resumeOperation();
-   if(settle_en) delay(3000); // takes about 3 seconds to settle when settle function enabled
+   PAF9701.beginStartup(&startupConfig);           // reset, bootload, init and settle go on while the rest of setup() runs
   }
   else 
   {
@@ -171,6 +165,30 @@ void setup()
   RTC.enableAlarm(RTC.MATCH_ANY); // alarm once a second
   RTC.attachInterrupt(alarmMatch);
 
+  // finish the PAF9701 startup, more setup work can go in this loop
+  uint8_t startupState = PAF9701_CHIPID == 0x0280 ? startIdle : startFailed;
+  while(startupState != startReady && startupState != startFailed) {
+    startupState = PAF9701.serviceStartup();
+    if(startupState == startConfigure) {          // bootload done and init written, sensor not yet enabled
+      Serial.println("Flash Bootload done!"); Serial.println(" ");
+      Serial.print("Sample rate = 0x"); Serial.println(sampleRate, HEX); Serial.println(" ");
+      temp = PAF9701.getPowerSaveMode();
+      Serial.print("power save mode register = 0x"); Serial.println(temp, HEX); 
+      PAF9701.setFilter(digitalFilter, frameAverage, IIRAverage);
+      PAF9701.setEmissivity(emissivity);
+      PAF9701.imageOrientation(imageFlip, imageRotate);
+    }
+  }
+  PAF9701.getStartupStats(&startupStats);
+  if(startupStats.rateRaised) Serial.println("Sample rate too fast for the profile, slowed to its maximum");
+  if(startupState == startReady) {
+    Serial.print("Bootload done after "); Serial.print(startupStats.bootload); Serial.print(" ms, first frame after "); 
+    Serial.print(startupStats.firstFrame); Serial.println(" ms");
+  }
+  else if(PAF9701_CHIPID == 0x0280) {
+    Serial.print("PAF9701 startup timed out in state "); Serial.println(startupStats.failedState);
+  }
+
   attachInterrupt(PAF9701_intPin, PAF9701_inthandler, FALLING);  // attach  interrupt for INT pin output of PAF9701
   PAF9701.clearInterrupt();
 } /* end of setup */
@@ -186,26 +204,20 @@ void loop()
   // Get PAF9701 data
   rawTaData = PAF9701.getRawTaData(); // ambient temperature
   calTaData = PAF9701.getCalTaData();
-  PAF9701.getToData(temperatures);    // object temperature
+  PAF9701.getToDataRaw(temperatures); // object temperature
 
   // Get min and max temperatures for display
-  minTemp = 1000.0f;
-  maxTemp =    0.0f;
-  for(int y=0; y<8; y++){ //go through all the rows
-  for(int x=0; x<8; x++){ //go through all the columns
-    if(temperatures[y+x*8] > maxTemp) maxTemp = temperatures[y+x*8];
-    if(temperatures[y+x*8] < minTemp) minTemp = temperatures[y+x*8];
-    }
-    }
+  frameMinMax(temperatures, 64, &minTemp, &maxTemp);
+  frameScaleInit(&colorScale, minTemp, maxTemp, 199);
 
   for(int y=0; y<8; y++){ //go through all the rows
   for(int x=0; x<8; x++){ //go through all the columns
     tmpTemp = temperatures[y+x*8];
-    Serial.print(tmpTemp, 1); Serial.print(","); // use the serial monitor to plot the data, TFT diplay would be better
+    Serial.print(frameCelsius(tmpTemp), 1); Serial.print(","); // use the serial monitor to plot the data, TFT diplay would be better
     if(x == 7) Serial.println(" "); 
     if(y+x*8 == 63) Serial.println(" "); 
 
-    rgb =(uint8_t) (((tmpTemp - minTemp)/(maxTemp - minTemp)) * 199); // 0 - 199 = 200 possible rgb color values
+    rgb = frameScale(&colorScale, tmpTemp);  // 0 - 199 = 200 possible rgb color values
 
     red   = rgb_colors[rgb*3] >> 3;          // keep 5 MS bits
     green = rgb_colors[rgb*3 + 1] >> 2;      // keep 6 MS bits
@@ -221,14 +233,14 @@ void loop()
     tft.setTextSize(0);
     tft.setTextColor(WHITE);
     tft.setCursor(32, 4 );                   // write min,max temperature on non-data patch
-    tft.print("min T = "); tft.print((uint8_t) minTemp); tft.print(" C");
+    tft.print("min T = "); tft.print((uint8_t) (minTemp / PAF9701_TO_LSB_PER_C)); tft.print(" C");
     tft.setCursor(32, 20 );
-    tft.print("max T = "); tft.print((uint8_t) maxTemp); tft.print(" C");
+    tft.print("max T = "); tft.print((uint8_t) (maxTemp / PAF9701_TO_LSB_PER_C)); tft.print(" C");
     tft.setRotation(3);                      // 0, 2 are portrait mode, 1,3 are landscape mode
 
     if(SerialDebug) {
-      Serial.print("min T = "); Serial.println((uint8_t) minTemp);
-      Serial.print("max T = "); Serial.println((uint8_t) maxTemp);
+      Serial.print("min T = "); Serial.println((uint8_t) (minTemp / PAF9701_TO_LSB_PER_C));
+      Serial.print("max T = "); Serial.println((uint8_t) (maxTemp / PAF9701_TO_LSB_PER_C));
     }  
   } /* end of PAF9701 interrupt handling
 
@@ -0,0 +1,228 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host stand-in for the Arduino core, see Arduino.h.
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "Arduino.h"
+
+#define SIM_DEVICES  16
+
+static uint64_t simClock = 0;
+static bool realTime = false;
+static SimDevice * simDevices[SIM_DEVICES];
+static uint8_t simDeviceCount = 0;
+static uint8_t pinLevel[SIM_PINS];
+static void (*pinHandler[SIM_PINS])(void);
+static int pinTrigger[SIM_PINS];
+static uint8_t pinPulls[SIM_PINS];     // open drain outputs holding each pin low
+
+HardwareSerial Serial;
+
+
+unsigned long millis()
+{
+  return (unsigned long) (simNow() / 1000000);
+}
+
+
+unsigned long micros()
+{
+  return (unsigned long) (simNow() / 1000);
+}
+
+
+void delay(unsigned long ms)
+{
+  simAdvance((uint64_t) ms * 1000000);
+}
+
+
+void delayMicroseconds(unsigned int us)
+{
+  simAdvance((uint64_t) us * 1000);
+}
+
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if(pin < SIM_PINS && mode == INPUT_PULLUP) pinLevel[pin] = HIGH;
+}
+
+
+void digitalWrite(uint8_t pin, uint8_t level)
+{
+  simSetPin(pin, level);
+}
+
+
+int digitalRead(uint8_t pin)
+{
+  return pin < SIM_PINS ? pinLevel[pin] : LOW;
+}
+
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode)
+{
+  if(pin >= SIM_PINS) return;
+  pinHandler[pin] = handler;
+  pinTrigger[pin] = mode;
+}
+
+
+void detachInterrupt(uint8_t pin)
+{
+  if(pin < SIM_PINS) pinHandler[pin] = NULL;
+}
+
+
+void simAttach(SimDevice * device)
+{
+  if(simDeviceCount < SIM_DEVICES) simDevices[simDeviceCount++] = device;
+}
+
+
+void simDetach(SimDevice * device)
+{
+  for(uint8_t ii = 0; ii < simDeviceCount; ii++) {
+    if(simDevices[ii] == device) {
+      simDevices[ii] = simDevices[--simDeviceCount];
+      return;
+    }
+  }
+}
+
+
+void simAdvance(uint64_t ns)
+{
+  if(realTime) {
+    struct timespec wait = {(time_t) (ns / 1000000000), (long) (ns % 1000000000)};
+    nanosleep(&wait, NULL);
+    return;
+  }
+  uint64_t target = simClock + ns;
+  while(true) {
+    SimDevice * next = NULL;
+    uint64_t when = target;
+    for(uint8_t ii = 0; ii < simDeviceCount; ii++) {
+      uint64_t event = simDevices[ii]->nextEvent();
+      if(event <= when) {
+        when = event;
+        next = simDevices[ii];
+      }
+    }
+    if(when > simClock) simClock = when;
+    if(next == NULL) return;
+    next->tick(simClock);
+  }
+}
+
+
+uint64_t simNow()
+{
+  if(realTime) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+  }
+  return simClock;
+}
+
+
+void simRealTime(bool enable)
+{
+  realTime = enable;
+}
+
+
+void simSetPin(uint8_t pin, uint8_t level)
+{
+  if(pin >= SIM_PINS || pinLevel[pin] == level) return;
+  pinLevel[pin] = level;
+  int edge = level ? RISING : FALLING;
+  if(pinHandler[pin] && (pinTrigger[pin] == edge || pinTrigger[pin] == CHANGE)) pinHandler[pin]();
+}
+
+
+void simPullLow(uint8_t pin, bool pull)
+{
+  if(pin >= SIM_PINS) return;
+  if(pull) pinPulls[pin]++;
+  else if(pinPulls[pin]) pinPulls[pin]--;
+  simSetPin(pin, pinPulls[pin] ? LOW : HIGH);
+}
+
+
+/* Serial goes to stdout */
+void HardwareSerial::begin(unsigned long baud)
+{
+  (void) baud;
+}
+
+
+size_t HardwareSerial::print(const char * text)
+{
+  return fputs(text, stdout) < 0 ? 0 : strlen(text);
+}
+
+
+size_t HardwareSerial::print(char c)
+{
+  return putchar(c) == EOF ? 0 : 1;
+}
+
+
+size_t HardwareSerial::print(unsigned char value, int base)
+{
+  return print((unsigned long) value, base);
+}
+
+
+size_t HardwareSerial::print(int value, int base)
+{
+  return print((long) value, base);
+}
+
+
+size_t HardwareSerial::print(unsigned int value, int base)
+{
+  return print((unsigned long) value, base);
+}
+
+
+size_t HardwareSerial::print(long value, int base)
+{
+  if(base == DEC) return printf("%ld", value);
+  return print((unsigned long) value, base);   // two's complement, as the Arduino core prints it
+}
+
+
+size_t HardwareSerial::print(unsigned long value, int base)
+{
+  char text[8 * sizeof(long) + 1];
+  char * c = &text[sizeof(text) - 1];
+  *c = '\0';
+  if(base < 2) base = DEC;
+  do {
+    uint8_t digit = value % base;
+    *--c = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    value /= base;
+  } while(value);
+  return print(c);
+}
+
+
+size_t HardwareSerial::print(double value, int digits)
+{
+  return printf("%.*f", digits, value);
+}
+
+
+size_t HardwareSerial::println()
+{
+  return print("\n");
+}
@@ -0,0 +1,96 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host stand-in for the parts of the Arduino core used by the PAF9701 library and the host tools.
+ *
+ *  Time is a virtual nanosecond clock that only moves when delay() is called or bus traffic is
+ *  simulated (see SimBus.h), so host runs are deterministic. Device models derived from SimDevice
+ *  are ticked at their next event as the clock passes it, and may drive pins with simSetPin() or
+ *  share a pulled-up line with simPullLow(); a falling or rising edge on a pin calls the handler
+ *  given to attachInterrupt() right away, the way a pin interrupt preempts loop() on the board.
+ *
+ *  With real hardware behind Wire (see LinuxI2C.h) call simRealTime(true): millis() and micros()
+ *  then follow the monotonic clock and delay() sleeps.
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define DEC  10
+#define HEX  16
+#define OCT   8
+#define BIN   2
+
+#define LOW           0
+#define HIGH          1
+#define INPUT         0
+#define OUTPUT        1
+#define INPUT_PULLUP  2
+
+#define CHANGE        1
+#define FALLING       2
+#define RISING        3
+
+#define SIM_PINS     64
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+
+class SimDevice   // a device model that changes state over time
+{
+  public:
+  virtual ~SimDevice() {}
+  virtual uint64_t nextEvent() = 0;      // ns of the next state change, UINT64_MAX for none
+  virtual void tick(uint64_t now) = 0;   // called when the clock reaches nextEvent()
+};
+
+void simAttach(SimDevice * device);
+void simDetach(SimDevice * device);
+void simAdvance(uint64_t ns);            // move the virtual clock, ticking devices on the way
+uint64_t simNow();                       // ns since start
+void simRealTime(bool enable);
+void simSetPin(uint8_t pin, uint8_t level);
+void simPullLow(uint8_t pin, bool pull); // open drain output: the pin is LOW while any device pulls it
+
+
+class HardwareSerial
+{
+  public:
+  void begin(unsigned long baud);
+  size_t print(const char * text);
+  size_t print(char c);
+  size_t print(unsigned char value, int base = DEC);
+  size_t print(int value, int base = DEC);
+  size_t print(unsigned int value, int base = DEC);
+  size_t print(long value, int base = DEC);
+  size_t print(unsigned long value, int base = DEC);
+  size_t print(double value, int digits = 2);
+  size_t println();
+  template<typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+  template<typename T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+  operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,161 @@
+/* Copyright Tlera Corporation
+ *
+ *  Linux i2c-dev adapter for the host TwoWire, see LinuxI2C.h.
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "LinuxI2C.h"
+
+
+static int systemIoctl(int fd, unsigned long request, void * arg)
+{
+  return ioctl(fd, request, arg);
+}
+
+
+static uint64_t monotonicNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+
+LinuxI2C::LinuxI2C(LinuxI2CIoctl ioctlFunction)
+{
+  _fd = -1;
+  _ownFd = false;
+  _ioctl = ioctlFunction ? ioctlFunction : systemIoctl;
+  _batching = false;
+  _msgCount = 0;
+  _dataUsed = 0;
+  _batchError = 0;
+  resetStats();
+}
+
+
+LinuxI2C::~LinuxI2C()
+{
+  end();
+}
+
+
+bool LinuxI2C::begin(const char * device)
+{
+  end();
+  _fd = open(device, O_RDWR);
+  _ownFd = _fd >= 0;
+  return _ownFd;
+}
+
+
+void LinuxI2C::begin(int fd)
+{
+  end();
+  _fd = fd;
+}
+
+
+void LinuxI2C::end()
+{
+  if(_msgCount) send();
+  if(_ownFd) close(_fd);
+  _fd = -1;
+  _ownFd = false;
+}
+
+
+uint8_t LinuxI2C::transfer(uint8_t address, const uint8_t * tx, size_t txCount, uint8_t * rx, size_t rxCount)
+{
+  uint8_t error = 0;
+  uint8_t needed = (txCount > 0) + (rxCount > 0);
+  if(needed == 0) needed = 1;                       // address only, as in I2Cscan()
+  if(_msgCount + needed > I2C_RDWR_IOCTL_MAX_MSGS || _dataUsed + txCount > LINUX_I2C_BATCH_BYTES) {
+    error = send();                                 // no room to hold more
+  }
+  if(txCount > 0 || rxCount == 0) {
+    if(txCount) memcpy(&_data[_dataUsed], tx, txCount);
+    _msgs[_msgCount].addr = address;
+    _msgs[_msgCount].flags = 0;
+    _msgs[_msgCount].len = txCount;
+    _msgs[_msgCount].buf = &_data[_dataUsed];
+    _msgCount++;
+    _dataUsed += txCount;
+  }
+  if(rxCount > 0) {
+    _msgs[_msgCount].addr = address;
+    _msgs[_msgCount].flags = I2C_M_RD;
+    _msgs[_msgCount].len = rxCount;
+    _msgs[_msgCount].buf = rx;
+    _msgCount++;
+  }
+  if(_batching && rxCount == 0) return error;      // held until the next read or endBatch()
+  uint8_t sent = send();
+  return error ? error : sent;
+}
+
+
+void LinuxI2C::beginBatch()
+{
+  _batching = true;
+  _batchError = 0;
+}
+
+
+uint8_t LinuxI2C::flush()
+{
+  if(_msgCount) send();
+  uint8_t error = _batchError;
+  _batchError = 0;
+  return error;
+}
+
+
+uint8_t LinuxI2C::endBatch()
+{
+  uint8_t error = flush();
+  _batching = false;
+  return error;
+}
+
+
+uint8_t LinuxI2C::send()
+{
+  struct i2c_rdwr_ioctl_data request;
+  request.msgs = _msgs;
+  request.nmsgs = _msgCount;
+  uint64_t start = monotonicNs();
+  int result = _ioctl(_fd, I2C_RDWR, &request);
+  uint64_t elapsed = monotonicNs() - start;
+
+  _stats.calls++;
+  _stats.messages += _msgCount;
+  _stats.totalTime += elapsed;
+  if(elapsed > _stats.maxTime) _stats.maxTime = elapsed;
+  _msgCount = 0;
+  _dataUsed = 0;
+  if(result >= 0) return 0;
+  _stats.errors++;
+  uint8_t error = errno == ENXIO || errno == EREMOTEIO ? 2 : 4;   // no ACK, or anything else
+  if(_batching && _batchError == 0) _batchError = error;          // may have carried held writes
+  return error;
+}
+
+
+void LinuxI2C::getStats(LinuxI2CStats * stats)
+{
+  *stats = _stats;
+}
+
+
+void LinuxI2C::resetStats()
+{
+  memset(&_stats, 0, sizeof(_stats));
+}
@@ -0,0 +1,70 @@
+/* Copyright Tlera Corporation
+ *
+ *  Linux i2c-dev adapter for the host TwoWire, so the PAF9701 library can read a sensor wired
+ *  to /dev/i2c-N of a Linux board.
+ *
+ *  Every transfer is one ioctl(I2C_RDWR): a register read is the pointer write and the read
+ *  joined by a repeated START, as on the Arduino. Between beginBatch() and endBatch() write-only
+ *  transfers are held and sent in front of the next read, so a bank select, pointer write and
+ *  burst read cost one system call. Held writes always go out in order, at the latest at
+ *  flush() or endBatch(). A held write reports success when it is queued, so the first error of
+ *  the writes sent since beginBatch() or the last flush() is kept and returned by flush() and
+ *  endBatch(): call either at the end of a configuration sequence, e.g. after initNormalMode(),
+ *  rather than leaving the writes to the next read. Failed calls are counted in the stats. The
+ *  time spent in each ioctl is recorded.
+ *
+ *  The ioctl function can be replaced, e.g. by one that feeds the messages to a SimBus, to test
+ *  without hardware (see bench_linux.cpp).
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#ifndef LinuxI2C_h
+#define LinuxI2C_h
+
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include "Wire.h"
+
+#define LINUX_I2C_BATCH_BYTES  256   // bytes of held write data
+
+typedef int (*LinuxI2CIoctl)(int fd, unsigned long request, void * arg);
+
+typedef struct {
+  uint32_t calls;        // ioctl(I2C_RDWR) system calls
+  uint32_t messages;     // i2c_msg segments carried by them
+  uint32_t errors;
+  uint64_t totalTime;    // ns spent in the calls
+  uint64_t maxTime;
+} LinuxI2CStats;
+
+class LinuxI2C : public I2CAdapter
+{
+  public:
+  LinuxI2C(LinuxI2CIoctl ioctlFunction = NULL);   // NULL for ioctl(2)
+  ~LinuxI2C();
+  bool begin(const char * device);                // e.g. "/dev/i2c-1"
+  void begin(int fd);                             // already open, or any value for a fake ioctl
+  void end();
+  uint8_t transfer(uint8_t address, const uint8_t * tx, size_t txCount, uint8_t * rx, size_t rxCount);
+  void beginBatch();
+  uint8_t flush();                                // sends held writes, returns the first Wire error code since the last flush()
+  uint8_t endBatch();                             // flush() and stop holding writes
+  void getStats(LinuxI2CStats * stats);
+  void resetStats();
+  private:
+  int _fd;
+  bool _ownFd;
+  LinuxI2CIoctl _ioctl;
+  bool _batching;
+  struct i2c_msg _msgs[I2C_RDWR_IOCTL_MAX_MSGS];
+  uint8_t _msgCount;
+  uint8_t _data[LINUX_I2C_BATCH_BYTES];          // write data of the held messages
+  size_t _dataUsed;
+  uint8_t _batchError;                            // first error while batching, for flush()
+  LinuxI2CStats _stats;
+  uint8_t send();
+};
+
+#endif
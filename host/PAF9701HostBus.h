@@ -0,0 +1,84 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host bus policies for PAF9701Driver (see PAF9701Driver.h):
+ *
+ *    PAF9701LinuxBus      one ioctl(I2C_RDWR) per register access on an open /dev/i2c-N descriptor
+ *    PAF9701SimDirectBus     straight into a PAF9701Sim register model, no bus timing
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#ifndef PAF9701HostBus_h
+#define PAF9701HostBus_h
+
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include "PAF9701Sim.h"
+
+class PAF9701LinuxBus
+{
+  public:
+  PAF9701LinuxBus(int fd = -1) : _fd(fd), _errors(0) {}
+
+  uint32_t errors() const { return _errors; }   // failed ioctl(I2C_RDWR) calls, errno has the last cause
+
+  inline bool write(uint8_t address, uint8_t reg, const uint8_t * data, uint8_t count)
+  {
+    uint8_t buffer[1 + 255];
+    buffer[0] = reg;
+    memcpy(&buffer[1], data, count);
+    struct i2c_msg msg = {address, 0, (uint16_t) (1 + count), buffer};
+    struct i2c_rdwr_ioctl_data request = {&msg, 1};
+    return call(&request);
+  }
+
+  inline bool read(uint8_t address, uint8_t reg, uint8_t * dest, uint8_t count)
+  {
+    struct i2c_msg msgs[2] = {{address, 0, 1, &reg}, {address, I2C_M_RD, count, dest}};
+    struct i2c_rdwr_ioctl_data request = {msgs, 2};
+    return call(&request);
+  }
+
+  private:
+  int _fd;
+  uint32_t _errors;
+
+  inline bool call(struct i2c_rdwr_ioctl_data * request)
+  {
+    if(ioctl(_fd, I2C_RDWR, request) >= 0) return true;
+    _errors++;
+    return false;
+  }
+};
+
+
+class PAF9701SimDirectBus
+{
+  public:
+  PAF9701SimDirectBus(PAF9701Sim * sim = NULL) : _sim(sim) {}
+
+  inline bool write(uint8_t address, uint8_t reg, const uint8_t * data, uint8_t count)
+  {
+    (void) address;
+    uint8_t buffer[1 + 255];
+    buffer[0] = reg;
+    memcpy(&buffer[1], data, count);
+    _sim->i2cWrite(buffer, 1 + count);
+    return true;
+  }
+
+  inline bool read(uint8_t address, uint8_t reg, uint8_t * dest, uint8_t count)
+  {
+    (void) address;
+    _sim->i2cWrite(&reg, 1);
+    _sim->i2cRead(dest, count);
+    return true;
+  }
+
+  private:
+  PAF9701Sim * _sim;
+};
+
+#endif
@@ -0,0 +1,380 @@
+/* Copyright Tlera Corporation
+ *
+ *  Register-level model of the PAF9701, see PAF9701Sim.h.
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <math.h>
+
+#include "PAF9701Sim.h"
+
+
+// a warm object (34 C peak) circling over a 24 C background with a little pixel noise
+void paf9701SimWarmObject(void * context, uint64_t now, int16_t * pixels, int16_t * ambient)
+{
+  (void) context;
+  float t = now * 1e-9f;
+  float cx = 3.5f + 3.0f * sinf(t * 0.7f), cy = 3.5f + 2.5f * cosf(t * 0.5f);
+  uint32_t seed = (uint32_t) (now / 1000) | 1;
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    float dx = (ii & 7) - cx, dy = (ii >> 3) - cy;
+    seed = seed * 1103515245u + 12345u;
+    float noise = ((seed >> 16) & 0xFF) / 255.0f - 0.5f;
+    pixels[ii] = (int16_t) lrintf((24.0f + 10.0f * expf(-(dx*dx + dy*dy) / 3.0f) + 0.4f * noise) * 16.0f);
+  }
+  *ambient = 25 * 16;
+}
+
+
+// every pixel holds the frame number, so a frame stitched from two frames is easy to spot;
+// context is a uint32_t counter or NULL
+void paf9701SimFrameCounter(void * context, uint64_t now, int16_t * pixels, int16_t * ambient)
+{
+  uint32_t frame = (uint32_t) (now / PAF9701_SIM_TICK_NS);
+  if(context) frame = (*(uint32_t *) context)++;
+  for(uint8_t ii = 0; ii < 64; ii++) pixels[ii] = (int16_t) frame;
+  *ambient = 25 * 16;
+}
+
+
+PAF9701Sim::PAF9701Sim(uint8_t address, uint8_t intPin)
+{
+  _address = address;
+  _intPin = intPin;
+  _scene = paf9701SimWarmObject;
+  _sceneContext = NULL;
+  _frames = 0;
+  _pulling = false;
+  _noise = 0;
+  _noiseSeed = 1;
+  memset(_regs, 0, sizeof(_regs));
+  reset(true);
+  _bootDone = simNow();          // powered up and booted before the host starts
+  _regs[0][PAF9701_STATUS_FLAG] = 0x20;
+  simSetPin(_intPin, HIGH);       // INT idles high
+}
+
+
+void PAF9701Sim::setScene(PAF9701SimScene scene, void * context)
+{
+  _scene = scene;
+  _sceneContext = context;
+}
+
+
+void PAF9701Sim::setNoise(uint16_t noise)
+{
+  _noise = noise;
+}
+
+
+uint8_t PAF9701Sim::reg(uint8_t bank, uint8_t reg)
+{
+  return _regs[bank][reg & 0x7F];
+}
+
+
+uint32_t PAF9701Sim::framesPublished()
+{
+  return _frames;
+}
+
+
+uint8_t PAF9701Sim::powerSaveStage()
+{
+  return _stage;
+}
+
+
+bool PAF9701Sim::intAsserted()
+{
+  uint8_t mode = (_regs[0][PAF9701_ALERT_MODE] >> 2) & 0x03;
+  if(_stage > 0 || (_regs[0][PAF9701_OPERATION_MODE] & 0x20)) mode = _regs[0][PAF9701_ALERT_MODE] & 0x03;
+  return _regs[0][PAF9701_STATUS_FLAG] & (mode == frameUpdateAlert ? 0x10 : 0x01);
+}
+
+
+uint8_t PAF9701Sim::address()
+{
+  return _address;
+}
+
+
+void PAF9701Sim::i2cWrite(const uint8_t * data, size_t count)
+{
+  _pointer = data[0] & 0x7F;
+  for(size_t ii = 1; ii < count; ii++) {
+    writeRegister(_pointer, data[ii]);
+    _pointer = (_pointer + 1) & 0x7F;   // auto-increment
+  }
+}
+
+
+void PAF9701Sim::i2cRead(uint8_t * data, size_t count)
+{
+  for(size_t ii = 0; ii < count; ii++) {
+    data[ii] = _regs[_bank][_pointer];
+    _pointer = (_pointer + 1) & 0x7F;
+  }
+}
+
+
+uint64_t PAF9701Sim::nextEvent()
+{
+  if(!(_regs[0][PAF9701_STATUS_FLAG] & 0x20)) return _bootDone;
+  if(_regs[0][PAF9701_OUTPUT_ENABLE] & 0x01) return _nextFrame;
+  return UINT64_MAX;
+}
+
+
+void PAF9701Sim::tick(uint64_t now)
+{
+  if(!(_regs[0][PAF9701_STATUS_FLAG] & 0x20)) {
+    _regs[0][PAF9701_STATUS_FLAG] |= 0x20;  // bootload done
+    _nextFrame = now + framePeriod();
+    return;
+  }
+  publishFrame(now);
+  _nextFrame = now + framePeriod();
+  if(_regs[0][PAF9701_ONE_SHOT_MODE] & 0x01) _regs[0][PAF9701_OUTPUT_ENABLE] &= ~0x01;   // one conversion done
+}
+
+
+void PAF9701Sim::reset(bool cold)
+{
+  if(cold) {
+    memset(_regs, 0, sizeof(_regs));
+    _regs[0][PAF9701_PARTID_L] = 0x80;
+    _regs[0][PAF9701_PARTID_H] = 0x02;
+    _regs[0][PAF9701_BURST_NUM_SEL] = 0x79;     // Ta 2^7, To 2^9 samples
+    _regs[0][PAF9701_BURST_FRQ_SEL_L] = 0x4E;   // 10 Hz
+    _regs[0][PAF9701_DET1_RPT_RATE_L] = 0x09;   // 20 s
+    _regs[0][PAF9701_DET1_RPT_RATE_M] = 0x3D;
+    _regs[0][PAF9701_DET2_RPT_RATE_L] = 0x36;   // 120 s
+    _regs[0][PAF9701_DET2_RPT_RATE_M] = 0x6E;
+    _regs[0][PAF9701_DET2_RPT_RATE_H] = 0x01;
+    _regs[0][PAF9701_DET_TIME_L] = 0x1B;        // 60 s
+    _regs[0][PAF9701_DET_TIME_M] = 0xB7;
+    _regs[1][PAF9701_FILTER_SEL] = normalAverage << 3;
+  }
+  _bank = 0;
+  _pointer = 0;
+  _regs[0][PAF9701_STATUS_FLAG] = 0x00;          // bootload starts over
+  _bootDone = simNow() + PAF9701_SIM_BOOT_NS;
+  _lastAlert = _bootDone;
+  _stage = 0;
+  _pixelAlert = 0;
+  _taHigh = _taLow = false;
+  memset(&_regs[4][PAF9701_TO_ALERT_FLAG_0_7], 0, 8);
+  updateInt();
+}
+
+
+void PAF9701Sim::writeRegister(uint8_t reg, uint8_t data)
+{
+  if(reg == PAF9701_BANK_SELECT) {
+    if(data <= 5) _bank = data;
+    _regs[_bank][reg] = _bank;
+    return;
+  }
+
+  switch(_bank) {
+    case 0:
+      switch(reg) {
+        case PAF9701_PARTID_L: case PAF9701_PARTID_H:
+        case PAF9701_DSP_TO_DATA_L: case PAF9701_DSP_TO_DATA_H:
+        case PAF9701_CAL_TO_DATA_L: case PAF9701_CAL_TO_DATA_H:
+          return;                                             // read only
+
+        case PAF9701_STATUS_FLAG:
+          if(data & 0x80) _regs[0][reg] &= ~0x1F;            // clear frame update and alert flags
+          updateInt();
+          return;
+
+        case PAF9701_GPIO0_OPEN_DRAIN:
+          _regs[0][reg] = data;
+          updateInt();
+          return;
+
+        case PAF9701_HOST_RSTB:
+          if(data == 0x5A) reset(true);
+          if(data == 0x9A) reset(false);
+          return;
+
+        case PAF9701_OUTPUT_ENABLE:
+          if((data & 0x01) && !(_regs[0][reg] & 0x01)) {
+            uint64_t start = simNow() > _bootDone ? simNow() : _bootDone;
+            _nextFrame = start + framePeriod();
+            if(_regs[0][PAF9701_ONE_SHOT_MODE] & 0x01) {   // one conversion, no frame interval to wait out
+              _nextFrame = start + PAF9701_CONVERSION_US(_regs[0][PAF9701_BURST_NUM_SEL]) * 1000ULL;
+            }
+          }
+          break;
+      }
+      break;
+
+    case 4:
+      if(reg <= PAF9701_TO_ALERT_FLAG_56_63) return;         // pixel data and alert flags
+      break;
+
+    case 5:
+      if(reg <= PAF9701_TO_PIXEL_63_DATA_H) return;
+      break;
+  }
+  _regs[_bank][reg] = data;
+}
+
+
+uint32_t PAF9701Sim::reg24(uint8_t bank, uint8_t reg)
+{
+  return (uint32_t) (_regs[bank][reg + 2] & 0x0F) << 16 | (uint32_t) _regs[bank][reg + 1] << 8 | _regs[bank][reg];
+}
+
+
+int16_t PAF9701Sim::limit(uint8_t bank, uint8_t reg)
+{
+  int16_t value = (int16_t) ((_regs[bank][reg + 1] & 0x07) << 8 | _regs[bank][reg]);
+  if(value & 0x0400) value -= 0x0800;              // 11 bit two's complement
+  return value * 8;                                // 0.5 C to 1/16 C per LSB
+}
+
+
+uint64_t PAF9701Sim::framePeriod()
+{
+  uint32_t ticks = reg24(0, PAF9701_BURST_FRQ_SEL_L);
+  uint8_t mode = _regs[0][PAF9701_OPERATION_MODE];
+  if(_stage == 1 || mode == detection_mode1 || mode == detection_mode3) ticks = reg24(0, PAF9701_DET1_RPT_RATE_L);
+  if(_stage == 2 || mode == detection_mode2) ticks = reg24(0, PAF9701_DET2_RPT_RATE_L);
+  if(ticks == 0) ticks = 1;
+  uint64_t conversion = PAF9701_CONVERSION_US(_regs[0][PAF9701_BURST_NUM_SEL]) * 1000ULL;
+  return ticks * PAF9701_SIM_TICK_NS > conversion ? ticks * PAF9701_SIM_TICK_NS : conversion;
+}
+
+
+// standard normal deviate, sum of 12 uniform deviates
+double PAF9701Sim::gaussian()
+{
+  double sum = 0;
+  for(uint8_t ii = 0; ii < 12; ii++) {
+    _noiseSeed = _noiseSeed * 1664525u + 1013904223u;
+    sum += (_noiseSeed >> 8) / 16777216.0;
+  }
+  return sum - 6.0;
+}
+
+
+void PAF9701Sim::publishFrame(uint64_t now)
+{
+  int16_t scene[64], pixels[64], ambient;
+  _scene(_sceneContext, now, scene, &ambient);
+
+  // orientation: mirror (x) and flip (y), then rotate 90 degrees clockwise per step
+  uint8_t orientation = _regs[3][PAF9701_ORIENTATION];
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    uint8_t x = ii & 7, y = ii >> 3;
+    if(orientation & (mirror << 2)) x = 7 - x;
+    if(orientation & (flip << 2)) y = 7 - y;
+    for(uint8_t rr = 0; rr < (orientation & 0x03); rr++) {
+      uint8_t t = x;
+      x = 7 - y;
+      y = t;
+    }
+    pixels[y * 8 + x] = scene[ii];
+  }
+
+  if(_noise) {                                    // white noise, falls with the square root of the To samples
+    double sigma = _noise * 0.016 * sqrt(512.0 / (1UL << (_regs[0][PAF9701_BURST_NUM_SEL] & 0x0F)));   // mK to 1/16 C
+    for(uint8_t ii = 0; ii < 64; ii++) pixels[ii] += (int16_t) lround(sigma * gaussian());
+  }
+
+  if(_regs[4][PAF9701_P0_SELECT] & 0x01) {       // window of interest
+    uint8_t v = _regs[4][PAF9701_P0_WOI_V], h = _regs[4][PAF9701_P0_WOI_H];
+    for(uint8_t ii = 0; ii < 64; ii++) {
+      uint8_t x = ii & 7, y = ii >> 3;
+      if(y < (v >> 4) || y > (v & 0x0F) || x < (h >> 4) || x > (h & 0x0F)) pixels[ii] = 0;
+    }
+  }
+
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    uint8_t * data = ii < 32 ? &_regs[4][2 * ii] : &_regs[5][2 * (ii - 32)];
+    data[0] = pixels[ii] & 0xFF;
+    data[1] = (pixels[ii] >> 8) & 0xFF;
+  }
+  int16_t raw = 0x1000 + ambient;                 // ADC counts, offset is arbitrary
+  _regs[0][PAF9701_DSP_TO_DATA_L] = raw & 0xFF;
+  _regs[0][PAF9701_DSP_TO_DATA_H] = (raw >> 8) & 0xFF;
+  int16_t cal = ambient * 2;                      // 1/32 C per LSB
+  _regs[0][PAF9701_CAL_TO_DATA_L] = cal & 0xFF;
+  _regs[0][PAF9701_CAL_TO_DATA_H] = (cal >> 8) & 0xFF;
+
+  // alerts, with the detection limits in the detection modes and auto power save stages
+  bool detect = _stage > 0 || (_regs[0][PAF9701_OPERATION_MODE] & 0x20);
+  uint8_t mode = detect ? _regs[0][PAF9701_ALERT_MODE] & 0x03 : (_regs[0][PAF9701_ALERT_MODE] >> 2) & 0x03;
+  uint8_t offset = detect ? PAF9701_DET_TA_HIGH_LIMIT_L - PAF9701_TA_HIGH_LIMIT_L : 0;
+  uint8_t status = 0x10;                          // frame update
+  uint8_t count = 0;                              // pixels in alert
+  if(mode == absValueAlert || mode == diffValueAlert) {
+    int16_t taHigh = limit(1, PAF9701_TA_HIGH_LIMIT_L + offset), taLow = limit(1, PAF9701_TA_LOW_LIMIT_L + offset);
+    int16_t toHigh = limit(1, PAF9701_TO_HIGH_LIMIT_L + offset), toLow = limit(1, PAF9701_TO_LOW_LIMIT_L + offset);
+    int16_t taHyst = _regs[1][PAF9701_TA_HYSTERESIS + offset] * 8;
+    int16_t toHyst = _regs[1][PAF9701_TO_HYSTERESIS + offset] * 8;
+    uint8_t threshold = _regs[1][detect ? PAF9701_DET_TO_PIXEL_THRESHOLD : PAF9701_TO_PIXEL_THRESHOLD];
+    if(threshold == 0) threshold = 1;
+
+    for(uint8_t ii = 0; ii < 64; ii++) {
+      int16_t value = mode == diffValueAlert ? (_frames ? pixels[ii] - _previous[ii] : 0) : pixels[ii];
+      uint64_t bit = (uint64_t) 1 << ii;
+      if(value > toHigh || value < toLow) _pixelAlert |= bit;
+      else if(value <= toHigh - toHyst && value >= toLow + toHyst) _pixelAlert &= ~bit;
+      if(_pixelAlert & bit) count++;
+    }
+    if(ambient > taHigh) _taHigh = true;
+    else if(ambient <= taHigh - taHyst) _taHigh = false;
+    if(ambient < taLow) _taLow = true;
+    else if(ambient >= taLow + taHyst) _taLow = false;
+
+    if(count >= threshold) status |= 0x08;
+    if(_taHigh) status |= 0x02;
+    if(_taLow) status |= 0x04;
+    if(status & 0x0E) status |= 0x01;
+  }
+  else _pixelAlert = 0;
+  for(uint8_t ii = 0; ii < 8; ii++) _regs[4][PAF9701_TO_ALERT_FLAG_0_7 + ii] = (_pixelAlert >> (8 * ii)) & 0xFF;
+  memcpy(_previous, pixels, sizeof(_previous));
+
+  // auto power save: drop a stage after DET_TIME without an alert, back to normal on an alert;
+  // in skip mode only on an alert with at least the stage's skip pixel threshold in alert
+  if(_regs[0][PAF9701_POWER_SAVING_MODE] & 0x10) {
+    uint8_t skip = _regs[1][_stage == 1 ? PAF9701_TO_SKIP1_PIXEL_THRESHOLD : PAF9701_TO_SKIP2_PIXEL_THRESHOLD];
+    if((status & 0x01) && _stage > 0 && (_regs[4][PAF9701_SKIP_MODE] & 0x01) && count < skip) {
+      _lastAlert = now;                           // too few pixels, stay in this stage
+    }
+    else if(status & 0x01) {
+      _stage = 0;
+      _lastAlert = now;
+    }
+    else if(_stage < 2 && now - _lastAlert >= reg24(0, PAF9701_DET_TIME_L) * PAF9701_SIM_TICK_NS) {
+      _stage++;
+      _lastAlert = now;
+    }
+  }
+  else _stage = 0;
+
+  _frames++;
+  _regs[0][PAF9701_STATUS_FLAG] |= status;
+  updateInt();
+}
+
+
+void PAF9701Sim::updateInt()
+{
+  bool openDrain = _regs[0][PAF9701_GPIO0_OPEN_DRAIN] & 0x01;
+  bool pull = openDrain && intAsserted();
+  if(pull != _pulling) {                 // wired-OR with the other open drain outputs on the pin
+    _pulling = pull;
+    simPullLow(_intPin, pull);
+  }
+  if(!openDrain) simSetPin(_intPin, intAsserted() ? LOW : HIGH);
+}
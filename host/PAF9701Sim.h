@@ -0,0 +1,92 @@
+/* Copyright Tlera Corporation
+ *
+ *  Register-level model of the PAF9701 for host runs of the library.
+ *
+ *  Covers banks 0 - 5 behind PAF9701_BANK_SELECT, auto-increment bursts, part id, status flags,
+ *  cold and warm reset with a bootload delay, the frame period from BURST_FRQ_SEL (256 / 200 kHz
+ *  per LSB), the detection and auto power save stages, image orientation, and the absValue and
+ *  diffValue alert logic with hysteresis, pixel threshold and the bank 4 alert flag bitmap.
+ *  Frames come from a scene callback and are published between bus transfers, so a frame read
+ *  split over banks 4 and 5 can tear as it does on the part.
+ *
+ *  Where the data sheet leaves behavior open the model picks one and says so below: writing
+ *  0x80 to STATUS_FLAG clears the frame update and alert flags (bits 0 - 4), INT is active low
+ *  and asserted while the flag selected by ALERT_MODE is set (frame update in frameUpdateAlert
+ *  mode, the alert flag otherwise), bit 0 of GPIO0_OPEN_DRAIN selects an open drain INT that
+ *  several models can share (push pull by default), bit 0 of P0_SELECT enables the window in
+ *  P0_WOI_V and P0_WOI_H (first row or column in the high nibble, last in the low nibble) and
+ *  pixels outside it read 0, with bit 0 of ONE_SHOT_MODE set OUTPUT_ENABLE starts a single
+ *  conversion, which takes the conversion time of BURST_NUM_SEL whatever BURST_FRQ_SEL says, and
+ *  clears itself after the frame, with SKIP_MODE bit 0 set an alert in detect mode 1 or 2 wakes the
+ *  auto power save ladder only when at least TO_SKIP1_PIXEL_THRESHOLD or TO_SKIP2_PIXEL_THRESHOLD
+ *  pixels are in alert, diffValue alerts compare each pixel with the previous frame using the To
+ *  high limit for rises and the To low limit for falls, a frame takes at least the conversion
+ *  time of BURST_NUM_SEL (PAF9701_CONVERSION_US()) whatever BURST_FRQ_SEL asks for, pixel noise
+ *  set with setNoise() falls with the square root of the To samples, and the filters and
+ *  emissivity are not modeled.
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#ifndef PAF9701Sim_h
+#define PAF9701Sim_h
+
+#include "SimBus.h"
+#include "PAF9701.h"
+
+#define PAF9701_SIM_BOOT_NS    2000000ULL   // bootload time after reset
+#define PAF9701_SIM_TICK_NS    1280000ULL   // 256 / 200 kHz, one LSB of the frame and detect time registers
+#define PAF9701_SIM_NO_PIN     0xFF
+
+// fill 64 pixels and the ambient temperature, both 1/16 C per LSB, for the frame published at now ns
+typedef void (*PAF9701SimScene)(void * context, uint64_t now, int16_t * pixels, int16_t * ambient);
+
+void paf9701SimWarmObject(void * context, uint64_t now, int16_t * pixels, int16_t * ambient);  // default scene
+void paf9701SimFrameCounter(void * context, uint64_t now, int16_t * pixels, int16_t * ambient); // every pixel = frame number
+
+class PAF9701Sim : public SimI2CDevice, public SimDevice
+{
+  public:
+  PAF9701Sim(uint8_t address = PAF9701_ADDRESS, uint8_t intPin = PAF9701_SIM_NO_PIN);
+  void setScene(PAF9701SimScene scene, void * context);
+  void setNoise(uint16_t noise);                 // mK rms per pixel at 2^9 To samples, 0 = none (default)
+  uint8_t reg(uint8_t bank, uint8_t reg);        // inspect a register without bus traffic
+  uint32_t framesPublished();
+  uint8_t powerSaveStage();                      // 0 normal, 1 detect mode 1, 2 detect mode 2
+  bool intAsserted();
+
+  uint8_t address();
+  void i2cWrite(const uint8_t * data, size_t count);
+  void i2cRead(uint8_t * data, size_t count);
+  uint64_t nextEvent();
+  void tick(uint64_t now);
+
+  private:
+  uint8_t _address, _intPin;
+  uint8_t _regs[6][128];
+  uint8_t _bank, _pointer;
+  PAF9701SimScene _scene;
+  void * _sceneContext;
+  uint64_t _bootDone, _nextFrame;
+  uint64_t _lastAlert;                 // for the auto power save stages
+  uint8_t _stage;
+  uint32_t _frames;
+  int16_t _previous[64];               // last frame, for diffValue alerts
+  uint64_t _pixelAlert;                // per pixel alert state, kept for hysteresis
+  bool _taHigh, _taLow;
+  bool _pulling;                       // open drain INT output pulling the pin low
+  uint16_t _noise;
+  uint32_t _noiseSeed;
+
+  void reset(bool cold);
+  void writeRegister(uint8_t reg, uint8_t data);
+  void publishFrame(uint64_t now);
+  uint64_t framePeriod();
+  double gaussian();
+  uint32_t reg24(uint8_t bank, uint8_t reg);
+  int16_t limit(uint8_t bank, uint8_t reg);    // 11 bit signed limit in 1/16 C
+  void updateInt();
+};
+
+#endif
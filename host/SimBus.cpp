@@ -0,0 +1,69 @@
+/* Copyright Tlera Corporation
+ *
+ *  Simulated I2C bus, see SimBus.h.
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include "SimBus.h"
+
+
+SimBus::SimBus(uint32_t frequency)
+{
+  _deviceCount = 0;
+  _frequency = frequency;
+  resetStats();
+}
+
+
+void SimBus::attach(SimI2CDevice * device)
+{
+  if(_deviceCount < SIM_BUS_DEVICES) _devices[_deviceCount++] = device;
+}
+
+
+uint8_t SimBus::transfer(uint8_t address, const uint8_t * tx, size_t txCount, uint8_t * rx, size_t rxCount)
+{
+  SimI2CDevice * device = NULL;
+  for(uint8_t ii = 0; ii < _deviceCount; ii++) {
+    if(_devices[ii]->address() == address) device = _devices[ii];
+  }
+
+  // START, address byte, data bytes (8 bits + ACK each), STOP; a read after a write adds a
+  // repeated START and a second address byte
+  uint32_t bytes = 1;
+  if(device) {
+    bytes += txCount + rxCount;
+    if(txCount > 0 && rxCount > 0) bytes++;
+    if(txCount > 0) device->i2cWrite(tx, txCount);
+    if(rxCount > 0) device->i2cRead(rx, rxCount);
+  }
+  uint32_t bits = 1 + 9 * bytes + 1;
+  if(device && txCount > 0 && rxCount > 0) bits++;
+
+  _stats.transfers++;
+  _stats.bytes += bytes;
+  uint64_t ns = (uint64_t) bits * 1000000000ULL / _frequency;
+  _stats.busTime += ns;
+  simAdvance(ns);        // device state changes and pin interrupts land after the transfer
+  return device ? 0 : 2;
+}
+
+
+void SimBus::setClock(uint32_t frequency)
+{
+  if(frequency > 0) _frequency = frequency;
+}
+
+
+void SimBus::getStats(SimBusStats * stats)
+{
+  *stats = _stats;
+}
+
+
+void SimBus::resetStats()
+{
+  memset(&_stats, 0, sizeof(_stats));
+}
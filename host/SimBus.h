@@ -0,0 +1,49 @@
+/* Copyright Tlera Corporation
+ *
+ *  Simulated I2C bus for host runs: routes Wire transfers to device models by address and
+ *  advances the virtual clock by the time each transfer takes at the configured bus clock
+ *  (9 bit times per byte including ACK, plus START, repeated START and STOP).
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#ifndef SimBus_h
+#define SimBus_h
+
+#include "Wire.h"
+
+#define SIM_BUS_DEVICES  8
+
+class SimI2CDevice   // a device model on the simulated bus
+{
+  public:
+  virtual ~SimI2CDevice() {}
+  virtual uint8_t address() = 0;
+  virtual void i2cWrite(const uint8_t * data, size_t count) = 0;   // one write phase, register pointer first
+  virtual void i2cRead(uint8_t * data, size_t count) = 0;          // one read phase
+};
+
+typedef struct {
+  uint32_t transfers;     // START to STOP
+  uint32_t bytes;         // address and data bytes
+  uint64_t busTime;       // ns the bus was busy
+} SimBusStats;
+
+class SimBus : public I2CAdapter
+{
+  public:
+  SimBus(uint32_t frequency = 100000);
+  void attach(SimI2CDevice * device);
+  uint8_t transfer(uint8_t address, const uint8_t * tx, size_t txCount, uint8_t * rx, size_t rxCount);
+  void setClock(uint32_t frequency);
+  void getStats(SimBusStats * stats);
+  void resetStats();
+  private:
+  SimI2CDevice * _devices[SIM_BUS_DEVICES];
+  uint8_t _deviceCount;
+  uint32_t _frequency;
+  SimBusStats _stats;
+};
+
+#endif
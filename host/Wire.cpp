@@ -0,0 +1,109 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host stand-in for the Arduino TwoWire class, see Wire.h.
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include "Wire.h"
+
+TwoWire Wire;
+
+
+TwoWire::TwoWire()
+{
+  _adapter = NULL;
+  _txCount = 0;
+  _txHeld = false;
+  _rxCount = 0;
+  _rxIndex = 0;
+}
+
+
+void TwoWire::setAdapter(I2CAdapter * adapter)
+{
+  _adapter = adapter;
+}
+
+
+void TwoWire::begin()
+{
+}
+
+
+void TwoWire::end()
+{
+}
+
+
+void TwoWire::setClock(uint32_t frequency)
+{
+  if(_adapter) _adapter->setClock(frequency);
+}
+
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+  _address = address;
+  _txCount = 0;
+  _txHeld = false;
+}
+
+
+size_t TwoWire::write(uint8_t data)
+{
+  if(_txCount == BUFFER_LENGTH) return 0;
+  _tx[_txCount++] = data;
+  return 1;
+}
+
+
+size_t TwoWire::write(const uint8_t * data, size_t count)
+{
+  size_t n = 0;
+  while(n < count && write(data[n])) n++;
+  return n;
+}
+
+
+uint8_t TwoWire::endTransmission(bool stopBit)
+{
+  if(!stopBit) {        // register pointer write, completed by the read after the repeated start
+    _txHeld = true;
+    return 0;
+  }
+  if(_adapter == NULL) return 4;
+  return _adapter->transfer(_address, _tx, _txCount, NULL, 0);
+}
+
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t count, bool stopBit)
+{
+  (void) stopBit;
+  _rxCount = 0;
+  _rxIndex = 0;
+  size_t txCount = _txHeld && address == _address ? _txCount : 0;
+  _txHeld = false;
+  if(_adapter == NULL || _adapter->transfer(address, _tx, txCount, _rx, count) != 0) return 0;
+  _rxCount = count;
+  return count;
+}
+
+
+int TwoWire::available()
+{
+  return _rxCount - _rxIndex;
+}
+
+
+int TwoWire::read()
+{
+  return _rxIndex < _rxCount ? _rx[_rxIndex++] : -1;
+}
+
+
+int TwoWire::peek()
+{
+  return _rxIndex < _rxCount ? _rx[_rxIndex] : -1;
+}
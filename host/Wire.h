@@ -0,0 +1,58 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host stand-in for the Arduino TwoWire class.
+ *
+ *  The Wire calls made by I2Cdev are collected into whole I2C transfers (a write, or a write
+ *  followed by a repeated start and a read) and handed to an I2CAdapter: a simulated bus
+ *  (SimBus.h) or a real one. The library code above it runs unmodified.
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include "Arduino.h"
+
+#define BUFFER_LENGTH  256   // bytes per transfer direction
+
+class I2CAdapter   // whatever carries the transfers
+{
+  public:
+  virtual ~I2CAdapter() {}
+  // write txCount bytes, then read rxCount bytes after a repeated start when rxCount > 0;
+  // returns 0 on success, or the endTransmission() error code (2 address NACK, 3 data NACK, 4 other)
+  virtual uint8_t transfer(uint8_t address, const uint8_t * tx, size_t txCount, uint8_t * rx, size_t rxCount) = 0;
+  virtual void setClock(uint32_t frequency) { (void) frequency; }
+};
+
+class TwoWire
+{
+  public:
+  TwoWire();
+  void setAdapter(I2CAdapter * adapter);
+  void begin();
+  void end();
+  void setClock(uint32_t frequency);
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  size_t write(const uint8_t * data, size_t count);
+  uint8_t endTransmission(bool stopBit = true);
+  uint8_t requestFrom(uint8_t address, uint8_t count, bool stopBit = true);
+  int available();
+  int read();
+  int peek();
+  private:
+  I2CAdapter * _adapter;
+  uint8_t _address;
+  uint8_t _tx[BUFFER_LENGTH];
+  size_t _txCount;
+  bool _txHeld;              // written with endTransmission(false), sent with the next requestFrom()
+  uint8_t _rx[BUFFER_LENGTH];
+  size_t _rxCount, _rxIndex;
+};
+
+extern TwoWire Wire;
+
+#endif
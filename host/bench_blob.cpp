@@ -0,0 +1,187 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host benchmark of the blob labeler in PAF9701Blob.h against a classic two pass union-find
+ *  labeler over the 64 cells.
+ *
+ *  Frames are a 24 C background with one to four warm objects of random size and position and
+ *  a little noise; the mask is frameThreshold() at 27 C. Both labelers produce the same blob
+ *  statistics (area, bounding box, weighted centroid, peak and mean) and are checked against
+ *  each other blob by blob, for 4- and 8-connectivity, then timed. A last line shows what the
+ *  single centroid over all alert pixels does with two objects.
+ *
+ *  g++ -O2 -I../PAF9701_GestureDetection_Ladybug bench_blob.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701Blob.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701Mask.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701Frame.cpp -o bench_blob
+ *  ./bench_blob
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "PAF9701Frame.h"
+#include "PAF9701Mask.h"
+#include "PAF9701Blob.h"
+
+#define FRAMES   4096
+#define REPEAT    100   // passes over the frames per labeler
+
+typedef struct {
+  int16_t  pixels[64];
+  uint64_t mask;
+} TestFrame;
+
+
+static uint32_t lcg(uint32_t * seed)
+{
+  *seed = *seed * 1103515245u + 12345u;
+  return *seed >> 16;
+}
+
+
+static void makeFrame(TestFrame * frame, uint32_t * seed)
+{
+  float t[64];
+  for(uint8_t ii = 0; ii < 64; ii++) t[ii] = 24.0f + (lcg(seed) % 100) / 200.0f;
+  uint8_t objects = 1 + lcg(seed) % 4;
+  for(uint8_t n = 0; n < objects; n++) {
+    float cx = (lcg(seed) % 800) / 100.0f, cy = (lcg(seed) % 800) / 100.0f;
+    float r = 0.6f + (lcg(seed) % 100) / 100.0f, heat = 4.0f + lcg(seed) % 8;
+    for(uint8_t ii = 0; ii < 64; ii++) {
+      float dx = (ii & 7) - cx, dy = (ii >> 3) - cy;
+      t[ii] += heat * expf(-(dx * dx + dy * dy) / (2 * r * r));
+    }
+  }
+  for(uint8_t ii = 0; ii < 64; ii++) frame->pixels[ii] = (int16_t) lrintf(t[ii] * 16.0f);
+  frame->mask = frameThreshold(frame->pixels, PAF9701_TO_RAW(27));
+}
+
+
+static uint8_t findRoot(uint8_t * parent, uint8_t a)
+{
+  while(parent[a] != a) a = parent[a] = parent[parent[a]];
+  return a;
+}
+
+
+// two pass union-find: label, merge with the left and upper (and diagonal) neighbours, then
+// collect the statistics per root; blobs come out in order of their lowest pixel
+static __attribute__((noinline)) uint8_t unionFind(uint64_t mask, const int16_t * pixels, uint8_t connectivity, PAF9701_Blob * blobs)
+{
+  uint8_t parent[64];
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    parent[ii] = ii;
+    if(!(mask >> ii & 1)) continue;
+    uint8_t x = ii & 7, y = ii >> 3;
+    const int8_t neighbours[4][2] = {{-1, 0}, {0, -1}, {-1, -1}, {1, -1}};
+    for(uint8_t n = 0; n < (connectivity == 8 ? 4 : 2); n++) {
+      int8_t nx = x + neighbours[n][0], ny = y + neighbours[n][1];
+      if(nx < 0 || nx > 7 || ny < 0) continue;
+      uint8_t jj = ny * 8 + nx;
+      if(!(mask >> jj & 1)) continue;
+      uint8_t a = findRoot(parent, ii), b = findRoot(parent, jj);
+      if(a != b) parent[a > b ? a : b] = a < b ? a : b;
+    }
+  }
+  uint8_t slot[64], count = 0;
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    if(!(mask >> ii & 1)) continue;
+    uint8_t root = findRoot(parent, ii);
+    if(root == ii) {
+      slot[ii] = count;
+      PAF9701_Blob * b = &blobs[count++];
+      memset(b, 0, sizeof(*b));
+      b->minX = b->minY = 7;
+      b->peak = INT16_MIN;
+    }
+    PAF9701_Blob * b = &blobs[slot[root]];
+    uint8_t x = ii & 7, y = ii >> 3;
+    b->mask |= (uint64_t) 1 << ii;
+    b->area++;
+    if(x < b->minX) b->minX = x;
+    if(x > b->maxX) b->maxX = x;
+    if(y < b->minY) b->minY = y;
+    if(y > b->maxY) b->maxY = y;
+    if(pixels[ii] > b->peak) { b->peak = pixels[ii]; b->peakIndex = ii; }
+  }
+  for(uint8_t n = 0; n < count; n++) {     // weighted centroid and mean need the blob minimum first
+    PAF9701_Blob * b = &blobs[n];
+    int16_t lo = INT16_MAX;
+    int32_t sum = 0;
+    for(uint8_t ii = 0; ii < 64; ii++) if(b->mask >> ii & 1) { sum += pixels[ii]; if(pixels[ii] < lo) lo = pixels[ii]; }
+    uint32_t total = 0, sumX = 0, sumY = 0;
+    for(uint8_t ii = 0; ii < 64; ii++) {
+      if(!(b->mask >> ii & 1)) continue;
+      uint32_t w = pixels[ii] - lo + 1;
+      total += w; sumX += w * (ii & 7); sumY += w * (ii >> 3);
+    }
+    b->mean = sum / b->area;
+    b->x = ((uint64_t) sumX << 8) / total;
+    b->y = ((uint64_t) sumY << 8) / total;
+  }
+  return count;
+}
+
+
+int main()
+{
+  std::vector<TestFrame> frames(FRAMES);
+  uint32_t seed = 3, blobTotal = 0;
+  for(size_t n = 0; n < frames.size(); n++) makeFrame(&frames[n], &seed);
+
+  printf("%u frames, 1 - 4 objects, mask at 27 C, ns per frame\n\n", FRAMES);
+  printf("connectivity  blobs/frame  mismatches  union-find  bitboard  speedup\n");
+  for(uint8_t connectivity = 4; connectivity <= 8; connectivity += 4) {
+    uint32_t wrong = 0;
+    blobTotal = 0;
+    for(size_t n = 0; n < frames.size(); n++) {
+      PAF9701_Blob a[32], b[32];
+      uint8_t na = unionFind(frames[n].mask, frames[n].pixels, connectivity, a);
+      uint8_t nb = blobLabel(frames[n].mask, frames[n].pixels, connectivity, b, 32);
+      blobTotal += nb;
+      if(na != nb) { wrong++; continue; }
+      for(uint8_t ii = 0; ii < na; ii++) {
+        if(a[ii].mask != b[ii].mask || a[ii].area != b[ii].area || a[ii].minX != b[ii].minX || a[ii].maxX != b[ii].maxX ||
+           a[ii].minY != b[ii].minY || a[ii].maxY != b[ii].maxY || a[ii].x != b[ii].x || a[ii].y != b[ii].y ||
+           a[ii].peak != b[ii].peak || a[ii].peakIndex != b[ii].peakIndex || a[ii].mean != b[ii].mean) wrong++;
+      }
+    }
+
+    volatile uint32_t sink = 0;
+    PAF9701_Blob blobs[32];
+    auto t0 = std::chrono::steady_clock::now();
+    for(int r = 0; r < REPEAT; r++) {
+      for(size_t n = 0; n < frames.size(); n++) sink += unionFind(frames[n].mask, frames[n].pixels, connectivity, blobs) + blobs[0].x;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for(int r = 0; r < REPEAT; r++) {
+      for(size_t n = 0; n < frames.size(); n++) sink += blobLabel(frames[n].mask, frames[n].pixels, connectivity, blobs, 32) + blobs[0].x;
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    double count = (double) REPEAT * frames.size();
+    double ufNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / count;
+    double bbNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / count;
+    printf("%12u  %11.2f  %10u  %10.1f  %8.1f  %6.2fx\n", connectivity, (double) blobTotal / frames.size(), wrong, ufNs, bbNs, ufNs / bbNs);
+  }
+
+  // two hands at (1, 3) and (6, 4): the single centroid lands between them
+  int16_t pixels[64];
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    int8_t x = ii & 7, y = ii >> 3;
+    bool hand = (abs(x - 1) <= 1 && abs(y - 3) <= 1) || (abs(x - 6) <= 1 && abs(y - 4) <= 1);
+    pixels[ii] = PAF9701_TO_RAW(hand ? 32 : 24);
+  }
+  uint64_t mask = frameThreshold(pixels, PAF9701_TO_RAW(27));
+  uint16_t cx, cy;
+  frameCentroid(mask, &cx, &cy);
+  PAF9701_Blob blobs[PAF9701_MAX_BLOBS];
+  uint8_t found = blobLabel(mask, pixels, 8, blobs, PAF9701_MAX_BLOBS);
+  printf("\ntwo hands at (1, 3) and (6, 4): one centroid (%.2f, %.2f), %u blobs", cx / 256.0, cy / 256.0, found);
+  for(uint8_t ii = 0; ii < found; ii++) printf(" (%.2f, %.2f)", blobs[ii].x / 256.0, blobs[ii].y / 256.0);
+  printf("\n");
+  return 0;
+}
@@ -0,0 +1,166 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host benchmark of the per-frame bus traffic of the PAF9701 library, run against the register
+ *  model in PAF9701Sim.h on a simulated I2C bus.
+ *
+ *  For each bus clock it reads frames at 10 Hz the way a sketch would: wait for the INT edge,
+ *  spend a pseudo-random time of up to one frame period on other work, then read the frame with
+ *
+ *    separate  getStatus(), clearInterrupt(), getAlertPixels() and getToDataRaw()
+ *    readFrame readFrame() and clearInterrupt()
+ *    snapshot  readFrame() with setSnapshotRead(2), which clears the interrupt itself
+ *    engine    startAcquisition() from the INT handler, serviceAcquisition() with 1 ms of other
+ *              work between steps, snapshot mode on, frames published into a PAF9701FrameRing
+ *
+ *  and reports transfers, bytes and bus time per frame, frames stitched from two sensor frames
+ *  (the scene writes the frame number into every pixel) and the INT to frame ready latency.
+ *  All time is virtual, so the numbers are the same on every run.
+ *
+ *  g++ -O2 -I. -I../PAF9701_GestureDetection_Ladybug bench_bus.cpp Arduino.cpp Wire.cpp SimBus.cpp PAF9701Sim.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701FrameRing.cpp ../PAF9701_GestureDetection_Ladybug/I2Cdev.cpp -o bench_bus
+ *  ./bench_bus [frames]
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "PAF9701Sim.h"
+#include "PAF9701FrameRing.h"
+
+#define INT_PIN   8
+#define RATE_HZ  10
+
+enum readMethod { methodSeparate, methodReadFrame, methodSnapshot, methodEngine };
+static const char * methodName[] = {"separate", "readFrame", "snapshot", "engine"};
+
+static volatile bool intFlag = false;
+static PAF9701 * driver = NULL;
+static bool useEngine = false;
+
+static void intHandler()
+{
+  if(useEngine) driver->startAcquisition();
+  else intFlag = true;
+}
+
+
+static uint32_t lcg(uint32_t * seed)
+{
+  *seed = *seed * 1103515245u + 12345u;
+  return *seed >> 8;
+}
+
+
+static bool torn(const int16_t * pixels)
+{
+  return pixels[0] != pixels[63];   // bank 4 and bank 5 halves from different frames
+}
+
+
+static void run(uint32_t clock, uint8_t method, uint32_t frames)
+{
+  uint32_t counter = 0, seed = 12345;
+  SimBus bus(clock);
+  PAF9701Sim sensor(PAF9701_ADDRESS, INT_PIN);
+  sensor.setScene(paf9701SimFrameCounter, &counter);
+  bus.attach(&sensor);
+  simAttach(&sensor);
+  Wire.setAdapter(&bus);
+  I2Cdev i2c(&Wire);
+  PAF9701 paf(&i2c);
+  PAF9701FrameRing ring;
+  driver = &paf;
+  useEngine = method == methodEngine;
+  intFlag = false;
+
+  // setup as in the sketches
+  paf.coldReset();
+  while(!(paf.getStatus() & 0x20)) {}
+  uint32_t frameTime = 200000 / (256 * RATE_HZ);
+  uint64_t period = (uint64_t) frameTime * PAF9701_SIM_TICK_NS;
+  paf.initNormalMode(normal_mode, frameTime, true);
+  paf.setAlertMode(frameUpdateAlert, frameUpdateAlert);
+  if(method == methodSnapshot || method == methodEngine) paf.setSnapshotRead(2);
+  if(useEngine) paf.beginAcquisition(&ring, NULL);
+  attachInterrupt(INT_PIN, intHandler, FALLING);
+  paf.clearInterrupt();
+  paf.resumeOperation();
+
+  PAF9701_Frame frame;
+  uint32_t tornFrames = 0, done = 0;
+  bus.resetStats();
+  paf.resetBusStats();
+  paf.resetAcquisitionStats();
+  while(done < frames) {
+    if(useEngine) {
+      if(!paf.serviceAcquisition()) {
+        simAdvance(paf.acquisitionBusy() ? 1000000 : 10000);   // other work between steps, or idle
+      }
+      PAF9701_Frame * ready = ring.consumerSlot();
+      if(ready) {
+        if(torn(ready->pixels)) tornFrames++;
+        ring.release();
+        done++;
+      }
+      continue;
+    }
+    if(!intFlag) {
+      simAdvance(10000);      // idle until the INT edge
+      continue;
+    }
+    intFlag = false;
+    simAdvance((uint64_t) (lcg(&seed) % (uint32_t) (period / 1000)) * 1000);   // other work before the frame is read, in us
+    switch(method) {
+      case methodSeparate: {
+        uint32_t alertPixels[2];
+        paf.getStatus();
+        paf.clearInterrupt();
+        paf.getAlertPixels(alertPixels);
+        paf.getToDataRaw(frame.pixels);
+        break;
+      }
+      case methodReadFrame:
+        paf.readFrame(&frame);
+        paf.clearInterrupt();
+        break;
+      case methodSnapshot:
+        paf.readFrame(&frame);
+        break;
+    }
+    if(torn(frame.pixels)) tornFrames++;
+    done++;
+  }
+
+  SimBusStats stats;
+  PAF9701_BusStats driverStats;
+  PAF9701_AcqStats acqStats;
+  bus.getStats(&stats);
+  paf.getBusStats(&driverStats);
+  paf.getAcquisitionStats(&acqStats);
+  printf("%7u  %-9s  %6.1f  %6.1f  %8.2f  %5u  %7u", clock / 1000, methodName[method],
+         (double) stats.transfers / frames, (double) stats.bytes / frames, stats.busTime / 1e6 / frames,
+         tornFrames, driverStats.snapshotRetries);
+  if(useEngine) printf("  %7.2f  %7.2f", acqStats.totalLatency / 1e3 / acqStats.frames, acqStats.maxLatency / 1e3);
+  printf("\n");
+
+  detachInterrupt(INT_PIN);
+  simDetach(&sensor);
+  Wire.setAdapter(NULL);
+}
+
+
+int main(int argc, char ** argv)
+{
+  uint32_t frames = argc > 1 ? atoi(argv[1]) : 500;
+  static const uint32_t clocks[] = {100000, 400000, 1000000};
+  printf("%u frames at %u Hz per run, other work between INT and read up to one frame period\n\n", frames, RATE_HZ);
+  printf("    kHz  method     xfers   bytes   bus ms   torn  retries  avg ms   max ms\n");
+  for(uint8_t cc = 0; cc < 3; cc++) {
+    for(uint8_t method = methodSeparate; method <= methodEngine; method++) {
+      run(clocks[cc], method, frames);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,235 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host run of PAF9701IntDemux: 1, 2, 4 and 8 PAF9701 models, two per simulated 400 kHz bus,
+ *  their INT outputs either on one open drain wired-OR pin (shared, through the demux) or each
+ *  on its own push pull pin (dedicated, the sketches' wiring). The frame periods differ by one
+ *  1.28 ms step per sensor around 10 Hz, so the sensors drift through every phase relation.
+ *  Frames are read with PAF9701Group; loop() does 200 us of other work between service() calls.
+ *
+ *  Reports, from the moment the model raises its frame update flag, the delay to dispatch and
+ *  to frame ready (average and worst over all sensors), the status reads per frame spent
+ *  finding the source, and frames the models published but were never read. A last run puts a
+ *  sensor on the line that raises INT for a flag it was not added for and checks the other
+ *  sensor's frames are still all read; the exit status is 1 if not. All time is virtual, so the
+ *  numbers are the same on every run.
+ *
+ *  g++ -O2 -I. -I../PAF9701_GestureDetection_Ladybug bench_demux.cpp Arduino.cpp Wire.cpp SimBus.cpp PAF9701Sim.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701FrameRing.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701Group.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701IntDemux.cpp ../PAF9701_GestureDetection_Ladybug/I2Cdev.cpp -o bench_demux
+ *  ./bench_demux [seconds]
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "PAF9701Sim.h"
+#include "PAF9701Group.h"
+#include "PAF9701IntDemux.h"
+
+#define MAX_SENSORS  8
+#define SHARED_PIN   5
+#define FIRST_PIN   20      // dedicated pins 20 - 27
+
+static TwoWire wires[MAX_SENSORS / 2];
+static PAF9701Group * group;
+static PAF9701IntDemux * demux;
+static uint64_t published[MAX_SENSORS];   // ns the model last raised its frame update flag
+static uint64_t dispatchTotal, dispatchMax, readyTotal, readyMax;
+static uint32_t dispatchCount, readyCount;
+
+static void sharedHandler() { demux->handleInterrupt(); }
+static void (* const dedicatedHandlers[MAX_SENSORS])(void) = {
+  [] { group->startAcquisition(0); }, [] { group->startAcquisition(1); }, [] { group->startAcquisition(2); }, [] { group->startAcquisition(3); },
+  [] { group->startAcquisition(4); }, [] { group->startAcquisition(5); }, [] { group->startAcquisition(6); }, [] { group->startAcquisition(7); }
+};
+
+
+static void recordingScene(void * context, uint64_t now, int16_t * pixels, int16_t * ambient)
+{
+  *(uint64_t *) context = now;
+  paf9701SimWarmObject(NULL, now, pixels, ambient);
+}
+
+
+static void onDispatch(uint8_t sensor, uint8_t status, uint32_t edge)
+{
+  (void) status; (void) edge;
+  uint64_t delay = simNow() - published[sensor];
+  dispatchTotal += delay;
+  if(delay > dispatchMax) dispatchMax = delay;
+  dispatchCount++;
+}
+
+
+static void onFrame(uint8_t sensor, PAF9701_Frame * frame)
+{
+  (void) frame;
+  uint64_t delay = simNow() - published[sensor];
+  readyTotal += delay;
+  if(delay > readyMax) readyMax = delay;
+  readyCount++;
+}
+
+
+static void run(uint8_t count, bool shared, uint32_t seconds)
+{
+  SimBus * buses[MAX_SENSORS / 2];
+  PAF9701Sim * models[MAX_SENSORS];
+  PAF9701 * sensors[MAX_SENSORS];
+  I2Cdev * i2c[MAX_SENSORS / 2];
+  PAF9701_Frame frames[MAX_SENSORS];
+  PAF9701Group sensorGroup;
+  PAF9701IntDemux lineDemux(SHARED_PIN);
+  group = &sensorGroup;
+  demux = &lineDemux;
+  dispatchTotal = dispatchMax = readyTotal = readyMax = 0;
+  dispatchCount = readyCount = 0;
+
+  for(uint8_t bus = 0; bus < (count + 1) / 2; bus++) {
+    buses[bus] = new SimBus(400000);
+    wires[bus].setAdapter(buses[bus]);
+    i2c[bus] = new I2Cdev(&wires[bus]);
+  }
+  for(uint8_t ii = 0; ii < count; ii++) {
+    uint8_t address = ii & 1 ? PAF9701_ADDRESS_ADO : PAF9701_ADDRESS;
+    models[ii] = new PAF9701Sim(address, shared ? SHARED_PIN : FIRST_PIN + ii);
+    models[ii]->setScene(recordingScene, &published[ii]);
+    buses[ii / 2]->attach(models[ii]);
+    simAttach(models[ii]);
+    sensors[ii] = new PAF9701(i2c[ii / 2], address);
+  }
+
+  for(uint8_t ii = 0; ii < count; ii++) {
+    PAF9701 * paf = sensors[ii];
+    paf->coldReset();
+    while(!(paf->getStatus() & 0x20)) {}
+    paf->initNormalMode(normal_mode, 78 + ii, true);   // 99.84 ms and one 1.28 ms step longer per sensor
+    paf->setAlertMode(frameUpdateAlert, frameUpdateAlert);
+    paf->setSnapshotRead(2);
+    paf->setInterruptOpenDrain(shared);
+    paf->clearInterrupt();
+    sensorGroup.add(paf, &frames[ii]);
+    if(shared) lineDemux.add(paf);
+    else attachInterrupt(FIRST_PIN + ii, dedicatedHandlers[ii], FALLING);
+  }
+  if(shared) attachInterrupt(SHARED_PIN, sharedHandler, FALLING);
+  lineDemux.setCallback(onDispatch);
+  sensorGroup.setCallback(onFrame);
+  for(uint8_t ii = 0; ii < count; ii++) sensors[ii]->resumeOperation();
+
+  uint32_t startFrames[MAX_SENSORS];
+  for(uint8_t ii = 0; ii < count; ii++) startFrames[ii] = models[ii]->framesPublished();
+  sensorGroup.resetStats();
+  uint64_t end = simNow() + (uint64_t) seconds * 1000000000ULL;
+  while(simNow() < end) {
+    if(shared) lineDemux.service();
+    sensorGroup.service();
+    simAdvance(200000);    // other work in loop()
+  }
+
+  uint32_t publishedFrames = 0, readFrames = 0;
+  for(uint8_t ii = 0; ii < count; ii++) {
+    PAF9701_SensorStats stats;
+    sensorGroup.getSensorStats(ii, &stats);
+    publishedFrames += models[ii]->framesPublished() - startFrames[ii];
+    readFrames += stats.frames;
+  }
+  PAF9701_DemuxStats demuxStats;
+  lineDemux.getStats(&demuxStats);
+  printf("%7u  %-9s  %8.2f  %8.2f  %8.2f  %8.2f  %11.2f  %6u\n", count, shared ? "shared" : "dedicated",
+         shared && dispatchCount ? dispatchTotal / 1e6 / dispatchCount : 0.0, dispatchMax / 1e6,
+         readyCount ? readyTotal / 1e6 / readyCount : 0.0, readyMax / 1e6,
+         readFrames ? (double) demuxStats.statusReads / readFrames : 0.0,
+         publishedFrames > readFrames + count ? publishedFrames - readFrames - count : 0);   // one frame per sensor may be in flight at the end
+
+  if(shared) detachInterrupt(SHARED_PIN);
+  for(uint8_t ii = 0; ii < count; ii++) {
+    if(!shared) detachInterrupt(FIRST_PIN + ii);
+    sensors[ii]->setInterruptOpenDrain(false);   // let go of the shared pin
+  }
+  for(uint8_t ii = 0; ii < count; ii++) {
+    simDetach(models[ii]);
+    delete sensors[ii];
+    delete models[ii];
+  }
+  for(uint8_t bus = 0; bus < (count + 1) / 2; bus++) {
+    wires[bus].setAdapter(NULL);
+    delete i2c[bus];
+    delete buses[bus];
+  }
+}
+
+
+// sensor 0 raises INT on every frame but was added for alerts only, so its flag is outside the
+// demux's intFlags and holds the line low; sensor 1 must still get its frames read
+static bool strayRun(uint32_t seconds)
+{
+  SimBus bus(400000);
+  TwoWire wire;
+  wire.setAdapter(&bus);
+  I2Cdev i2c(&wire);
+  PAF9701Sim models[2] = {PAF9701Sim(PAF9701_ADDRESS, SHARED_PIN), PAF9701Sim(PAF9701_ADDRESS_ADO, SHARED_PIN)};
+  PAF9701 sensor0(&i2c, PAF9701_ADDRESS), sensor1(&i2c, PAF9701_ADDRESS_ADO);
+  PAF9701 * sensors[2] = {&sensor0, &sensor1};
+  PAF9701_Frame frame;
+  PAF9701Group sensorGroup;
+  PAF9701IntDemux lineDemux(SHARED_PIN);
+  group = &sensorGroup;
+  demux = &lineDemux;
+
+  for(uint8_t ii = 0; ii < 2; ii++) {
+    bus.attach(&models[ii]);
+    simAttach(&models[ii]);
+    sensors[ii]->coldReset();
+    while(!(sensors[ii]->getStatus() & 0x20)) {}
+    sensors[ii]->initNormalMode(normal_mode, 78 + ii, true);
+    sensors[ii]->setAlertMode(frameUpdateAlert, frameUpdateAlert);
+    sensors[ii]->setInterruptOpenDrain(true);
+    sensors[ii]->clearInterrupt();
+  }
+  sensorGroup.add(&sensor1, &frame);
+  lineDemux.add(&sensor0, 0x01, false);   // alerts only, but ALERT_MODE still raises INT per frame
+  lineDemux.add(&sensor1);
+  attachInterrupt(SHARED_PIN, sharedHandler, FALLING);
+  for(uint8_t ii = 0; ii < 2; ii++) sensors[ii]->resumeOperation();
+
+  uint32_t startFrames = models[1].framesPublished();
+  sensorGroup.resetStats();
+  uint64_t end = simNow() + (uint64_t) seconds * 1000000000ULL;
+  while(simNow() < end) {
+    lineDemux.service();
+    sensorGroup.service();
+    simAdvance(200000);
+  }
+
+  PAF9701_SensorStats stats;
+  sensorGroup.getSensorStats(0, &stats);
+  PAF9701_DemuxStats demuxStats;
+  lineDemux.getStats(&demuxStats);
+  uint32_t publishedFrames = models[1].framesPublished() - startFrames;
+  printf("\nstray flag on sensor 0: sensor 1 read %u of %u frames, %u stray clears, %u empty scans\n",
+         stats.frames, publishedFrames, demuxStats.strayClears, demuxStats.emptyScans);
+
+  detachInterrupt(SHARED_PIN);
+  for(uint8_t ii = 0; ii < 2; ii++) {
+    sensors[ii]->setInterruptOpenDrain(false);
+    simDetach(&models[ii]);
+  }
+  wire.setAdapter(NULL);
+  return stats.frames + 1 >= publishedFrames;   // one frame may be in flight at the end
+}
+
+
+int main(int argc, char ** argv)
+{
+  uint32_t seconds = argc > 1 ? atoi(argv[1]) : 20;
+  printf("%u s per run, delays in ms from the frame update flag\n\n", seconds);
+  printf("sensors  INT        disp avg  disp max  read avg  read max  status/frame  missed\n");
+  static const uint8_t counts[] = {1, 2, 4, 8};
+  for(uint8_t cc = 0; cc < 4; cc++) {
+    run(counts[cc], false, seconds);
+    run(counts[cc], true, seconds);
+  }
+  return strayRun(seconds) ? 0 : 1;
+}
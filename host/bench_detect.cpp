@@ -0,0 +1,177 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host run of the auto power save ladder with different detection tier settings
+ *  (PAF9701::setDetectConfig()), against the model in PAF9701Sim.h.
+ *
+ *  The scene is a 24 C background with two kinds of visitors on a fixed pseudo-random schedule:
+ *  people (a 3 x 3 pixel 34 C block, 3 s, about every 5 minutes) and small objects (2 pixels,
+ *  3 s, about every minute). Alerts are absValue with a 30 C object limit and one pixel. For each
+ *  setting it reports whether the sensor holds the setting (verifyDetectConfig()), the delay from
+ *  a person appearing to normal mode, people the sensor never woke for, wake-ups caused by small
+ *  objects, frames published per hour and the share of time in each stage. Frames per hour and
+ *  time in the detect modes stand in for the average current. All time is virtual.
+ *
+ *  g++ -O2 -I. -I../PAF9701_GestureDetection_Ladybug bench_detect.cpp Arduino.cpp Wire.cpp SimBus.cpp PAF9701Sim.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701FrameRing.cpp ../PAF9701_GestureDetection_Ladybug/I2Cdev.cpp -o bench_detect
+ *  ./bench_detect [hours]
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "PAF9701Sim.h"
+
+#define STEP_NS      10000000ULL   // 10 ms
+#define VISIT_NS   3000000000ULL   // 3 s
+#define MAX_VISITS  4096
+
+typedef struct {
+  uint64_t start;
+  bool person;
+} Visit;
+
+static Visit visits[MAX_VISITS];
+static uint32_t visitCount;
+static uint64_t runStart;        // visits are scheduled from here
+
+static const struct {
+  const char * name;
+  bool chipDefaults;           // keep DET1/DET2 as the part comes up
+  uint32_t det1Ms, det2Ms;
+  bool skipMode;
+} settings[] = {
+  {"chip defaults",   true,     0,     0, false},
+  {"1 s / 5 s",       false, 1000,  5000, false},
+  {"0.5 s / 2 s",     false,  500,  2000, false},
+  {"1 s / 5 s, skip", false, 1000,  5000, true},
+  {"2 s / 10 s",      false, 2000, 10000, false}
+};
+
+
+static int32_t activeVisit(uint64_t now)
+{
+  for(uint32_t ii = 0; ii < visitCount; ii++) {
+    if(now >= visits[ii].start && now < visits[ii].start + VISIT_NS) return ii;
+  }
+  return -1;
+}
+
+
+static void visitorScene(void * context, uint64_t now, int16_t * pixels, int16_t * ambient)
+{
+  (void) context;
+  for(uint8_t ii = 0; ii < 64; ii++) pixels[ii] = 24 * 16;
+  int32_t visit = now >= runStart ? activeVisit(now - runStart) : -1;
+  if(visit >= 0) {
+    if(visits[visit].person) {
+      for(uint8_t y = 2; y < 5; y++) for(uint8_t x = 3; x < 6; x++) pixels[y * 8 + x] = 34 * 16;
+    }
+    else pixels[50] = pixels[51] = 34 * 16;
+  }
+  *ambient = 25 * 16;
+}
+
+
+static void schedule(uint64_t length)
+{
+  uint32_t seed = 7;
+  uint64_t t = 20000000000ULL;   // first visitor after the ladder has settled
+  visitCount = 0;
+  while(visitCount < MAX_VISITS) {
+    seed = seed * 1103515245u + 12345u;
+    t += 15000000000ULL + (uint64_t) ((seed >> 8) % 90000) * 1000000ULL;   // 15 - 105 s apart
+    if(t + VISIT_NS > length) break;
+    visits[visitCount].start = t;
+    visits[visitCount].person = (seed >> 4) % 5 == 0;
+    visitCount++;
+  }
+}
+
+
+static void run(uint8_t s, uint32_t hours)
+{
+  SimBus bus(400000);
+  PAF9701Sim sensor(PAF9701_ADDRESS);
+  sensor.setScene(visitorScene, NULL);
+  bus.attach(&sensor);
+  simAttach(&sensor);
+  Wire.setAdapter(&bus);
+  I2Cdev i2c(&Wire);
+  PAF9701 paf(&i2c);
+
+  paf.coldReset();
+  while(!(paf.getStatus() & 0x20)) {}
+  paf.initAutoPowerSaveMode(settings[s].skipMode, PAF9701_PERIOD_TICKS(10000), true);
+  paf.setAlertMode(absValueAlert, absValueAlert);
+  paf.setNormalAlertLimits(20, 80, 2, 0, 60, 2, 1);    // Ta 10 - 40 C, To 0 - 30 C, 1 pixel
+  paf.setDet123AlertLimits(20, 80, 2, 0, 60, 2, 1);
+  PAF9701_DetectConfig config;
+  paf.getDetectConfig(&config);
+  if(!settings[s].chipDefaults) {
+    config.det1Period = PAF9701_PERIOD_TICKS(settings[s].det1Ms);
+    config.det2Period = PAF9701_PERIOD_TICKS(settings[s].det2Ms);
+  }
+  config.detectTime = PAF9701_PERIOD_TICKS(10000);   // 10 s without an alert per stage
+  config.skip1Pixels = 4;
+  config.skip2Pixels = 4;
+  config.skipMode = settings[s].skipMode;
+  paf.setDetectConfig(&config);
+  bool verified = paf.verifyDetectConfig(&config);
+  paf.resumeOperation();
+
+  uint64_t start = runStart = simNow(), length = (uint64_t) hours * 3600000000000ULL;
+  uint32_t startFrames = sensor.framesPublished();
+  uint64_t stageTime[3] = {0, 0, 0}, wakeTotal = 0, wakeMax = 0;
+  uint32_t people = 0, woken = 0, smallWakes = 0;
+  int32_t lastVisit = -1;
+  bool awake = false;
+  uint8_t lastStage = sensor.powerSaveStage();
+  for(uint64_t t = 0; t < length; t += STEP_NS) {
+    simAdvance(STEP_NS);
+    uint8_t stage = sensor.powerSaveStage();
+    stageTime[stage] += STEP_NS;
+    int32_t visit = activeVisit(simNow() - start);
+    if(visit != lastVisit && visit >= 0) {      // a visitor appears
+      if(visits[visit].person) people++;
+      awake = false;
+    }
+    lastVisit = visit;
+    if(visit >= 0 && !awake && stage == 0) {
+      if(lastStage > 0 || visits[visit].start + start + STEP_NS >= simNow()) {   // woken by this visitor, or already awake
+        awake = true;
+        if(visits[visit].person) {
+          uint64_t delay = simNow() - start - visits[visit].start;
+          wakeTotal += delay;
+          if(delay > wakeMax) wakeMax = delay;
+          woken++;
+        }
+        else if(lastStage > 0) smallWakes++;
+      }
+    }
+    lastStage = stage;
+  }
+
+  double total = (double) length;
+  printf("%-16s  %-8s  %8.2f  %8.2f  %6u  %11u  %10.0f  %5.1f%%  %5.1f%%  %5.1f%%\n", settings[s].name, verified ? "yes" : "NO",
+         woken ? wakeTotal / 1e9 / woken : 0.0, wakeMax / 1e9, people - woken, smallWakes,
+         (sensor.framesPublished() - startFrames) / (double) hours,
+         100.0 * stageTime[0] / total, 100.0 * stageTime[1] / total, 100.0 * stageTime[2] / total);
+
+  simDetach(&sensor);
+  Wire.setAdapter(NULL);
+}
+
+
+int main(int argc, char ** argv)
+{
+  uint32_t hours = argc > 1 ? atoi(argv[1]) : 1;
+  schedule((uint64_t) hours * 3600000000000ULL);
+  uint32_t people = 0;
+  for(uint32_t ii = 0; ii < visitCount; ii++) people += visits[ii].person;
+  printf("%u h, %u visitors, %u of them people, 10 s without an alert per stage\n\n", hours, visitCount, people);
+  printf("DET1 / DET2       verified  wake avg  wake max  missed  small wakes  frames/h  normal  det 1   det 2\n");
+  for(uint8_t s = 0; s < sizeof(settings) / sizeof(settings[0]); s++) run(s, hours);
+  return 0;
+}
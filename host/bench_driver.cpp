@@ -0,0 +1,144 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host benchmark of the CPU cost of a frame read (readFrame() + clearInterrupt()) through
+ *
+ *    class     PAF9701 -> I2Cdev -> TwoWire
+ *    template  PAF9701Driver< PAF9701WireBus<Wire> > -> TwoWire
+ *    direct    PAF9701Driver<PAF9701SimDirectBus>, no Wire at all
+ *
+ *  The first two end in the same TwoWire and the same adapter into the PAF9701Sim register
+ *  model, so their difference is the cost of the driver layering itself. Bus time is not
+ *  simulated here, see bench_bus.cpp for that. First it checks that initNormalMode() through the
+ *  class and the template leaves two models with the same registers, for three profiles with and
+ *  without setEmissivity() and setDecayTime(); the exit status is 1 if not or if the frames read
+ *  back differ.
+ *
+ *  g++ -O2 -I. -I../PAF9701_GestureDetection_Ladybug bench_driver.cpp Arduino.cpp Wire.cpp SimBus.cpp PAF9701Sim.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701FrameRing.cpp ../PAF9701_GestureDetection_Ladybug/I2Cdev.cpp -o bench_driver
+ *  ./bench_driver [reads]
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLES() __rdtsc()
+#else
+#define CYCLES() 0ULL
+#endif
+
+#include "PAF9701Driver.h"
+#include "PAF9701HostBus.h"
+
+static PAF9701Sim sensor;
+
+
+class DirectAdapter : public I2CAdapter   // TwoWire transfers straight into the model, no timing
+{
+  public:
+  DirectAdapter(PAF9701Sim * model = &sensor) : _model(model) {}
+  uint8_t transfer(uint8_t address, const uint8_t * tx, size_t txCount, uint8_t * rx, size_t rxCount)
+  {
+    if(address != _model->address()) return 2;
+    if(txCount) _model->i2cWrite(tx, txCount);
+    if(rxCount) _model->i2cRead(rx, rxCount);
+    return 0;
+  }
+  private:
+  PAF9701Sim * _model;
+};
+
+
+// initNormalMode() through the class and the template on two models, returns registers that differ
+static uint32_t compareInit(uint8_t profile, uint32_t sampleRate, float emissivity, float decayTime)
+{
+  PAF9701Sim classModel, driverModel;
+  DirectAdapter adapter(&classModel);
+  Wire.setAdapter(&adapter);
+  I2Cdev i2c(&Wire);
+  PAF9701 paf(&i2c);
+  PAF9701SimDirectBus bus(&driverModel);
+  PAF9701Driver<PAF9701SimDirectBus> driver(bus);
+  simAttach(&classModel);
+  simAttach(&driverModel);
+  delay(5);                              // bootload
+
+  uint32_t wrong = 0;
+  if(emissivity > 0.0f && paf.setEmissivity(emissivity) != driver.setEmissivity(emissivity)) wrong++;
+  if(decayTime > 0.0f && paf.setDecayTime(decayTime) != driver.setDecayTime(decayTime)) wrong++;
+  if(paf.initNormalMode(normal_mode, sampleRate, false, profile) != driver.initNormalMode(normal_mode, sampleRate, false, profile)) wrong++;
+  static const uint8_t banks[] = {0, 1, 3, 4};
+  for(uint8_t bb = 0; bb < 4; bb++) {
+    for(uint8_t reg = 0x0C; reg < 0x80; reg++) {
+      if(banks[bb] == 0 && (reg == PAF9701_HOST_RSTB || reg == PAF9701_BANK_SELECT)) continue;
+      if(banks[bb] == 4 && reg < 0x48) continue;     // pixel data and alert flags
+      if(classModel.reg(banks[bb], reg) != driverModel.reg(banks[bb], reg)) wrong++;
+    }
+  }
+  simDetach(&driverModel);
+  simDetach(&classModel);
+  Wire.setAdapter(NULL);
+  return wrong;
+}
+
+
+template<class Driver>
+static void measure(const char * name, Driver & driver, uint32_t reads, PAF9701_Frame * frame)
+{
+  for(uint32_t ii = 0; ii < 100; ii++) {   // warm up
+    driver.readFrame(frame);
+    driver.clearInterrupt();
+  }
+  double ns = 1e30, cycles = 1e30;   // best of 5 runs, the host is not quiet
+  for(int run = 0; run < 5; run++) {
+    uint64_t c0 = CYCLES();
+    auto t0 = std::chrono::steady_clock::now();
+    for(uint32_t ii = 0; ii < reads; ii++) {
+      driver.readFrame(frame);
+      driver.clearInterrupt();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    uint64_t c1 = CYCLES();
+    double t = std::chrono::duration<double, std::nano>(t1 - t0).count() / reads;
+    if(t < ns) ns = t;
+    if((double) (c1 - c0) / reads < cycles) cycles = (double) (c1 - c0) / reads;
+  }
+  printf("%-9s  %9.1f  %9.0f\n", name, ns, cycles);
+}
+
+
+int main(int argc, char ** argv)
+{
+  uint32_t reads = argc > 1 ? atoi(argv[1]) : 200000;
+  uint32_t initWrong = compareInit(balancedProfile, 78, 0.0f, 0.0f) + compareInit(lowNoiseProfile, 78, 0.95f, 2.0f)
+                     + compareInit(lowLatencyProfile, 20, 0.9f, 0.0f);
+  printf("initNormalMode(), class against template: %u registers differ\n\n", initWrong);
+  DirectAdapter adapter;
+  Wire.setAdapter(&adapter);
+  I2Cdev i2c(&Wire);
+  PAF9701 paf(&i2c);
+  PAF9701Driver< PAF9701WireBus<Wire> > wireDriver;
+  PAF9701SimDirectBus directBus(&sensor);
+  PAF9701Driver<PAF9701SimDirectBus> directDriver(directBus);
+
+  // publish one frame of the default scene to read back
+  paf.initNormalMode(normal_mode, 200000 / (256 * 10), true);
+  paf.resumeOperation();
+  simAttach(&sensor);
+  delay(150);
+  simDetach(&sensor);
+
+  PAF9701_Frame frames[3];
+  printf("5 x %u reads of one frame, readFrame() + clearInterrupt()\n\n", reads);
+  printf("driver     ns/read    cycles/read\n");
+  measure("class", paf, reads, &frames[0]);
+  measure("template", wireDriver, reads, &frames[1]);
+  measure("direct", directDriver, reads, &frames[2]);
+  bool same = memcmp(frames[0].pixels, frames[1].pixels, 128) == 0 && memcmp(frames[0].pixels, frames[2].pixels, 128) == 0;
+  printf("\nframes %s\n", same ? "identical" : "DIFFER");
+  return !same || initWrong;
+}
@@ -0,0 +1,217 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host benchmark of the per-frame display pipeline: float (getToData() + float min/max and
+ *  normalization, as the sketches did) against fixed point (getToDataRaw() + PAF9701Frame.h).
+ *
+ *  Both pipelines start from the 128 pixel bytes read from banks 4 and 5 and produce the color
+ *  index of every pixel, an alert mask for a temperature threshold and its centroid.
+ *
+ *  Frames come from a serial monitor log of one of the sketches (the 8 x 8 blocks of comma
+ *  separated temperatures, other lines are ignored) or, without a log, from a synthetic warm
+ *  object moving over a 24 C background.
+ *
+ *  On an x86 host the fixed point pipeline is usually the slower one, about 0.75 - 0.85 times
+ *  the speed of float and never clearly faster, since the host FPU makes float as cheap as
+ *  integer work. That figure does not carry
+ *  over to the Cortex-M4 target and this bench does not measure the target; what the fixed
+ *  point path saves there for certain is half the frame buffer and the per pixel float
+ *  conversions.
+ *
+ *  g++ -O2 -I../PAF9701_GestureDetection_Ladybug bench_frame.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701Frame.cpp -o bench_frame
+ *  ./bench_frame [serial_log.txt] [threshold_C]
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "PAF9701Frame.h"
+
+#define REPEAT  2000   // passes over the frame set per pipeline
+
+typedef struct {
+  uint8_t  rawData[128];   // as read from the sensor, LSB first
+} RecordedFrame;
+
+
+static void putPixel(RecordedFrame * frame, uint8_t ii, float celsius)
+{
+  int16_t raw = (int16_t) lrintf(celsius * 16.0f);
+  frame->rawData[2*ii]     = raw & 0xFF;
+  frame->rawData[2*ii + 1] = (raw >> 8) & 0xFF;
+}
+
+
+static size_t loadLog(const char * path, std::vector<RecordedFrame> & frames)
+{
+  FILE * fp = fopen(path, "r");
+  if(fp == NULL) return 0;
+  char line[512];
+  RecordedFrame frame;
+  uint8_t count = 0;
+  while(fgets(line, sizeof(line), fp)) {
+    bool data = true;                   // temperature rows hold only digits, signs, dots and commas
+    for(char * c = line; *c; c++) {
+      if(isalpha((unsigned char) *c)) data = false;
+    }
+    if(!data) continue;
+    char * c = line;
+    while(*c) {
+      char * end;
+      float value = strtof(c, &end);
+      if(end == c) { c++; continue; }
+      putPixel(&frame, count++, value);
+      if(count == 64) {
+        frames.push_back(frame);
+        count = 0;
+      }
+      c = end;
+    }
+  }
+  fclose(fp);
+  return frames.size();
+}
+
+
+static void synthesize(std::vector<RecordedFrame> & frames)
+{
+  uint32_t seed = 1;
+  for(int n = 0; n < 200; n++) {
+    RecordedFrame frame;
+    float cx = 3.5f + 3.0f * sinf(n * 0.07f), cy = 3.5f + 2.5f * cosf(n * 0.05f);
+    for(uint8_t ii = 0; ii < 64; ii++) {
+      float dx = (ii & 7) - cx, dy = (ii >> 3) - cy;
+      seed = seed * 1103515245u + 12345u;
+      float noise = ((seed >> 16) & 0xFF) / 255.0f - 0.5f;
+      putPixel(&frame, ii, 24.0f + 10.0f * expf(-(dx*dx + dy*dy) / 3.0f) + 0.4f * noise);
+    }
+    frames.push_back(frame);
+  }
+}
+
+
+// what the sketches did with getToData(): float conversion, float min/max, float normalization
+static uint32_t floatPipeline(const RecordedFrame * in, float threshold, uint8_t * rgb, uint64_t * mask, float * cx, float * cy)
+{
+  float temperatures[64];
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    temperatures[ii] = (float) ((int16_t) ( (int16_t) in->rawData[2*ii + 1] << 8) | in->rawData[2*ii]);
+    temperatures[ii] *= 0.0625f;
+  }
+  float minTemp = 1000.0f, maxTemp = 0.0f;
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    if(temperatures[ii] > maxTemp) maxTemp = temperatures[ii];
+    if(temperatures[ii] < minTemp) minTemp = temperatures[ii];
+  }
+  uint64_t bits = 0;
+  float sumX = 0.0f, sumY = 0.0f;
+  uint32_t count = 0;
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    rgb[ii] = (uint8_t) (((temperatures[ii] - minTemp)/(maxTemp - minTemp)) * 199);
+    if(temperatures[ii] >= threshold) {
+      bits |= (uint64_t) 1 << ii;
+      sumX += ii % 8;
+      sumY += ii / 8;
+      count++;
+    }
+  }
+  *mask = bits;
+  *cx = count ? sumX / count : 0.0f;
+  *cy = count ? sumY / count : 0.0f;
+  return count;
+}
+
+
+// the same steps in raw 1/16 C units
+static uint32_t fixedPipeline(const RecordedFrame * in, int16_t threshold, uint8_t * rgb, uint64_t * mask, uint16_t * cx, uint16_t * cy)
+{
+  int16_t temperatures[64];
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    temperatures[ii] = (int16_t) ( (uint16_t) in->rawData[2*ii + 1] << 8 | in->rawData[2*ii]);
+  }
+  int16_t minTemp, maxTemp;
+  PAF9701_Scale scale;
+  frameMinMax(temperatures, 64, &minTemp, &maxTemp);
+  frameScaleInit(&scale, minTemp, maxTemp, 199);
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    rgb[ii] = frameScale(&scale, temperatures[ii]);
+  }
+  *mask = frameThreshold(temperatures, threshold);
+  return frameCentroid(*mask, cx, cy);
+}
+
+
+int main(int argc, char ** argv)
+{
+  std::vector<RecordedFrame> frames;
+  float threshold = argc > 2 ? atof(argv[2]) : 28.0f;
+  if(argc > 1) {
+    if(loadLog(argv[1], frames) == 0) {
+      fprintf(stderr, "no frames found in %s\n", argv[1]);
+      return 1;
+    }
+    printf("%zu recorded frames from %s\n", frames.size(), argv[1]);
+  }
+  else {
+    synthesize(frames);
+    printf("%zu synthetic frames\n", frames.size());
+  }
+
+  // agreement between the two pipelines
+  uint32_t maskMismatch = 0, rgbOffByOne = 0, rgbWorse = 0;
+  float centroidError = 0.0f;
+  for(size_t n = 0; n < frames.size(); n++) {
+    uint8_t rgbF[64], rgbX[64];
+    uint64_t maskF, maskX;
+    float fx, fy;
+    uint16_t xx, xy;
+    floatPipeline(&frames[n], threshold, rgbF, &maskF, &fx, &fy);
+    fixedPipeline(&frames[n], PAF9701_TO_RAW(threshold), rgbX, &maskX, &xx, &xy);
+    if(maskF != maskX) maskMismatch++;
+    for(uint8_t ii = 0; ii < 64; ii++) {
+      int d = abs(rgbF[ii] - rgbX[ii]);
+      if(d == 1) rgbOffByOne++;
+      if(d > 1) rgbWorse++;
+    }
+    float e = fabsf(fx - xx / 256.0f) + fabsf(fy - xy / 256.0f);
+    if(e > centroidError) centroidError = e;
+  }
+  printf("mask mismatches %u, color index off by one %u, off by more %u, max centroid error %.4f px\n",
+         maskMismatch, rgbOffByOne, rgbWorse, centroidError);
+
+  volatile uint32_t sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for(int r = 0; r < REPEAT; r++) {
+    for(size_t n = 0; n < frames.size(); n++) {
+      uint8_t rgb[64];
+      uint64_t mask;
+      float fx, fy;
+      sink += floatPipeline(&frames[n], threshold, rgb, &mask, &fx, &fy) + rgb[n & 63];
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for(int r = 0; r < REPEAT; r++) {
+    for(size_t n = 0; n < frames.size(); n++) {
+      uint8_t rgb[64];
+      uint64_t mask;
+      uint16_t xx, xy;
+      sink += fixedPipeline(&frames[n], PAF9701_TO_RAW(threshold), rgb, &mask, &xx, &xy) + rgb[n & 63];
+    }
+  }
+  auto t2 = std::chrono::steady_clock::now();
+
+  double frameCount = (double) REPEAT * frames.size();
+  double floatNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / frameCount;
+  double fixedNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / frameCount;
+  printf("float pipeline  %8.1f ns/frame, frame buffer %u bytes\n", floatNs, (unsigned) (64 * sizeof(float)));
+  printf("fixed pipeline  %8.1f ns/frame, frame buffer %u bytes\n", fixedNs, (unsigned) (64 * sizeof(int16_t)));
+  printf("speedup %.2fx on this host (below 1 = fixed point slower), not a Cortex-M4 figure\n", floatNs / fixedNs);
+  return sink == 0xFFFFFFFF;
+}
@@ -0,0 +1,113 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host run of PAF9701Group: four PAF9701 models on two simulated buses,
+ *
+ *    bus 0, 400 kHz   0x34 at 20 Hz with INT,  0x57 at 10 Hz with INT
+ *    bus 1, 100 kHz   0x34 at 20 Hz with INT,  0x57 at 10 Hz polled every 100 ms (no INT wired)
+ *
+ *  all in frame update alert mode with snapshot reads, each publishing into its own
+ *  PAF9701FrameRing. loop() calls service() with 200 us of other work between calls and drains
+ *  the rings. Reports per-sensor frame rate, latency and drops and per-bus utilization over the
+ *  run. All time is virtual, so the numbers are the same on every run.
+ *
+ *  g++ -O2 -I. -I../PAF9701_GestureDetection_Ladybug bench_group.cpp Arduino.cpp Wire.cpp SimBus.cpp PAF9701Sim.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701FrameRing.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701Group.cpp ../PAF9701_GestureDetection_Ladybug/I2Cdev.cpp -o bench_group
+ *  ./bench_group [seconds]
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "PAF9701Sim.h"
+#include "PAF9701Group.h"
+
+#define SENSORS  4
+
+static const struct {
+  uint8_t bus, address, intPin, rateHz;
+} layout[SENSORS] = {
+  {0, PAF9701_ADDRESS,     2, 20},
+  {0, PAF9701_ADDRESS_ADO, 3, 10},
+  {1, PAF9701_ADDRESS,     4, 20},
+  {1, PAF9701_ADDRESS_ADO, PAF9701_SIM_NO_PIN, 10}
+};
+
+static TwoWire Wire1;
+static PAF9701Group group;
+static uint32_t tornFrames[SENSORS];
+
+static void int0() { group.startAcquisition(0); }
+static void int1() { group.startAcquisition(1); }
+static void int2() { group.startAcquisition(2); }
+static void (* const handlers[SENSORS])(void) = {int0, int1, int2, NULL};
+
+
+int main(int argc, char ** argv)
+{
+  uint32_t seconds = argc > 1 ? atoi(argv[1]) : 10;
+  SimBus bus0(400000), bus1(100000);
+  Wire.setAdapter(&bus0);
+  Wire1.setAdapter(&bus1);
+  I2Cdev i2c_0(&Wire), i2c_1(&Wire1);
+
+  uint32_t counters[SENSORS] = {0};
+  PAF9701Sim * models[SENSORS];
+  PAF9701 * sensors[SENSORS];
+  PAF9701FrameRing rings[SENSORS];
+  for(uint8_t ii = 0; ii < SENSORS; ii++) {
+    models[ii] = new PAF9701Sim(layout[ii].address, layout[ii].intPin);
+    models[ii]->setScene(paf9701SimFrameCounter, &counters[ii]);
+    (layout[ii].bus ? bus1 : bus0).attach(models[ii]);
+    simAttach(models[ii]);
+    sensors[ii] = new PAF9701(layout[ii].bus ? &i2c_1 : &i2c_0, layout[ii].address);
+  }
+
+  // setup as in the sketches, then hand the sensors to the group
+  for(uint8_t ii = 0; ii < SENSORS; ii++) {
+    PAF9701 * paf = sensors[ii];
+    paf->coldReset();
+    while(!(paf->getStatus() & 0x20)) {}
+    paf->initNormalMode(normal_mode, 200000 / (256 * layout[ii].rateHz), true, layout[ii].rateHz > 10 ? lowLatencyProfile : balancedProfile);
+    paf->setAlertMode(frameUpdateAlert, frameUpdateAlert);
+    paf->setSnapshotRead(2);
+    group.add(paf, &rings[ii]);
+    if(handlers[ii]) attachInterrupt(layout[ii].intPin, handlers[ii], FALLING);
+    else group.setPollInterval(ii, 1000000 / layout[ii].rateHz);
+    paf->clearInterrupt();
+    paf->resumeOperation();
+  }
+
+  group.resetStats();
+  uint64_t end = simNow() + (uint64_t) seconds * 1000000000ULL;
+  while(simNow() < end) {
+    group.service();
+    simAdvance(200000);    // other work in loop()
+    for(uint8_t ii = 0; ii < SENSORS; ii++) {
+      PAF9701_Frame * frame;
+      while((frame = rings[ii].consumerSlot()) != NULL) {
+        if(frame->pixels[0] != frame->pixels[63]) tornFrames[ii]++;
+        rings[ii].release();
+      }
+    }
+  }
+
+  printf("%u s, service() every 200 us\n\n", seconds);
+  printf("sensor  bus  addr  source  set Hz  read Hz  avg ms  max ms  overruns  drops  torn\n");
+  for(uint8_t ii = 0; ii < SENSORS; ii++) {
+    PAF9701_SensorStats stats;
+    group.getSensorStats(ii, &stats);
+    printf("%6u  %3u  0x%02X  %-6s  %6u  %7.2f  %6.2f  %6.2f  %8u  %5u  %4u\n", ii, group.busOf(ii), layout[ii].address,
+           handlers[ii] ? "INT" : "poll", layout[ii].rateHz, stats.frameRate / 1000.0,
+           stats.frames ? stats.totalLatency / 1e3 / stats.frames : 0.0, stats.maxLatency / 1e3,
+           stats.overruns, rings[ii].getDrops(), tornFrames[ii]);
+  }
+  printf("\nbus  sensors  busy ms  utilization\n");
+  for(uint8_t bus = 0; bus < group.busCount(); bus++) {
+    PAF9701_GroupBusStats stats;
+    group.getBusStats(bus, &stats);
+    printf("%3u  %7u  %7.1f  %10.1f%%\n", bus, stats.sensors, stats.busyTime / 1e3, stats.utilization / 10.0);
+  }
+  return 0;
+}
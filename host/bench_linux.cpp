@@ -0,0 +1,176 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host benchmark of the Linux i2c-dev adapter (LinuxI2C.h) under the PAF9701 library.
+ *
+ *  Reads frames with readFrame() and clearInterrupt(), first one ioctl(I2C_RDWR) per transfer,
+ *  then with the bank selects and pointer writes batched in front of the reads, and reports
+ *  system calls and i2c messages per frame and the time spent in each call. The start-up writes
+ *  are batched too and checked with endBatch().
+ *
+ *  Without arguments the ioctl is a stand-in that hands the messages to the PAF9701Sim register
+ *  model on a SimBus, so the call counts are exact and the latencies are those of the stand-in.
+ *  The stand-in then NACKs the emissivity writes, which a batched setEmissivity() must report at
+ *  endBatch() even though a status read carried them out and PAF9701Driver::initNormalMode() through PAF9701WireBus must report as false;
+ *  the exit status is 1 when either goes unnoticed.
+ *  With a device the frames come from a sensor on that bus, found by polling the data ready flag.
+ *
+ *  g++ -O2 -I. -I../PAF9701_GestureDetection_Ladybug bench_linux.cpp LinuxI2C.cpp Arduino.cpp Wire.cpp SimBus.cpp PAF9701Sim.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701FrameRing.cpp ../PAF9701_GestureDetection_Ladybug/I2Cdev.cpp -o bench_linux
+ *  ./bench_linux [/dev/i2c-N] [frames]
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "LinuxI2C.h"
+#include "PAF9701Driver.h"
+#include "PAF9701Sim.h"
+
+static SimBus * fakeBus = NULL;
+static int nackRegister = -1;      // register writes the stand-in does not acknowledge
+
+
+// I2C_RDWR on the simulated bus: a write followed by a read of the same address is one transfer
+static int fakeIoctl(int fd, unsigned long request, void * arg)
+{
+  (void) fd;
+  if(request != I2C_RDWR) return -1;
+  struct i2c_rdwr_ioctl_data * data = (struct i2c_rdwr_ioctl_data *) arg;
+  for(uint32_t ii = 0; ii < data->nmsgs; ii++) {
+    struct i2c_msg * msg = &data->msgs[ii];
+    uint8_t error;
+    if(!(msg->flags & I2C_M_RD) && msg->len > 1 && msg->buf[0] == nackRegister) {
+      errno = ENXIO;
+      return -1;
+    }
+    if(msg->flags & I2C_M_RD) {
+      error = fakeBus->transfer(msg->addr, NULL, 0, msg->buf, msg->len);
+    }
+    else if(ii + 1 < data->nmsgs && (data->msgs[ii + 1].flags & I2C_M_RD) && data->msgs[ii + 1].addr == msg->addr) {
+      error = fakeBus->transfer(msg->addr, msg->buf, msg->len, data->msgs[ii + 1].buf, data->msgs[ii + 1].len);
+      ii++;
+    }
+    else {
+      error = fakeBus->transfer(msg->addr, msg->buf, msg->len, NULL, 0);
+    }
+    if(error) {
+      errno = ENXIO;
+      return -1;
+    }
+  }
+  return data->nmsgs;
+}
+
+
+static void run(LinuxI2C * adapter, PAF9701 * paf, bool batch, uint32_t frames)
+{
+  PAF9701_Frame frame;
+  LinuxI2CStats before, after;
+  uint32_t calls = 0, messages = 0, bad = 0;
+  uint64_t time = 0, maxTime = 0;
+  int32_t last = -1;
+  for(uint32_t ff = 0; ff < frames; ff++) {
+    while(!(paf->getStatus() & 0x10)) delay(5);   // poll for data ready
+    adapter->getStats(&before);
+    if(batch) adapter->beginBatch();
+    paf->readFrame(&frame);
+    paf->clearInterrupt();
+    if(batch) adapter->endBatch();
+    adapter->getStats(&after);
+    calls += after.calls - before.calls;
+    messages += after.messages - before.messages;
+    time += after.totalTime - before.totalTime;
+    if(after.maxTime > maxTime) maxTime = after.maxTime;
+    if(fakeBus && (frame.pixels[0] != frame.pixels[63] || frame.pixels[0] <= last)) bad++;  // frame counter scene
+    last = frame.pixels[0];
+  }
+  printf("%-10s  %8.1f  %8.1f  %10.2f  %10.2f", batch ? "batched" : "unbatched",
+         (double) calls / frames, (double) messages / frames, time / 1e3 / calls, maxTime / 1e3);
+  if(fakeBus) printf("  %5u", bad);
+  printf("\n");
+}
+
+
+// a NACKed configuration write must come back as an error, returns the cases that went unnoticed
+static uint32_t nackRun(LinuxI2C * adapter, PAF9701 * paf)
+{
+  uint32_t missed = 0;
+  LinuxI2CStats before, after;
+  nackRegister = PAF9701_EMISSIVITY_L;
+
+  adapter->getStats(&before);
+  adapter->beginBatch();
+  paf->setEmissivity(0.90f);                       // held, then sent in front of the status read
+  paf->getStatus();
+  uint8_t error = adapter->endBatch();
+  adapter->getStats(&after);
+  printf("NACKed setEmissivity(), batched: endBatch() %u, %u errors counted\n", error, after.errors - before.errors);
+  if(error == 0 || after.errors == before.errors) missed++;
+
+  PAF9701Driver< PAF9701WireBus<Wire> > driver;
+  bool ok = driver.initNormalMode(normal_mode, 200000 / (256 * 10), true);
+  printf("NACKed PAF9701Driver::initNormalMode(): %s, %u bus errors\n", ok ? "true" : "false", driver.busErrors());
+  if(ok || driver.busErrors() == 0) missed++;
+
+  nackRegister = -1;
+  paf->setEmissivity(0.98f);
+  return missed;
+}
+
+
+int main(int argc, char ** argv)
+{
+  const char * device = argc > 1 && argv[1][0] == '/' ? argv[1] : NULL;
+  uint32_t frames = atoi(argv[argc - 1]) > 0 ? atoi(argv[argc - 1]) : 200;
+  uint32_t counter = 0;
+  SimBus bus(400000);
+  PAF9701Sim sensor(PAF9701_ADDRESS);
+  LinuxI2C adapter(device ? NULL : fakeIoctl);
+
+  if(device) {
+    if(!adapter.begin(device)) {
+      perror(device);
+      return 1;
+    }
+    simRealTime(true);
+  }
+  else {
+    sensor.setScene(paf9701SimFrameCounter, &counter);
+    bus.attach(&sensor);
+    simAttach(&sensor);
+    fakeBus = &bus;
+    adapter.begin(0);
+  }
+  Wire.setAdapter(&adapter);
+  I2Cdev i2c(&Wire);
+  PAF9701 paf(&i2c);
+
+  if(paf.getChipID() != 0x0280) {
+    printf("no PAF9701 at 0x%02X\n", PAF9701_ADDRESS);
+    return 1;
+  }
+  paf.coldReset();
+  while(!(paf.getStatus() & 0x20)) delay(1);
+  adapter.beginBatch();
+  paf.initNormalMode(normal_mode, 200000 / (256 * 10), true);
+  paf.clearInterrupt();
+  paf.resumeOperation();
+  uint8_t error = adapter.endBatch();             // the start-up writes are all out here, not at the first read
+  if(error) {
+    printf("start-up writes failed, Wire error %u\n", error);
+    return 1;
+  }
+
+  printf("%u frames per run from %s\n\n", frames, device ? device : "the simulator");
+  printf("mode        calls/fr  msgs/fr   avg us/call  max us/call%s\n", device ? "" : "  wrong");
+  run(&adapter, &paf, false, frames);
+  run(&adapter, &paf, true, frames);
+  if(device) return 0;
+
+  uint32_t missed = nackRun(&adapter, &paf);
+  printf("\n%u NACKs unnoticed\n", missed);
+  return missed ? 1 : 0;
+}
@@ -0,0 +1,301 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host benchmark of the alert mask analytics: the per-bit loops the sketches used against the
+ *  bitboard helpers in PAF9701Mask.h.
+ *
+ *  For each mask both versions produce the pixel count, the column and row sums for the
+ *  centroid and the list of set pixel indices (the sketches print them). The loops are the
+ *  AutoPowerSaveMode sketch's two 32 bit passes over getAlertPixels() with i % 8 and i / 8 per
+ *  set pixel; the bitboard version is maskMoments() and maskPop(). Masks are random at several
+ *  densities; every helper (moments, projections, shifts, morphology) is first checked against
+ *  a per pixel reference on all of them.
+ *
+ *  The second table runs the maskFilter() settings on a tracking case: a hand sized object
+ *  (pixels within 1.6 pixels of its center) moves over the frame, background pixels turn on at
+ *  random (speckles at the pixel threshold) and object pixels drop out. For each setting it
+ *  reports the rms distance of the mask centroid from the centroid of the clean object mask,
+ *  the largest frame to frame centroid jump not explained by the motion, the frames where the
+ *  object was lost and the filter time.
+ *
+ *  g++ -O2 -I../PAF9701_GestureDetection_Ladybug bench_mask.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701Mask.cpp -o bench_mask
+ *  ./bench_mask
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "PAF9701Mask.h"
+
+#define MASKS    4096   // per density
+#define REPEAT    200   // passes over the masks per version
+#define TRACK    4000   // frames of the tracking case
+#define SPECKLE     4   // in 256, chance a background pixel is on
+#define DROPOUT    20   // in 256, chance an object pixel is off
+
+typedef struct {
+  uint8_t  count;
+  uint16_t sumX, sumY;
+  uint8_t  indices[64];
+} MaskResult;
+
+
+static uint64_t randomMask(uint32_t * seed, uint8_t sixteenths)
+{
+  uint64_t mask = 0;
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    *seed = *seed * 1103515245u + 12345u;
+    if(((*seed >> 16) & 15) < sixteenths) mask |= (uint64_t) 1 << ii;
+  }
+  return mask;
+}
+
+
+// as the sketches did: two 32 bit halves, every bit tested
+static __attribute__((noinline)) void loopVersion(uint64_t mask, MaskResult * out)
+{
+  uint32_t alertPixels[2] = {(uint32_t) mask, (uint32_t) (mask >> 32)};
+  out->count = 0;
+  out->sumX = out->sumY = 0;
+  for(uint8_t i = 0; i < 32; i++) {
+    if(alertPixels[0] & ((uint32_t) 1 << i)) {
+      out->indices[out->count++] = i;
+      out->sumX += i % 8;
+      out->sumY += i / 8;
+    }
+  }
+  for(uint8_t i = 0; i < 32; i++) {
+    if(alertPixels[1] & ((uint32_t) 1 << i)) {
+      out->indices[out->count++] = 32 + i;
+      out->sumX += (32 + i) % 8;
+      out->sumY += (32 + i) / 8;
+    }
+  }
+}
+
+
+static __attribute__((noinline)) void maskVersion(uint64_t mask, MaskResult * out)
+{
+  PAF9701_MaskMoments m;
+  maskMoments(mask, &m);
+  out->count = m.count;
+  out->sumX = m.sumX;
+  out->sumY = m.sumY;
+  uint8_t n = 0;
+  while(mask) out->indices[n++] = maskPop(&mask);
+}
+
+
+// per pixel reference for every helper, returns the number of disagreements
+static uint32_t check(uint64_t mask)
+{
+  uint32_t wrong = 0;
+  PAF9701_MaskMoments m, r = {0, 0, 0, 0, 0, 0};
+  uint8_t rows[8] = {0}, columns[8] = {0}, rowCounts[8], columnCounts[8], rowBits = 0, columnBits = 0;
+  for(uint8_t y = 0; y < 8; y++) {
+    for(uint8_t x = 0; x < 8; x++) {
+      if(!maskTest(mask, x, y)) continue;
+      r.count++;
+      r.sumX += x; r.sumY += y;
+      r.sumXX += x * x; r.sumYY += y * y; r.sumXY += x * y;
+      rows[y]++; columns[x]++;
+      rowBits |= 1 << y; columnBits |= 1 << x;
+    }
+  }
+  maskMoments(mask, &m);
+  if(m.count != r.count || m.sumX != r.sumX || m.sumY != r.sumY || m.sumXX != r.sumXX || m.sumYY != r.sumYY || m.sumXY != r.sumXY) wrong++;
+  maskRowCounts(mask, rowCounts);
+  maskColumnCounts(mask, columnCounts);
+  for(uint8_t ii = 0; ii < 8; ii++) if(rowCounts[ii] != rows[ii] || columnCounts[ii] != columns[ii]) wrong++;
+  if(maskRows(mask) != rowBits || maskColumns(mask) != columnBits) wrong++;
+  for(int8_t dy = -8; dy <= 8; dy++) {
+    for(int8_t dx = -8; dx <= 8; dx++) {
+      uint64_t shifted = 0;
+      for(int8_t y = 0; y < 8; y++) {
+        for(int8_t x = 0; x < 8; x++) {
+          int8_t sx = x - dx, sy = y - dy;
+          if(sx >= 0 && sx < 8 && sy >= 0 && sy < 8 && maskTest(mask, sx, sy)) shifted |= maskPixel(x, y);
+        }
+      }
+      if(maskShift(mask, dx, dy) != shifted) wrong++;
+    }
+  }
+  // morphology, pixels beyond the edge count as set for erosion
+  uint64_t dilate4 = 0, dilate8 = 0, erode4 = 0, erode8 = 0, despeckle = 0;
+  for(int8_t y = 0; y < 8; y++) {
+    for(int8_t x = 0; x < 8; x++) {
+      bool any4 = false, any8 = false, all4 = true, all8 = true, neighbour = false;
+      for(int8_t dy = -1; dy <= 1; dy++) {
+        for(int8_t dx = -1; dx <= 1; dx++) {
+          bool inside = x + dx >= 0 && x + dx < 8 && y + dy >= 0 && y + dy < 8;
+          bool set = inside ? maskTest(mask, x + dx, y + dy) : false;
+          bool cross = dx == 0 || dy == 0;
+          any8 |= set;
+          if(cross) any4 |= set;
+          if(inside && !set) {
+            all8 = false;
+            if(cross) all4 = false;
+          }
+          if((dx || dy) && set) neighbour = true;
+        }
+      }
+      if(any4) dilate4 |= maskPixel(x, y);
+      if(any8) dilate8 |= maskPixel(x, y);
+      if(all4) erode4 |= maskPixel(x, y);
+      if(all8) erode8 |= maskPixel(x, y);
+      if(neighbour && maskTest(mask, x, y)) despeckle |= maskPixel(x, y);
+    }
+  }
+  if(maskDilate4(mask) != dilate4 || maskDilate8(mask) != dilate8 || maskErode4(mask) != erode4 || maskErode8(mask) != erode8) wrong++;
+  if(maskDespeckle(mask) != despeckle) wrong++;
+  // holes: background the edge cannot reach through 4-connected background, by flood fill
+  uint8_t stack[64], top = 0;
+  uint64_t reached = 0;
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    uint8_t x = ii & 7, y = ii >> 3;
+    if((x == 0 || x == 7 || y == 0 || y == 7) && !(mask >> ii & 1)) {
+      reached |= (uint64_t) 1 << ii;
+      stack[top++] = ii;
+    }
+  }
+  while(top) {
+    uint8_t ii = stack[--top], x = ii & 7, y = ii >> 3;
+    const int8_t steps[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    for(uint8_t s = 0; s < 4; s++) {
+      int8_t nx = x + steps[s][0], ny = y + steps[s][1];
+      if(nx < 0 || nx > 7 || ny < 0 || ny > 7) continue;
+      uint8_t n = ny * 8 + nx;
+      if((mask >> n & 1) || (reached >> n & 1)) continue;
+      reached |= (uint64_t) 1 << n;
+      stack[top++] = n;
+    }
+  }
+  if(maskFillHoles(mask) != ~reached) wrong++;
+  return wrong;
+}
+
+
+static uint8_t random8(uint32_t * seed)
+{
+  *seed = *seed * 1103515245u + 12345u;
+  return (*seed >> 16) & 0xFF;
+}
+
+
+static bool centroid(uint64_t mask, float * x, float * y)
+{
+  PAF9701_MaskMoments m;
+  maskMoments(mask, &m);
+  if(m.count == 0) return false;
+  *x = (float) m.sumX / m.count;
+  *y = (float) m.sumY / m.count;
+  return true;
+}
+
+
+static void track(const char * name, uint8_t steps)
+{
+  uint32_t seed = 7;
+  std::vector<uint64_t> noisy(TRACK);
+  double error = 0;
+  float jump = 0, lastX = 0, lastY = 0, lastCleanX = 0, lastCleanY = 0;
+  uint32_t frames = 0, lost = 0;
+  bool have = false;
+  for(uint32_t n = 0; n < TRACK; n++) {
+    float cx = 3.5f + 2.5f * sinf(n * 0.031f), cy = 3.5f + 2.5f * cosf(n * 0.023f);
+    uint64_t clean = 0, mask = 0;
+    for(uint8_t ii = 0; ii < 64; ii++) {
+      float dx = (ii & 7) - cx, dy = (ii >> 3) - cy;
+      bool object = dx * dx + dy * dy <= 1.6f * 1.6f;
+      if(object) clean |= (uint64_t) 1 << ii;
+      if(object ? random8(&seed) >= DROPOUT : random8(&seed) < SPECKLE) mask |= (uint64_t) 1 << ii;
+    }
+    noisy[n] = mask;
+    float x, y, ex = 0, ey = 0;
+    centroid(clean, &ex, &ey);
+    frames++;
+    if(!centroid(maskFilter(mask, steps), &x, &y)) {
+      lost++;
+      have = false;
+      continue;
+    }
+    error += (x - ex) * (x - ex) + (y - ey) * (y - ey);
+    if(have) {
+      float d = hypotf((x - lastX) - (ex - lastCleanX), (y - lastY) - (ey - lastCleanY));
+      if(d > jump) jump = d;
+    }
+    lastX = x; lastY = y; lastCleanX = ex; lastCleanY = ey;
+    have = true;
+  }
+
+  volatile uint64_t sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for(int r = 0; r < REPEAT / 10; r++) {
+    for(uint32_t n = 0; n < TRACK; n++) sink += maskFilter(noisy[n], steps);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / ((double) (REPEAT / 10) * TRACK);
+  printf("%-24s  %7.3f  %8.2f  %5u  %9.1f\n", name, sqrt(error / (frames - lost)), jump, lost, ns);
+}
+
+
+int main()
+{
+  static const uint8_t densities[] = {1, 4, 8, 12};   // sixteenths of the pixels set
+  uint32_t seed = 1;
+  printf("%u random masks per density, ns per mask for count, centroid sums and index list\n\n", MASKS);
+  printf("set pixels  check errors   loops ns  bitboard ns  speedup\n");
+  for(uint8_t dd = 0; dd < sizeof(densities); dd++) {
+    std::vector<uint64_t> masks(MASKS);
+    uint32_t wrong = 0;
+    for(size_t n = 0; n < masks.size(); n++) {
+      masks[n] = randomMask(&seed, densities[dd]);
+      wrong += check(masks[n]);
+      MaskResult a, b;
+      loopVersion(masks[n], &a);
+      maskVersion(masks[n], &b);
+      if(a.count != b.count || a.sumX != b.sumX || a.sumY != b.sumY) wrong++;
+      for(uint8_t ii = 0; ii < a.count; ii++) if(a.indices[ii] != b.indices[ii]) wrong++;
+    }
+
+    volatile uint32_t sink = 0;
+    MaskResult result;
+    auto t0 = std::chrono::steady_clock::now();
+    for(int r = 0; r < REPEAT; r++) {
+      for(size_t n = 0; n < masks.size(); n++) {
+        loopVersion(masks[n], &result);
+        sink += result.sumX + result.indices[0];
+      }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for(int r = 0; r < REPEAT; r++) {
+      for(size_t n = 0; n < masks.size(); n++) {
+        maskVersion(masks[n], &result);
+        sink += result.sumX + result.indices[0];
+      }
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double count = (double) REPEAT * masks.size();
+    double loopNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / count;
+    double maskNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / count;
+    printf("%7u/16  %12u  %9.1f  %11.1f  %6.2fx\n", densities[dd], wrong, loopNs, maskNs, loopNs / maskNs);
+  }
+
+  printf("\ntracking, %u frames, speckle %.1f%%, dropout %.1f%%\n\n", TRACK, SPECKLE * 100.0 / 256, DROPOUT * 100.0 / 256);
+  printf("filter                     rms px  jump px   lost  filter ns\n");
+  track("none", 0);
+  track("despeckle", maskDespeckleStep);
+  track("open, 4", maskOpenStep);
+  track("open, 8", maskOpenStep | maskConnect8);
+  track("close, 4", maskCloseStep);
+  track("despeckle + fill", maskDespeckleStep | maskFillStep);
+  track("despeckle + close + fill", maskDespeckleStep | maskCloseStep | maskFillStep);
+  track("open + fill, 4", maskOpenStep | maskFillStep);
+  return 0;
+}
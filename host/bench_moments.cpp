@@ -0,0 +1,193 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host benchmark of frameMoments() (PAF9701Frame.h): the fixed-point, temperature weighted
+ *  centroid, second moments, axis angle and elongation against a double precision reference,
+ *  and what the sub-pixel centroid does for swipe detection.
+ *
+ *  Accuracy: random frames with one warm elliptical object of random size, angle and position
+ *  on a 24 C background with 0.1 C noise, weighted above 25 C over the frameThreshold() mask at
+ *  27 C. It reports the largest centroid, moment, angle (objects with elongation above 0.3)
+ *  and elongation errors, and the time per frame of both versions.
+ *
+ *  Swipes: a hand (8 C above background, 1 pixel sigma) moves right from column 1.5 at several
+ *  speeds. The old sketch rule takes the integer average of the alert pixel columns and fires
+ *  when it has moved by more than 1 pixel; the new one takes the Q8 weighted centroid and fires
+ *  at more than SWIPE_Q8. It reports the frames from the start of the motion to the swipe, and
+ *  how often each rule fires on a hand that holds still.
+ *
+ *  g++ -O2 -I../PAF9701_GestureDetection_Ladybug bench_moments.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701Frame.cpp -o bench_moments
+ *  ./bench_moments
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "PAF9701Frame.h"
+
+#define FRAMES    4096
+#define REPEAT     100
+#define SWIPE_Q8   128   // half a pixel
+#define STILL     2000   // frames of a hand holding still
+
+typedef struct {
+  int16_t  pixels[64];
+  uint64_t mask;
+} TestFrame;
+
+typedef struct {
+  double x, y, xx, yy, xy, angle, elongation;
+} Reference;
+
+
+static float gauss(uint32_t * seed)
+{
+  float sum = 0;
+  for(uint8_t ii = 0; ii < 12; ii++) {
+    *seed = *seed * 1103515245u + 12345u;
+    sum += ((*seed >> 16) & 0x7FFF) / 32768.0f;
+  }
+  return sum - 6.0f;
+}
+
+
+static void makeFrame(TestFrame * frame, float cx, float cy, float sx, float sy, float angle, float heat, uint32_t * seed)
+{
+  float c = cosf(angle), s = sinf(angle);
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    float dx = (ii & 7) - cx, dy = (ii >> 3) - cy;
+    float u = c * dx + s * dy, v = -s * dx + c * dy;
+    float t = 24.0f + heat * expf(-0.5f * (u * u / (sx * sx) + v * v / (sy * sy))) + 0.1f * gauss(seed);
+    frame->pixels[ii] = (int16_t) lrintf(t * 16.0f);
+  }
+  frame->mask = frameThreshold(frame->pixels, PAF9701_TO_RAW(27));
+}
+
+
+static __attribute__((noinline)) void reference(const int16_t * pixels, uint64_t mask, int16_t base, Reference * r)
+{
+  double w = 0, sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    if(!(mask >> ii & 1) || pixels[ii] <= base) continue;
+    double wi = pixels[ii] - base, x = ii & 7, y = ii >> 3;
+    w += wi; sx += wi * x; sy += wi * y; sxx += wi * x * x; syy += wi * y * y; sxy += wi * x * y;
+  }
+  r->x = sx / w;
+  r->y = sy / w;
+  r->xx = sxx / w - r->x * r->x;
+  r->yy = syy / w - r->y * r->y;
+  r->xy = sxy / w - r->x * r->y;
+  double d = sqrt((r->xx - r->yy) * (r->xx - r->yy) + 4 * r->xy * r->xy);
+  r->angle = 0.5 * atan2(2 * r->xy, r->xx - r->yy) * 180 / M_PI;
+  r->elongation = r->xx + r->yy + d > 0 ? 2 * d / (r->xx + r->yy + d) : 0;
+}
+
+
+static int16_t oldCentroidX(uint64_t mask)   // the sketch before: integer average of the alert pixel columns
+{
+  uint16_t sum = 0, count = 0;
+  for(uint8_t i = 0; i < 64; i++) if(mask & ((uint64_t) 1 << i)) { sum += i % 8; count++; }
+  return count ? sum / count : -1;
+}
+
+
+int main()
+{
+  uint32_t seed = 5;
+  std::vector<TestFrame> frames(FRAMES);
+  int16_t base = PAF9701_TO_RAW(25);
+  for(size_t n = 0; n < frames.size(); n++) {
+    float cx = 1.5f + (seed % 500) / 100.0f;
+    float cy = 1.5f + gauss(&seed) * 0.5f + 2.0f;
+    float sx = 0.7f + fabsf(gauss(&seed)) * 0.5f, sy = 0.5f + fabsf(gauss(&seed)) * 0.3f;
+    makeFrame(&frames[n], cx, cy, sx, sy, gauss(&seed), 6.0f + fabsf(gauss(&seed)) * 3.0f, &seed);
+  }
+
+  double centroidError = 0, momentError = 0, angleError = 0, elongationError = 0;
+  uint32_t used = 0;
+  for(size_t n = 0; n < frames.size(); n++) {
+    PAF9701_Moments m;
+    Reference r;
+    if(frameMoments(frames[n].pixels, frames[n].mask, base, &m) < 2) continue;
+    reference(frames[n].pixels, frames[n].mask, base, &r);
+    used++;
+    centroidError = fmax(centroidError, fmax(fabs(m.x / 256.0 - r.x), fabs(m.y / 256.0 - r.y)));
+    momentError = fmax(momentError, fmax(fabs(m.xx / 256.0 - r.xx), fmax(fabs(m.yy / 256.0 - r.yy), fabs(m.xy / 256.0 - r.xy))));
+    elongationError = fmax(elongationError, fabs(m.elongation / 256.0 - r.elongation));
+    if(r.elongation > 0.3) {
+      double d = fabs(m.angle / 256.0 - r.angle);
+      if(d > 90) d = 180 - d;          // -90 and 90 are the same axis
+      angleError = fmax(angleError, d);
+    }
+  }
+
+  volatile uint32_t sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for(int rr = 0; rr < REPEAT; rr++) {
+    for(size_t n = 0; n < frames.size(); n++) {
+      Reference r;
+      reference(frames[n].pixels, frames[n].mask, base, &r);
+      sink += (uint32_t) (r.x * 256);
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for(int rr = 0; rr < REPEAT; rr++) {
+    for(size_t n = 0; n < frames.size(); n++) {
+      PAF9701_Moments m;
+      frameMoments(frames[n].pixels, frames[n].mask, base, &m);
+      sink += m.x;
+    }
+  }
+  auto t2 = std::chrono::steady_clock::now();
+  double count = (double) REPEAT * frames.size();
+  printf("%u frames with an object, 0.1 C noise, weights above 25 C\n\n", used);
+  printf("max error: centroid %.4f px, moments %.4f px^2, angle %.2f deg, elongation %.4f\n", centroidError, momentError, angleError, elongationError);
+  printf("double reference %7.1f ns/frame, fixed point %7.1f ns/frame on this host\n",
+         std::chrono::duration<double, std::nano>(t1 - t0).count() / count, std::chrono::duration<double, std::nano>(t2 - t1).count() / count);
+
+  printf("\nswipe right from column 1.5, frames from the start of the motion to the swipe\n\n");
+  printf("px/frame  integer rule  Q8 rule\n");
+  static const float speeds[] = {0.05f, 0.1f, 0.25f, 0.5f, 1.0f};
+  for(uint8_t ss = 0; ss < sizeof(speeds) / sizeof(speeds[0]); ss++) {
+    TestFrame frame;
+    makeFrame(&frame, 1.5f, 3.5f, 1.0f, 1.0f, 0, 8.0f, &seed);
+    int16_t startOld = oldCentroidX(frame.mask);
+    PAF9701_Moments m;
+    frameMoments(frame.pixels, frame.mask, base, &m);
+    int32_t startNew = m.x;
+    int32_t firedOld = -1, firedNew = -1;
+    for(int32_t n = 1; n < 200 && (firedOld < 0 || firedNew < 0); n++) {
+      float cx = 1.5f + speeds[ss] * n;
+      if(cx > 6.5f) break;
+      makeFrame(&frame, cx, 3.5f, 1.0f, 1.0f, 0, 8.0f, &seed);
+      if(firedOld < 0 && oldCentroidX(frame.mask) - startOld > 1) firedOld = n;
+      frameMoments(frame.pixels, frame.mask, base, &m);
+      if(firedNew < 0 && (int32_t) m.x - startNew > SWIPE_Q8) firedNew = n;
+    }
+    printf("%8.2f  %12d  %7d\n", speeds[ss], firedOld, firedNew);
+  }
+
+  uint32_t falseOld = 0, falseNew = 0;
+  TestFrame frame;
+  makeFrame(&frame, 3.3f, 3.5f, 1.0f, 1.0f, 0, 8.0f, &seed);
+  int16_t lastOld = oldCentroidX(frame.mask);
+  PAF9701_Moments m;
+  frameMoments(frame.pixels, frame.mask, base, &m);
+  int32_t lastNew = m.x;
+  for(uint32_t n = 0; n < STILL; n++) {
+    makeFrame(&frame, 3.3f, 3.5f, 1.0f, 1.0f, 0, 8.0f, &seed);
+    int16_t xOld = oldCentroidX(frame.mask);
+    frameMoments(frame.pixels, frame.mask, base, &m);
+    if(abs(xOld - lastOld) > 1) falseOld++;
+    if(abs((int32_t) m.x - lastNew) > SWIPE_Q8) falseNew++;
+    lastOld = xOld;
+    lastNew = m.x;
+  }
+  printf("\nhand holding still, %u frames: integer rule fired %u times, Q8 rule %u times\n", STILL, falseOld, falseNew);
+  return 0;
+}
@@ -0,0 +1,105 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host run of one-shot capture (PAF9701::triggerOneShot() / awaitFrame()) against a free
+ *  running sensor, on the model in PAF9701Sim.h and a 400 kHz simulated bus.
+ *
+ *  The application wants one frame every few seconds. Free running, the sensor converts at the
+ *  configured rate (10 Hz or 1 Hz) and the sketch reads the newest frame on schedule; one-shot,
+ *  the sketch triggers a single conversion on schedule and waits for it, either polling the
+ *  status after the conversion time or on the INT edge. For each it reports frames converted
+ *  per hour (which stands in for the average current), bus transfers and bytes per hour and the
+ *  delay from the request to a frame. All time is virtual, so the numbers are the same on every
+ *  run.
+ *
+ *  g++ -O2 -I. -I../PAF9701_GestureDetection_Ladybug bench_one_shot.cpp Arduino.cpp Wire.cpp SimBus.cpp PAF9701Sim.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701FrameRing.cpp ../PAF9701_GestureDetection_Ladybug/I2Cdev.cpp -o bench_one_shot
+ *  ./bench_one_shot [minutes]
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "PAF9701Sim.h"
+
+#define INT_PIN      8
+#define TIMEOUT_MS 500
+
+enum {freeRunning, oneShotPoll, oneShotInt};
+static const char * const modeNames[] = {"free running", "one-shot, poll", "one-shot, INT"};
+
+static volatile bool intFlag = false;
+static void intHandler() { intFlag = true; }
+
+
+static void run(uint8_t mode, uint32_t rateHz, uint32_t intervalMs, uint32_t minutes)
+{
+  SimBus bus(400000);
+  PAF9701Sim sensor(PAF9701_ADDRESS, INT_PIN);
+  bus.attach(&sensor);
+  simAttach(&sensor);
+  Wire.setAdapter(&bus);
+  I2Cdev i2c(&Wire);
+  PAF9701 paf(&i2c);
+  intFlag = false;
+
+  paf.coldReset();
+  while(!(paf.getStatus() & 0x20)) {}
+  paf.initNormalMode(normal_mode, 200000 / (256 * rateHz), true);
+  paf.setAlertMode(frameUpdateAlert, frameUpdateAlert);
+  paf.setSnapshotRead(2);
+  paf.clearInterrupt();
+  if(mode == freeRunning) paf.resumeOperation();
+  else paf.beginOneShot();
+  if(mode == oneShotInt) attachInterrupt(INT_PIN, intHandler, FALLING);
+
+  PAF9701_Frame frame;
+  uint64_t start = simNow(), length = (uint64_t) minutes * 60000000000ULL;
+  uint32_t startFrames = sensor.framesPublished(), captures = 0, failed = 0;
+  uint64_t latencyTotal = 0, latencyMax = 0;
+  bus.resetStats();
+  for(uint64_t next = start; next < start + length; next += (uint64_t) intervalMs * 1000000ULL) {
+    if(simNow() < next) simAdvance(next - simNow());   // asleep until the next capture
+    uint64_t request = simNow();
+    bool ok;
+    if(mode == freeRunning) ok = paf.readFrame(&frame);
+    else {
+      paf.triggerOneShot();
+      ok = paf.awaitFrame(&frame, TIMEOUT_MS, mode == oneShotInt ? &intFlag : NULL);
+    }
+    if(!ok) failed++;
+    uint64_t latency = simNow() - request;
+    latencyTotal += latency;
+    if(latency > latencyMax) latencyMax = latency;
+    captures++;
+  }
+  if(simNow() < start + length) simAdvance(start + length - simNow());
+
+  SimBusStats stats;
+  bus.getStats(&stats);
+  double hours = minutes / 60.0;
+  printf("%-15s  %4u  %8.1f  %9.0f  %9.0f  %10.0f  %7.2f  %7.2f  %6u\n", modeNames[mode], rateHz, intervalMs / 1000.0,
+         (sensor.framesPublished() - startFrames) / hours, stats.transfers / hours, stats.bytes / hours,
+         latencyTotal / 1e6 / captures, latencyMax / 1e6, failed);
+
+  if(mode == oneShotInt) detachInterrupt(INT_PIN);
+  simDetach(&sensor);
+  Wire.setAdapter(NULL);
+}
+
+
+int main(int argc, char ** argv)
+{
+  uint32_t minutes = argc > 1 ? atoi(argv[1]) : 10;
+  static const uint32_t intervals[] = {1000, 10000, 60000};
+  static const uint32_t rates[] = {10, 1};
+  printf("%u min per run, balanced profile, latency in ms from the request to a frame\n\n", minutes);
+  printf("mode               Hz   every s   frames/h   xfers/h     bytes/h  lat avg  lat max  failed\n");
+  for(uint8_t rr = 0; rr < 2; rr++) {
+    for(uint8_t ii = 0; ii < 3; ii++) {
+      for(uint8_t mode = freeRunning; mode <= oneShotInt; mode++) run(mode, rates[rr], intervals[ii], minutes);
+    }
+  }
+  return 0;
+}
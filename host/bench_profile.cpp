@@ -0,0 +1,149 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host run of the acquisition profiles (see PAF9701::setProfile()) against the model in
+ *  PAF9701Sim.h on a 400 kHz simulated bus.
+ *
+ *  For each profile it asks for its own maximum rate, for 5 Hz and for 20 Hz, and reports
+ *  whether the driver accepted the rate, the frame period the model then runs at, the delay
+ *  from a step in the scene to the first frame read that shows it, and the temporal noise of a
+ *  flat 24 C background. The step is a 34 C 3 x 3 pixel object that comes and goes every
+ *  1.03 s; frames are read with readFrame() on the INT edge. The model takes the scene at the
+ *  end of each conversion and its pixel noise is 100 mK rms at 2^9 To samples, falling with the
+ *  square root of the To samples, so the noise column is an estimate scaled from that figure.
+ *  All time is virtual, so the numbers are the same on every run.
+ *
+ *  g++ -O2 -I. -I../PAF9701_GestureDetection_Ladybug bench_profile.cpp Arduino.cpp Wire.cpp SimBus.cpp PAF9701Sim.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701FrameRing.cpp ../PAF9701_GestureDetection_Ladybug/I2Cdev.cpp -o bench_profile
+ *  ./bench_profile [seconds]
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "PAF9701Sim.h"
+
+#define INT_PIN     8
+#define STEP_NS     1030000000ULL   // object comes or goes
+#define NOISE_MK    100
+
+static const char * const profileNames[] = {"low latency", "balanced", "low noise"};
+
+static volatile bool intFlag = false;
+static void intHandler() { intFlag = true; }
+static uint64_t sceneStart;
+
+
+static bool objectPresent(uint64_t now)
+{
+  return now >= sceneStart && ((now - sceneStart) / STEP_NS) & 1;
+}
+
+
+static void stepScene(void * context, uint64_t now, int16_t * pixels, int16_t * ambient)
+{
+  (void) context;
+  for(uint8_t ii = 0; ii < 64; ii++) pixels[ii] = 24 * 16;
+  if(objectPresent(now)) {
+    for(uint8_t y = 2; y < 5; y++) for(uint8_t x = 3; x < 6; x++) pixels[y * 8 + x] = 34 * 16;
+  }
+  *ambient = 25 * 16;
+}
+
+
+static void run(uint8_t profile, uint32_t rateHz, uint32_t seconds)
+{
+  SimBus bus(400000);
+  PAF9701Sim sensor(PAF9701_ADDRESS, INT_PIN);
+  sensor.setScene(stepScene, NULL);
+  sensor.setNoise(NOISE_MK);
+  bus.attach(&sensor);
+  simAttach(&sensor);
+  Wire.setAdapter(&bus);
+  I2Cdev i2c(&Wire);
+  PAF9701 paf(&i2c);
+  intFlag = false;
+
+  paf.coldReset();
+  while(!(paf.getStatus() & 0x20)) {}
+  uint32_t sampleRate = rateHz ? 200000 / (256 * rateHz) : paf.minFramePeriod(profile);
+  bool accepted = paf.initNormalMode(normal_mode, sampleRate, true, profile);
+  paf.setAlertMode(frameUpdateAlert, frameUpdateAlert);
+  paf.setSnapshotRead(2);
+  attachInterrupt(INT_PIN, intHandler, FALLING);
+  paf.clearInterrupt();
+  paf.resumeOperation();
+
+  PAF9701_Frame frame;
+  double sum[64], squares[64];
+  for(uint8_t ii = 0; ii < 64; ii++) sum[ii] = squares[ii] = 0;
+  uint32_t frames = 0, steps = 0;
+  uint64_t stepTotal = 0, stepMax = 0, pendingStep = 0;
+  bool shown = false;
+  sceneStart = simNow();
+  uint64_t end = sceneStart + (uint64_t) seconds * 1000000000ULL;
+  while(simNow() < end) {
+    if(!intFlag) {
+      simAdvance(10000);      // idle until the INT edge
+      continue;
+    }
+    intFlag = false;
+    paf.readFrame(&frame);
+    frames++;
+    int32_t block = 0;
+    for(uint8_t y = 2; y < 5; y++) for(uint8_t x = 3; x < 6; x++) block += frame.pixels[y * 8 + x];
+    bool present = block > 9 * 29 * 16;
+    uint64_t lastStep = sceneStart + (simNow() - sceneStart) / STEP_NS * STEP_NS;
+    if(lastStep > sceneStart && lastStep != pendingStep) {   // a step not yet seen
+      pendingStep = lastStep;
+      shown = false;
+    }
+    if(pendingStep && !shown && present == objectPresent(pendingStep)) {
+      uint64_t delay = simNow() - pendingStep;
+      stepTotal += delay;
+      if(delay > stepMax) stepMax = delay;
+      steps++;
+      shown = true;
+    }
+    for(uint8_t ii = 0; ii < 64; ii++) {
+      if(ii >= 16 && ii < 40) continue;            // rows 2 - 4 hold the object
+      sum[ii] += frame.pixels[ii];
+      squares[ii] += (double) frame.pixels[ii] * frame.pixels[ii];
+    }
+  }
+
+  double variance = 0;
+  uint8_t pixels = 0;
+  for(uint8_t ii = 0; ii < 64; ii++) {
+    if(ii >= 16 && ii < 40) continue;
+    double mean = sum[ii] / frames;
+    variance += squares[ii] / frames - mean * mean;
+    pixels++;
+  }
+  char requested[16];
+  if(rateHz) snprintf(requested, sizeof(requested), "%u Hz", rateHz);
+  else snprintf(requested, sizeof(requested), "max");
+  printf("%-11s  %9s  %-8s  %7.2f  %7.2f  %8.1f  %8.1f  %8.1f  %5.0f\n", profileNames[profile], requested, accepted ? "yes" : "raised",
+         PAF9701_CONVERSION_US(sensor.reg(0, PAF9701_BURST_NUM_SEL)) / 1000.0, seconds * 1000.0 / frames,
+         (double) frames / seconds, steps ? stepTotal / 1e6 / steps : 0.0, stepMax / 1e6,
+         sqrt(variance / pixels) * 62.5);
+
+  detachInterrupt(INT_PIN);
+  simDetach(&sensor);
+  Wire.setAdapter(NULL);
+}
+
+
+int main(int argc, char ** argv)
+{
+  uint32_t seconds = argc > 1 ? atoi(argv[1]) : 30;
+  static const uint32_t rates[] = {0, 5, 20};
+  printf("%u s per run, %u mK rms pixel noise at 2^9 To samples, times in ms\n\n", seconds, NOISE_MK);
+  printf("profile      requested  rate ok   convert    frame       fps  step avg  step max  noise mK\n");
+  for(uint8_t profile = lowLatencyProfile; profile <= lowNoiseProfile; profile++) {
+    for(uint8_t rr = 0; rr < 3; rr++) run(profile, rates[rr], seconds);
+  }
+  return 0;
+}
@@ -0,0 +1,164 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host run of the fast resume path (PAF9701::beginConfig() / fastResume()) against re-running
+ *  the whole configuration, on the model in PAF9701Sim.h and a 400 kHz simulated bus.
+ *
+ *  The sensor is configured as in the GestureDetection sketch (init, filter, emissivity,
+ *  orientation, alert mode and limits) and suspended, then the MCU "restarts" in one of these
+ *  ways and brings it back to the first frame:
+ *    full init            new driver object (watchdog reset), the whole sequence written again
+ *    resume, intact       new driver object, registers as configured
+ *    resume, 1 lost       new driver object, one register changed behind its back
+ *    resume, sensor reset new driver object, the sensor was cold reset (power glitch)
+ *    resume, STOP wake    same driver object (RAM kept), registers as configured
+ *  For each it reports bus transactions, bytes and time up to resumeOperation(), registers
+ *  rewritten, whether the digests matched, and the time to the first frame. Last it checks that
+ *  suspendOperation(), clearInterrupt() and resumeOperation() made while staging reach the
+ *  sensor only after the rewrites; the exit status is 1 if not. All time is virtual.
+ *
+ *  g++ -O2 -I. -I../PAF9701_GestureDetection_Ladybug bench_resume.cpp Arduino.cpp Wire.cpp SimBus.cpp PAF9701Sim.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701FrameRing.cpp ../PAF9701_GestureDetection_Ladybug/I2Cdev.cpp -o bench_resume
+ *  ./bench_resume
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "PAF9701Sim.h"
+
+enum {fullInit, resumeIntact, resumeLost, resumeReset, resumeStop};
+static const char * const scenarioNames[] = {"full init", "resume, intact", "resume, 1 lost", "resume, sensor reset", "resume, STOP wake"};
+
+
+static void configure(PAF9701 * paf)
+{
+  paf->initNormalMode(normal_mode, 78, false);
+  paf->setFilter(movingAverage, fourFrames, frames0_1);
+  paf->setEmissivity(0.98f);
+  paf->imageOrientation(flipandmirror, orient0);
+  paf->setAlertMode(absValueAlert, absValueAlert);
+  paf->setNormalAlertLimits(0, 80, 2, 40, 60, 2, 1);
+  paf->setDet123AlertLimits(0, 80, 2, 40, 60, 2, 1);
+}
+
+
+static void run(uint8_t scenario)
+{
+  SimBus bus(400000);
+  PAF9701Sim sensor(PAF9701_ADDRESS);
+  bus.attach(&sensor);
+  simAttach(&sensor);
+  Wire.setAdapter(&bus);
+  I2Cdev i2c(&Wire);
+  PAF9701 * paf = new PAF9701(&i2c);
+
+  paf->coldReset();                      // first power-up
+  while(!(paf->getStatus() & 0x20)) {}
+  configure(paf);
+  paf->suspendOperation();
+
+  if(scenario != resumeStop) {           // the MCU restarts, the shadow is gone
+    delete paf;
+    paf = new PAF9701(&i2c);
+  }
+  if(scenario == resumeLost) {           // one register changed behind the driver's back
+    i2c.writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x01);
+    i2c.writeByte(PAF9701_ADDRESS, PAF9701_FILTER_SEL, 0x00);
+  }
+  if(scenario == resumeReset) {          // the sensor lost power
+    i2c.writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x00);
+    i2c.writeByte(PAF9701_ADDRESS, PAF9701_HOST_RSTB, 0x5A);
+    while(!(sensor.reg(0, PAF9701_STATUS_FLAG) & 0x20)) simAdvance(100000);
+  }
+
+  bus.resetStats();
+  uint64_t start = simNow();
+  PAF9701_ResumeStats resume;
+  bool resumed = scenario != fullInit;
+  if(resumed) {
+    paf->beginConfig();
+    configure(paf);
+    paf->fastResume(&resume);
+  }
+  else configure(paf);
+  paf->clearInterrupt();
+  paf->resumeOperation();
+  SimBusStats stats;
+  bus.getStats(&stats);
+  uint64_t configured = simNow() - start;
+  while(!(paf->getStatus() & 0x10)) delay(1);
+  uint64_t firstFrame = simNow() - start;
+
+  // the sensor must now hold the configuration: compare with a fresh full init on a second model
+  SimBus refBus(400000);
+  PAF9701Sim reference(PAF9701_ADDRESS);
+  refBus.attach(&reference);
+  simAttach(&reference);
+  Wire.setAdapter(&refBus);
+  PAF9701 refPaf(&i2c);
+  refPaf.coldReset();
+  while(!(refPaf.getStatus() & 0x20)) simAdvance(100000);
+  configure(&refPaf);
+  uint8_t wrong = 0;
+  static const uint8_t banks[] = {0, 1, 3, 4};
+  for(uint8_t bb = 0; bb < 4; bb++) {
+    for(uint8_t reg = 0x0C; reg < 0x80; reg++) {
+      if(banks[bb] == 0 && (reg == PAF9701_HOST_RSTB || reg == PAF9701_BANK_SELECT || reg == PAF9701_OUTPUT_ENABLE)) continue;
+      if(banks[bb] == 4 && reg < 0x48) continue;     // pixel data and alert flags
+      if(sensor.reg(banks[bb], reg) != reference.reg(banks[bb], reg)) wrong++;
+    }
+  }
+
+  char rewritten[8] = "-";
+  if(resumed) snprintf(rewritten, sizeof(rewritten), "%u", resume.rewritten);
+  printf("%-20s  %6u  %6u  %7.2f  %9s  %7s  %9.1f  %5u\n", scenarioNames[scenario], stats.transfers, stats.bytes, configured / 1e6, rewritten,
+         resumed ? (resume.sensorDigest == resume.expectedDigest ? "yes" : "no") : "-", firstFrame / 1e6, wrong);
+
+  delete paf;
+  simDetach(&reference);
+  simDetach(&sensor);
+  Wire.setAdapter(NULL);
+}
+
+
+// suspendOperation() and resumeOperation() while staging must reach the sensor after the
+// configuration: the sensor was reset, so output enabled before the rewrites runs on defaults
+static bool stagedOrder()
+{
+  SimBus bus(400000);
+  PAF9701Sim sensor(PAF9701_ADDRESS);
+  bus.attach(&sensor);
+  simAttach(&sensor);
+  Wire.setAdapter(&bus);
+  I2Cdev i2c(&Wire);
+  PAF9701 paf(&i2c);
+  paf.coldReset();
+  while(!(paf.getStatus() & 0x20)) delay(1);
+
+  PAF9701_ResumeStats resume;
+  paf.beginConfig();
+  paf.suspendOperation();
+  configure(&paf);
+  paf.clearInterrupt();
+  paf.resumeOperation();
+  bool held = !(sensor.reg(0, PAF9701_OUTPUT_ENABLE) & 0x01);
+  paf.fastResume(&resume);
+  bool sent = (sensor.reg(0, PAF9701_OUTPUT_ENABLE) & 0x01) && resume.deferred >= 3;   // ALERT_MODE is not shadowed either
+  printf("\nlive writes while staging: %u held until fastResume(), %s\n", resume.deferred, held && sent ? "in order after the rewrites" : "WRONG");
+
+  paf.suspendOperation();
+  simDetach(&sensor);
+  Wire.setAdapter(NULL);
+  return held && sent;
+}
+
+
+int main()
+{
+  printf("10 Hz frames, bus figures up to resumeOperation(), times in ms\n\n");
+  printf("restart               xfers   bytes   bus ms  rewritten  digests  1st frame  wrong\n");
+  for(uint8_t scenario = fullInit; scenario <= resumeStop; scenario++) run(scenario);
+  return stagedOrder() ? 0 : 1;
+}
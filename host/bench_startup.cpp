@@ -0,0 +1,104 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host run of the startup sequence (PAF9701::beginStartup() / serviceStartup()) against the
+ *  blocking setup() of the sketches, on the model in PAF9701Sim.h and a 400 kHz simulated bus.
+ *
+ *  setup() has 250 ms of other work besides the PAF9701 (display init, other sensors), done in
+ *  10 ms pieces. Blocking, the sketch does the cold reset, delay(), bootload busy-wait, init and
+ *  settle delay first and the other work after; with the state machine the other work runs
+ *  while the sensor boots and settles, and serviceStartup() is called between the pieces and
+ *  then in a loop until ready. For each it reports the time from power-on to the first valid
+ *  frame and to the end of setup(), and the status reads spent polling. The model boots in
+ *  2 ms and does not model the settle function, so only the waits differ. All time is virtual.
+ *
+ *  g++ -O2 -I. -I../PAF9701_GestureDetection_Ladybug bench_startup.cpp Arduino.cpp Wire.cpp SimBus.cpp PAF9701Sim.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701FrameRing.cpp ../PAF9701_GestureDetection_Ladybug/I2Cdev.cpp -o bench_startup
+ *  ./bench_startup
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "PAF9701Sim.h"
+
+#define WORK_PIECES  25      // 10 ms each
+
+static const struct {
+  const char * name;
+  bool settle;
+  uint32_t resetTime;
+} settings[] = {
+  {"no settle, 200 ms reset", false, 200},
+  {"no settle, 5 ms reset",   false,   5},
+  {"settle, 200 ms reset",    true,  200},
+  {"settle, 5 ms reset",      true,    5}
+};
+
+
+static void run(uint8_t s, bool machine)
+{
+  SimBus bus(400000);
+  PAF9701Sim sensor(PAF9701_ADDRESS);
+  bus.attach(&sensor);
+  simAttach(&sensor);
+  Wire.setAdapter(&bus);
+  I2Cdev i2c(&Wire);
+  PAF9701 paf(&i2c);
+
+  uint64_t start = simNow(), firstFrame = 0;
+  uint32_t statusReads = 0;
+  bool ok = true;
+  if(machine) {
+    PAF9701_StartupConfig config = {false, normal_mode, 78, false, 0, balancedProfile, settings[s].settle,
+                                    settings[s].resetTime, 1000, 3000, 2000};
+    paf.beginStartup(&config);
+    for(uint8_t ii = 0; ii < WORK_PIECES; ii++) {
+      delay(10);            // a piece of other setup work
+      paf.serviceStartup();
+    }
+    uint8_t state;
+    while((state = paf.serviceStartup()) != startReady && state != startFailed) delay(1);
+    PAF9701_StartupStats stats;
+    paf.getStartupStats(&stats);
+    firstFrame = (uint64_t) stats.firstFrame * 1000000ULL;
+    statusReads = stats.statusReads;
+    ok = state == startReady;
+  }
+  else {
+    paf.coldReset();
+    delay(settings[s].resetTime);
+    while(!(paf.getStatus() & 0x20)) statusReads++;
+    statusReads++;
+    paf.initNormalMode(normal_mode, 78, settings[s].settle);
+    paf.clearInterrupt();
+    paf.resumeOperation();
+    if(settings[s].settle) delay(3000);
+    paf.clearInterrupt();
+    while(!(paf.getStatus() & 0x10)) {   // the sketches wait for the INT edge
+      statusReads++;
+      delay(1);
+    }
+    statusReads++;
+    firstFrame = simNow() - start;
+    for(uint8_t ii = 0; ii < WORK_PIECES; ii++) delay(10);
+  }
+  printf("%-24s  %-8s  %11.0f  %10.0f  %12u%s\n", settings[s].name, machine ? "machine" : "blocking",
+         firstFrame / 1e6, (simNow() - start) / 1e6, statusReads, ok ? "" : "  failed");
+
+  simDetach(&sensor);
+  Wire.setAdapter(NULL);
+}
+
+
+int main()
+{
+  printf("%u ms of other setup work, 10 Hz frames, times in ms from power-on\n\n", WORK_PIECES * 10);
+  printf("%-24s  %-8s  %11s  %10s  %12s\n", "sequence", "setup", "first frame", "setup done", "status reads");
+  for(uint8_t s = 0; s < sizeof(settings) / sizeof(settings[0]); s++) {
+    run(s, false);
+    run(s, true);
+  }
+  return 0;
+}
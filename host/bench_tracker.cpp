@@ -0,0 +1,410 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host benchmark of the multi-target tracker in PAF9701Tracker.h: people walking under an
+ *  overhead sensor modeled by PAF9701Sim.h, counted at a line across the middle of the frame.
+ *
+ *  A person is a 0.8 pixel sigma warm spot, 5 - 9 C above a 22 C floor, that walks down the
+ *  frame (in) or up it (out) at 3 - 10 pixels per second with a little sideways drift. The
+ *  scenes are people one at a time, two side by side, two passing each other in opposite
+ *  directions 3 columns apart, and random arrivals with a mean gap of 2 s, so that people
+ *  often share the frame and sometimes merge into one blob. The sensor runs the balanced
+ *  profile at 10 Hz with 100 mK noise; frames are read with readFrame() on the INT edge,
+ *  thresholded at 24.5 C, despeckled, labeled and tracked, the pipeline of the gesture sketch.
+ *
+ *  Every scene is counted three ways: by the default tracker, by a nearest neighbour rule (each
+ *  blob takes the ID of the nearest blob of the last frame within 2 pixels and counts when it
+ *  is on the other side of the line, no prediction, confirmation or band), and by the tracker
+ *  without hysteresis (confirmed on the first frame, deleted at the first miss, no band). It
+ *  reports counted against true crossings, ID switches (a track that moves from one person to
+ *  another, or a person that gets a second track), the tracks started and the delay from the
+ *  true crossing to the count. All sensor time is virtual; the update time is host time.
+ *
+ *  D=../PAF9701_GestureDetection_Ladybug
+ *  g++ -O2 -I. -I$D bench_tracker.cpp Arduino.cpp Wire.cpp SimBus.cpp PAF9701Sim.cpp $D/PAF9701.cpp $D/PAF9701FrameRing.cpp $D/I2Cdev.cpp $D/PAF9701Frame.cpp $D/PAF9701Mask.cpp $D/PAF9701Blob.cpp $D/PAF9701Tracker.cpp -o bench_tracker
+ *  ./bench_tracker [seconds of random arrivals]
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "PAF9701Sim.h"
+#include "PAF9701Frame.h"
+#include "PAF9701Mask.h"
+#include "PAF9701Blob.h"
+#include "PAF9701Tracker.h"
+
+#define INT_PIN      8
+#define RATE_HZ     10
+#define NOISE_MK   100
+#define LINE       3.5f    // count line, row
+#define BAND       0.5f
+#define MATCH_PX   1.5f    // a track within this of a person is following them
+#define FLOOR_C     22
+#define THRESHOLD_C 24.5    // alert level, 2.5 C above the floor
+
+typedef struct {
+  double start;            // s, when the person steps into view
+  float  x, drift;         // column at the start, columns per second
+  float  speed;            // rows per second
+  int8_t direction;        // 1 walks down (in), -1 up (out)
+  float  heat;             // C above the floor
+} Person;
+
+typedef struct {
+  const char * name;
+  std::vector<Person> people;
+  double seconds;
+} Scene;
+
+typedef struct {
+  uint64_t time;           // ns, when the frame was read
+  int16_t  pixels[64];
+} Recorded;
+
+typedef struct {
+  uint16_t id;
+  float    x, y;
+} Seen;
+
+// what run() needs from a counter: one update per frame, the crossings it made, the confirmed
+// tracks and the totals
+class Counter
+{
+  public:
+  virtual ~Counter() {}
+  virtual void update(const PAF9701_Blob * blobs, uint8_t count) = 0;
+  virtual void crossings(uint8_t * in, uint8_t * out) = 0;
+  virtual uint8_t tracks(Seen * seen) = 0;
+  virtual void totals(uint32_t * in, uint32_t * out, uint32_t * tracks) = 0;
+};
+
+class TrackerCounter : public Counter
+{
+  public:
+  TrackerCounter(const PAF9701_TrackerConfig * config, float band) { _tracker.setConfig(config); _tracker.setCountLine(false, LINE, band); }
+  void update(const PAF9701_Blob * blobs, uint8_t count) { _tracker.update(blobs, count); }
+  void crossings(uint8_t * in, uint8_t * out) { _tracker.lastCrossings(in, out); }
+  uint8_t tracks(Seen * seen)
+  {
+    uint8_t n = 0;
+    for(uint8_t ii = 0; ii < PAF9701_MAX_TRACKS; ii++) {
+      const PAF9701_Track * track = _tracker.track(ii);
+      if(track == NULL || track->state != trackConfirmed) continue;
+      seen[n].id = track->id;
+      seen[n].x = track->x;
+      seen[n].y = track->y;
+      n++;
+    }
+    return n;
+  }
+  void totals(uint32_t * in, uint32_t * out, uint32_t * tracks)
+  {
+    PAF9701_TrackerStats stats;
+    _tracker.getStats(&stats);
+    *in = stats.in;
+    *out = stats.out;
+    *tracks = stats.births;
+  }
+  private:
+  PAF9701Tracker _tracker;
+};
+
+// the centroid rule of the sketch extended to several objects: each blob takes the ID of the
+// nearest blob of the last frame within 2 pixels, no prediction, confirmation or band
+class NearestCounter : public Counter
+{
+  public:
+  NearestCounter() { _count = 0; _nextId = 1; _in = _out = _newTracks = 0; _lastIn = _lastOut = 0; }
+  void update(const PAF9701_Blob * blobs, uint8_t count)
+  {
+    Seen next[PAF9701_MAX_BLOBS];
+    bool taken[PAF9701_MAX_BLOBS] = {false};
+    _lastIn = _lastOut = 0;
+    for(uint8_t bb = 0; bb < count; bb++) {
+      next[bb].x = blobs[bb].x / 256.0f;
+      next[bb].y = blobs[bb].y / 256.0f;
+      next[bb].id = 0;
+      float bestD2 = 4.0f;
+      int best = -1;
+      for(uint8_t pp = 0; pp < _count; pp++) {
+        float dx = next[bb].x - _seen[pp].x, dy = next[bb].y - _seen[pp].y;
+        if(!taken[pp] && dx * dx + dy * dy < bestD2) { bestD2 = dx * dx + dy * dy; best = pp; }
+      }
+      if(best < 0) {
+        next[bb].id = _nextId++;
+        _newTracks++;
+        continue;
+      }
+      taken[best] = true;
+      next[bb].id = _seen[best].id;
+      bool wasLow = _seen[best].y < LINE, isLow = next[bb].y < LINE;
+      if(wasLow && !isLow) { _in++; _lastIn++; }
+      if(!wasLow && isLow) { _out++; _lastOut++; }
+    }
+    for(uint8_t bb = 0; bb < count; bb++) _seen[bb] = next[bb];
+    _count = count;
+  }
+  void crossings(uint8_t * in, uint8_t * out) { *in = _lastIn; *out = _lastOut; }
+  uint8_t tracks(Seen * seen) { for(uint8_t ii = 0; ii < _count; ii++) seen[ii] = _seen[ii]; return _count; }
+  void totals(uint32_t * in, uint32_t * out, uint32_t * tracks) { *in = _in; *out = _out; *tracks = _newTracks; }
+  private:
+  Seen _seen[PAF9701_MAX_BLOBS];
+  uint8_t _count;
+  uint16_t _nextId;
+  uint32_t _in, _out, _newTracks;
+  uint8_t _lastIn, _lastOut;
+};
+
+
+static volatile bool intFlag = false;
+static void intHandler() { intFlag = true; }
+
+
+// position at t s, false when out of view
+static bool personAt(const Person * p, double t, float * x, float * y)
+{
+  double dt = t - p->start;
+  if(dt < 0) return false;
+  float travel = p->speed * dt;
+  if(travel > 10.0f) return false;          // from row -1.5 to 8.5
+  *x = p->x + p->drift * dt;
+  *y = p->direction > 0 ? -1.5f + travel : 8.5f - travel;
+  return true;
+}
+
+
+static double crossingTime(const Person * p)
+{
+  return p->start + (p->direction > 0 ? LINE + 1.5 : 8.5 - LINE) / p->speed;
+}
+
+
+static void peopleScene(void * context, uint64_t now, int16_t * pixels, int16_t * ambient)
+{
+  Scene * scene = (Scene *) context;
+  double t = now / 1e9;
+  float warm[64];
+  for(uint8_t ii = 0; ii < 64; ii++) warm[ii] = 0;
+  for(size_t pp = 0; pp < scene->people.size(); pp++) {
+    float px, py;
+    if(!personAt(&scene->people[pp], t, &px, &py)) continue;
+    for(uint8_t ii = 0; ii < 64; ii++) {
+      float dx = (ii & 7) - px, dy = (ii >> 3) - py;
+      float h = scene->people[pp].heat * expf(-(dx * dx + dy * dy) / (2 * 0.8f * 0.8f));
+      if(h > warm[ii]) warm[ii] = h;        // the nearer body hides the other
+    }
+  }
+  for(uint8_t ii = 0; ii < 64; ii++) pixels[ii] = (int16_t) lrintf((FLOOR_C + warm[ii]) * 16.0f);
+  *ambient = 25 * 16;
+}
+
+
+static double uniform(uint32_t * seed, double lo, double hi)
+{
+  *seed = *seed * 1103515245u + 12345u;
+  return lo + (hi - lo) * ((*seed >> 8) & 0xFFFFFF) / 16777216.0;
+}
+
+
+static Person person(double start, float x, int8_t direction, float speed, uint32_t * seed)
+{
+  Person p;
+  p.start = start;
+  p.x = x;
+  p.drift = (float) uniform(seed, -0.3, 0.3);
+  p.speed = speed;
+  p.direction = direction;
+  p.heat = (float) uniform(seed, 5, 9);
+  return p;
+}
+
+
+static void makeScenes(std::vector<Scene> * scenes, double randomSeconds)
+{
+  uint32_t seed = 7;
+  Scene single = {"one at a time", {}, 0};
+  for(int nn = 0; nn < 40; nn++) {
+    single.people.push_back(person(1.0 + 4.0 * nn, (float) uniform(&seed, 1.5, 5.5), nn & 1 ? -1 : 1, (float) uniform(&seed, 3, 10), &seed));
+  }
+  single.seconds = 4.0 * 40 + 2;
+  scenes->push_back(single);
+
+  Scene abreast = {"side by side", {}, 0};
+  for(int nn = 0; nn < 20; nn++) {
+    float speed = (float) uniform(&seed, 3, 8);
+    int8_t direction = nn & 1 ? -1 : 1;
+    abreast.people.push_back(person(1.0 + 5.0 * nn, 1.5f, direction, speed, &seed));
+    abreast.people.push_back(person(1.0 + 5.0 * nn, 5.5f, direction, speed, &seed));
+  }
+  abreast.seconds = 5.0 * 20 + 2;
+  scenes->push_back(abreast);
+
+  Scene passing = {"passing", {}, 0};
+  for(int nn = 0; nn < 20; nn++) {
+    float speed = (float) uniform(&seed, 3, 8);
+    passing.people.push_back(person(1.0 + 5.0 * nn, 2.0f, 1, speed, &seed));
+    passing.people.push_back(person(1.0 + 5.0 * nn, 5.0f, -1, speed, &seed));
+  }
+  passing.seconds = 5.0 * 20 + 2;
+  scenes->push_back(passing);
+
+  Scene random = {"random arrivals", {}, randomSeconds + 3};
+  for(double t = 1.0; t < randomSeconds; t += -2.0 * log(uniform(&seed, 1e-6, 1))) {
+    random.people.push_back(person(t, (float) uniform(&seed, 1, 6), uniform(&seed, 0, 1) < 0.5 ? 1 : -1, (float) uniform(&seed, 3, 10), &seed));
+  }
+  scenes->push_back(random);
+}
+
+
+static void record(Scene * scene, std::vector<Recorded> * frames)
+{
+  SimBus bus(400000);
+  PAF9701Sim sensor(PAF9701_ADDRESS, INT_PIN);
+  sensor.setScene(peopleScene, scene);
+  sensor.setNoise(NOISE_MK);
+  bus.attach(&sensor);
+  simAttach(&sensor);
+  Wire.setAdapter(&bus);
+  I2Cdev i2c(&Wire);
+  PAF9701 paf(&i2c);
+  intFlag = false;
+
+  paf.coldReset();
+  while(!(paf.getStatus() & 0x20)) {}
+  paf.initNormalMode(normal_mode, 200000 / (256 * RATE_HZ), false, balancedProfile);
+  paf.setAlertMode(frameUpdateAlert, frameUpdateAlert);
+  paf.setSnapshotRead(2);
+  attachInterrupt(INT_PIN, intHandler, FALLING);
+  paf.clearInterrupt();
+  paf.resumeOperation();
+
+  // scene time starts at 0 with the sensor running
+  uint64_t start = simNow();
+  for(size_t pp = 0; pp < scene->people.size(); pp++) scene->people[pp].start += start / 1e9;
+  PAF9701_Frame frame;
+  while(simNow() < start + (uint64_t) (scene->seconds * 1e9)) {
+    if(!intFlag) {
+      simAdvance(100000);
+      continue;
+    }
+    intFlag = false;
+    paf.readFrame(&frame);
+    Recorded r;
+    r.time = simNow() - start;
+    for(uint8_t ii = 0; ii < 64; ii++) r.pixels[ii] = frame.pixels[ii];
+    frames->push_back(r);
+  }
+  for(size_t pp = 0; pp < scene->people.size(); pp++) scene->people[pp].start -= start / 1e9;
+
+  detachInterrupt(INT_PIN);
+  simDetach(&sensor);
+  Wire.setAdapter(NULL);
+}
+
+
+static void run(const Scene * scene, const std::vector<Recorded> * frames, const char * name, Counter * counter)
+{
+  size_t people = scene->people.size();
+  std::vector<double> crossings(people);
+  std::vector<bool> counted(people, false);
+  std::vector<int> lastTrack(people, 0);
+  std::vector<int> owner;                   // person of each track ID, -1 none yet
+  uint32_t trueIn = 0, trueOut = 0, switches = 0, matched = 0;
+  double delayTotal = 0, delayMax = 0, hostNs = 0;
+  for(size_t pp = 0; pp < people; pp++) {
+    crossings[pp] = crossingTime(&scene->people[pp]);
+    if(crossings[pp] > scene->seconds - 1) continue;
+    if(scene->people[pp].direction > 0) trueIn++;
+    else trueOut++;
+  }
+
+  PAF9701_Blob blobs[PAF9701_MAX_BLOBS];
+  Seen seen[PAF9701_MAX_BLOBS > PAF9701_MAX_TRACKS ? PAF9701_MAX_BLOBS : PAF9701_MAX_TRACKS];
+  for(size_t ff = 0; ff < frames->size(); ff++) {
+    const Recorded * r = &(*frames)[ff];
+    double t = r->time / 1e9;
+    uint64_t mask = maskFilter(frameThreshold(r->pixels, PAF9701_TO_RAW(THRESHOLD_C)), maskDespeckleStep | maskFillStep);
+    uint8_t found = blobLabel(mask, r->pixels, 8, blobs, PAF9701_MAX_BLOBS);
+    auto t0 = std::chrono::steady_clock::now();
+    counter->update(blobs, found);
+    auto t1 = std::chrono::steady_clock::now();
+    hostNs += std::chrono::duration<double, std::nano>(t1 - t0).count();
+
+    // each count goes to the earliest uncounted true crossing in its direction
+    uint8_t in, out;
+    counter->crossings(&in, &out);
+    for(int8_t direction = 1; direction >= -1; direction -= 2) {
+      for(uint8_t nn = direction > 0 ? in : out; nn > 0; nn--) {
+        for(size_t pp = 0; pp < people; pp++) {
+          if(counted[pp] || scene->people[pp].direction != direction || crossings[pp] > t || t - crossings[pp] > 2.0) continue;
+          counted[pp] = true;
+          delayTotal += t - crossings[pp];
+          if(t - crossings[pp] > delayMax) delayMax = t - crossings[pp];
+          matched++;
+          break;
+        }
+      }
+    }
+
+    uint8_t tracks = counter->tracks(seen);
+    for(uint8_t ii = 0; ii < tracks; ii++) {
+      int best = -1;
+      float bestD2 = MATCH_PX * MATCH_PX;
+      for(size_t pp = 0; pp < people; pp++) {
+        float px, py;
+        if(!personAt(&scene->people[pp], t, &px, &py)) continue;
+        float d2 = (px - seen[ii].x) * (px - seen[ii].x) + (py - seen[ii].y) * (py - seen[ii].y);
+        if(d2 < bestD2) { bestD2 = d2; best = (int) pp; }
+      }
+      if(best < 0) continue;
+      uint16_t id = seen[ii].id;
+      if(owner.size() <= id) owner.resize(id + 1, -1);
+      if(owner[id] >= 0 && owner[id] != best) switches++;                // track jumped to someone else
+      owner[id] = best;
+      if(lastTrack[best] != 0 && lastTrack[best] != id) switches++;      // person picked up a new track
+      lastTrack[best] = id;
+    }
+  }
+
+  uint32_t countIn, countOut, started;
+  counter->totals(&countIn, &countOut, &started);
+  int32_t error = abs((int32_t) countIn - (int32_t) trueIn) + abs((int32_t) countOut - (int32_t) trueOut);
+  printf("%-16s %-17s %4u/%-4u %4u/%-4u %5d %8u %8.0f %8.0f %7u %9.0f\n", scene->name, name, countIn, trueIn, countOut, trueOut,
+         error, switches, matched ? delayTotal * 1000 / matched : 0.0, delayMax * 1000, started, hostNs / frames->size());
+}
+
+
+int main(int argc, char ** argv)
+{
+  double randomSeconds = argc > 1 ? atof(argv[1]) : 600;
+  std::vector<Scene> scenes;
+  makeScenes(&scenes, randomSeconds);
+
+  PAF9701Tracker defaults;
+  PAF9701_TrackerConfig config, immediate;
+  defaults.getConfig(&config);
+  immediate = config;
+  immediate.confirmHits = 1;
+  immediate.deleteMisses = 1;
+
+  printf("people walking under the sensor at 3 - 10 px/s, %u Hz, %u mK noise, count line at row %.1f\n", RATE_HZ, NOISE_MK, LINE);
+  printf("in and out counted/true, error = |in| + |out| miscounts, delays in ms, update time on this host\n\n");
+  printf("scene            counter             in/true  out/true error switches    delay      max  tracks update ns\n");
+  for(size_t ss = 0; ss < scenes.size(); ss++) {
+    std::vector<Recorded> frames;
+    record(&scenes[ss], &frames);
+    TrackerCounter tracker(&config, BAND);
+    NearestCounter nearest;
+    TrackerCounter noHysteresis(&immediate, 0);
+    run(&scenes[ss], &frames, "tracker", &tracker);
+    run(&scenes[ss], &frames, "nearest neighbour", &nearest);
+    run(&scenes[ss], &frames, "no hysteresis", &noHysteresis);
+  }
+  return 0;
+}
@@ -0,0 +1,109 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host benchmark of window of interest reads (PAF9701::setWindow()) on the simulated bus.
+ *
+ *  For each bus clock and window it reads frames at 10 Hz with readFrame() in snapshot mode,
+ *  started from the INT edge, and reports transfers, bytes and bus time per frame and the frame
+ *  rate one bus could carry at that cost. The scene writes the frame number into every pixel,
+ *  so a frame is wrong when a pixel inside the window differs from pixel data of that frame or
+ *  one outside it is not 0. All time is virtual, so the numbers are the same on every run.
+ *
+ *  g++ -O2 -I. -I../PAF9701_GestureDetection_Ladybug bench_window.cpp Arduino.cpp Wire.cpp SimBus.cpp PAF9701Sim.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701FrameRing.cpp ../PAF9701_GestureDetection_Ladybug/I2Cdev.cpp -o bench_window
+ *  ./bench_window [frames]
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "PAF9701Sim.h"
+
+#define INT_PIN   8
+#define RATE_HZ  10
+
+static const struct {
+  const char * name;
+  uint8_t firstRow, lastRow, firstColumn, lastColumn;
+} windows[] = {
+  {"whole frame",      0, 7, 0, 7},
+  {"rows 3-4",         3, 4, 0, 7},    // doorway band across both banks
+  {"rows 2-3",         2, 3, 0, 7},    // bank 4 only
+  {"rows 4-5",         4, 5, 0, 7},    // bank 5 only
+  {"row 3",            3, 3, 0, 7},
+  {"rows 2-5 cols 2-5", 2, 5, 2, 5}
+};
+
+static volatile bool intFlag = false;
+static void intHandler() { intFlag = true; }
+
+
+static void run(uint32_t clock, uint8_t w, uint32_t frames)
+{
+  uint32_t counter = 0;
+  SimBus bus(clock);
+  PAF9701Sim sensor(PAF9701_ADDRESS, INT_PIN);
+  sensor.setScene(paf9701SimFrameCounter, &counter);
+  bus.attach(&sensor);
+  simAttach(&sensor);
+  Wire.setAdapter(&bus);
+  I2Cdev i2c(&Wire);
+  PAF9701 paf(&i2c);
+  intFlag = false;
+
+  paf.coldReset();
+  while(!(paf.getStatus() & 0x20)) {}
+  paf.initNormalMode(normal_mode, 200000 / (256 * RATE_HZ), true);
+  paf.setAlertMode(frameUpdateAlert, frameUpdateAlert);
+  paf.setSnapshotRead(2);
+  if(w) paf.setWindow(windows[w].firstRow, windows[w].lastRow, windows[w].firstColumn, windows[w].lastColumn);
+  attachInterrupt(INT_PIN, intHandler, FALLING);
+  paf.clearInterrupt();
+  paf.resumeOperation();
+
+  PAF9701_Frame frame;
+  uint32_t wrong = 0, done = 0;
+  bus.resetStats();
+  while(done < frames) {
+    if(!intFlag) {
+      simAdvance(10000);      // idle until the INT edge
+      continue;
+    }
+    intFlag = false;
+    paf.readFrame(&frame);
+    int16_t value = -1;
+    for(uint8_t ii = 0; ii < 64; ii++) {
+      bool inside = frame.windowMask & ((uint64_t) 1 << ii);
+      if(inside && value < 0) value = frame.pixels[ii];
+      if((inside && frame.pixels[ii] != value) || (!inside && frame.pixels[ii] != 0)) {
+        wrong++;
+        break;
+      }
+    }
+    done++;
+  }
+
+  SimBusStats stats;
+  bus.getStats(&stats);
+  double busMs = stats.busTime / 1e6 / frames;
+  printf("%7u  %-18s  %6.1f  %6.1f  %7.2f  %8.0f  %5u\n", clock / 1000, windows[w].name,
+         (double) stats.transfers / frames, (double) stats.bytes / frames, busMs, 1000.0 / busMs, wrong);
+
+  detachInterrupt(INT_PIN);
+  simDetach(&sensor);
+  Wire.setAdapter(NULL);
+}
+
+
+int main(int argc, char ** argv)
+{
+  uint32_t frames = argc > 1 ? atoi(argv[1]) : 200;
+  static const uint32_t clocks[] = {100000, 400000};
+  printf("%u frames at %u Hz per run, readFrame() in snapshot mode\n\n", frames, RATE_HZ);
+  printf("    kHz  window               xfers   bytes   bus ms  max fps  wrong\n");
+  for(uint8_t cc = 0; cc < 2; cc++) {
+    for(uint8_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++) run(clocks[cc], w, frames);
+  }
+  return 0;
+}
@@ -0,0 +1,92 @@
+/* Copyright Tlera Corporation
+ *
+ *  Host check of the register field map in PAF9701Fields.h on the model in PAF9701Sim.h.
+ *
+ *  Writes the filter and alert mode registers through setFilter(), setAlertMode() and
+ *  setFields() and reads them back three ways: straight from the model's register file in the
+ *  bank the data sheet puts them in, through getField() on the same driver (shadow), and through
+ *  getField() on a new driver object, which has no shadow and must read the sensor. It also
+ *  checks that the write did not land on the same address in another bank. Last, registers are
+ *  changed behind the driver's back and getNormalAlertLimits() and getPowerSaveMode() must show
+ *  the sensor's values, not the shadow's. Prints one line per case and exits with 1 when any
+ *  readback is wrong.
+ *
+ *  g++ -O2 -I. -I../PAF9701_GestureDetection_Ladybug test_fields.cpp Arduino.cpp Wire.cpp SimBus.cpp PAF9701Sim.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701.cpp ../PAF9701_GestureDetection_Ladybug/PAF9701FrameRing.cpp ../PAF9701_GestureDetection_Ladybug/I2Cdev.cpp -o test_fields
+ *  ./test_fields
+ *
+ *  Library may be used freely and without limit with attribution.
+ *
+ */
+
+#include <stdio.h>
+
+#include "PAF9701Sim.h"
+
+static uint32_t failures = 0;
+
+
+static void expect(const char * name, uint8_t got, uint8_t wanted)
+{
+  printf("%-42s  0x%02X  0x%02X  %s\n", name, got, wanted, got == wanted ? "ok" : "FAIL");
+  if(got != wanted) failures++;
+}
+
+
+int main()
+{
+  SimBus bus(400000);
+  PAF9701Sim sensor(PAF9701_ADDRESS);
+  bus.attach(&sensor);
+  simAttach(&sensor);
+  Wire.setAdapter(&bus);
+  I2Cdev i2c(&Wire);
+  PAF9701 paf(&i2c);
+
+  paf.coldReset();
+  while(!(paf.getStatus() & 0x20)) delay(1);
+  uint8_t bank0Filter = sensor.reg(0, PAF9701_FILTER_SEL);
+
+  printf("readback                                     got   want\n");
+  static const uint8_t filters[][3] = {
+    {movingAverage, fourFrames,  frames0_1},
+    {IIR,           eightFrames, frames750_250},
+    {normalAverage, oneFrame,    frames825_125}
+  };
+  for(uint8_t ff = 0; ff < 3; ff++) {
+    uint8_t wanted = filters[ff][1] << 5 | filters[ff][0] << 3 | filters[ff][2];
+    paf.setFilter(filters[ff][0], filters[ff][1], filters[ff][2]);
+    expect("setFilter(), bank 1 FILTER_SEL", sensor.reg(1, PAF9701_FILTER_SEL), wanted);
+    expect("setFilter(), bank 0 at the same address", sensor.reg(0, PAF9701_FILTER_SEL), bank0Filter);
+    expect("getField(fieldDigitalFilter), shadow", paf.getField(fieldDigitalFilter), filters[ff][0]);
+    PAF9701 fresh(&i2c);
+    expect("getField(fieldFrameAverage), from the bus", fresh.getField(fieldFrameAverage), filters[ff][1]);
+    expect("getField(fieldIIRAverage), from the bus", fresh.getField(fieldIIRAverage), filters[ff][2]);
+  }
+
+  paf.setFields(fieldFrameAverage.value(twoFrames));    // one field, the others keep their value
+  expect("setFields(fieldFrameAverage), bank 1", sensor.reg(1, PAF9701_FILTER_SEL), twoFrames << 5 | normalAverage << 3 | frames825_125);
+
+  paf.setAlertMode(absValueAlert, diffValueAlert);
+  expect("setAlertMode(), bank 0 ALERT_MODE", sensor.reg(0, PAF9701_ALERT_MODE), absValueAlert << 2 | diffValueAlert);
+
+  // readback getters must see a register changed behind the driver's back, not the shadow
+  paf.setNormalAlertLimits(0, 80, 2, 40, 60, 2, 1);
+  paf.setFields(fieldAutoPowerSave.value(0));
+  i2c.writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x00);
+  i2c.writeByte(PAF9701_ADDRESS, PAF9701_POWER_SAVING_MODE, 0x12);
+  i2c.writeByte(PAF9701_ADDRESS, PAF9701_BANK_SELECT, 0x01);     // left in the bank the driver last selected
+  i2c.writeByte(PAF9701_ADDRESS, PAF9701_TA_LOW_LIMIT_L, 0x20);
+  i2c.writeByte(PAF9701_ADDRESS, PAF9701_TO_PIXEL_THRESHOLD, 0x05);
+  int16_t limits[7];
+  paf.getNormalAlertLimits(limits);
+  expect("getNormalAlertLimits(), Ta low changed", limits[0], 0x20);
+  expect("getNormalAlertLimits(), Ta high", limits[1], 80);
+  expect("getNormalAlertLimits(), To low", limits[2], 40);
+  expect("getNormalAlertLimits(), pixels changed", limits[6], 0x05);
+  expect("getPowerSaveMode(), changed", paf.getPowerSaveMode(), 0x12);
+
+  printf("\n%u wrong\n", failures);
+  simDetach(&sensor);
+  Wire.setAdapter(NULL);
+  return failures ? 1 : 0;
+}